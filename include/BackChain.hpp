@@ -1,6 +1,11 @@
 #ifndef BACK_CHAIN_H
 #define BACK_CHAIN_H
 
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -8,15 +13,49 @@
 #include "VariableListItem.hpp"
 #include "ClauseItem.hpp"
 #include "KnowledgeBase.hpp"
+#include "KnowledgeShards.hpp"
+#include "ResultCache.hpp"
+#include "TruthMaintenance.hpp"
+#include "RuleProfile.hpp"
+#include "FactProvider.hpp"
+#include "InferenceBudget.hpp"
+#include "PartialMatch.hpp"
+#include "CertaintyRanking.hpp"
+#include "RelevanceSlice.hpp"
+#include "RuleStrata.hpp"
+#include "SessionLog.hpp"
+#include "ThreadPool.hpp"
 
 class BackChain
 {
 public:
+    explicit BackChain(KnowledgeBase* sharedRuleSystem = nullptr);
+    virtual ~BackChain() {}
     void populateLists();
     void runBackwardChaining();
-    void populateVariableList(std::string);
+    int solveGoal(const std::string& goal);
+    std::vector<int> solveGoals(const std::vector<std::string>& goals);
+    void solveAndDisplay(const std::string& goal);
+    void displayResult(int conclusionLocation, const std::string& goal);
+    void displayRanking(const std::string& goal, std::ostream& out);
+    int changeFact(const std::string& name, const std::string& value);
+    virtual void resetSession();
+    std::vector<int> getProof(int location) const;
+    void populateVariableList(std::string, std::ostream& log = std::cout);
+    void analyzeKnowledgeBase();
+    void loadFacts(std::string fileName);
+    int loadFacts(std::istream& factsStream);
+    bool askUser(VariableListItem& variable);
+    void finishCapture();
 
-    KnowledgeBase ruleSystem;
+private:
+    // Only set when the knowledge base is not shared with other sessions.
+    std::unique_ptr<KnowledgeBase> ownedRuleSystem;
+
+public:
+    // Either the knowledge base this session owns, or one shared read only
+    // by every session created from the same KnowledgeHandle.
+    KnowledgeBase& ruleSystem;
     std::vector<VariableListItem> variableList;
 
     // Due to the design of the system (use the info from the backward
@@ -24,11 +63,123 @@ public:
     // to keep track of the conclusions that were set.
     std::vector<VariableListItem> intermediateConclusionList;
 
-private:
-    int findValidConclusionInStatements(std::string conclusionName, int startingIndex, std::string stringToMatch);
+    // The files populateLists reads; one pair per vehicle platform.
+    std::string knowledgeBaseFile = "knowledgeBase.txt";
+    std::string variableListFile = "variablesList.csv";
+
+    // Load time analysis of the knowledge base (see KnowledgeAnalyzer). When
+    // pruning, dead and shadowed rules are dropped before chaining starts.
+    bool analyzeOnLoad = false;
+    bool pruneOnLoad = false;
+
+    // With more than one thread, the knowledge base is parsed in parallel
+    // chunks while the variable list loads alongside it.
+    int loadThreads = 1;
+
+    // When set, only the shard manifest in this directory is read at load
+    // time and KB shards are loaded for the goals actually asked for.
+    std::string shardDirectory;
+    KnowledgeShards knowledgeShards;
+
+    // Statements proven so far this session, in the order they were proven.
+    std::vector<int> provenStatements;
+
+    // Justifications of the conclusions proven this session. Conclusions
+    // that are IN are reused instead of being proven again, and changing a
+    // fact only retracts the conclusions that depend on it.
+    TruthMaintenance truthMaintenance;
+    std::string lastGoal;
+
+    // The goal table: every goal, as "name = value", that could not be
+    // proven this session. Together with the justified conclusions above it
+    // means no subgoal is solved twice, whichever goal needs it.
+    std::set<std::string> failedGoals;
+
+    // When set, rule and premise statistics are recorded into the profile
+    // and it reorders the KB at load time. Checking known facts first makes
+    // a statement fail on an answer already given before any question is
+    // asked for its other premises.
+    RuleProfile* ruleProfile = nullptr;
+    bool checkKnownFactsFirst = false;
+
+    // Where the values of variables come from. Without a provider the user
+    // is prompted on the console. Requests made to the provider, batched
+    // or single, are counted in providerRequests.
+    FactProvider* factProvider = nullptr;
+    int providerRequests = 0;
+
+    // While the user is answering a question on the console, work out on
+    // background threads where each answer leads (see Speculation).
+    bool isSpeculative = false;
+
+    // The relevance slices of the goals solved so far, and the slice of the
+    // goal being solved; chaining only looks at the rules in it. Not used
+    // with shards, which grow the KB while chaining.
+    RelevanceSlices relevanceSlices;
+    const RelevanceSlice* goalSlice = nullptr;
+
+    // With a pool, the repair step forward chains a level at a time on it;
+    // the levels are worked out when the KB is loaded (see RuleStrata).
+    ThreadPool* forwardPool = nullptr;
+    RuleStrata ruleStrata;
+
+    // Limits on the work of each solveGoal call. When one runs out the goal
+    // is left unproven and budget.getStopReason() says why.
+    InferenceBudget budget;
+
+    // How many of the closest rules to list when a goal is inconclusive,
+    // with the questions that would confirm each; 0 for none.
+    int candidateCount = 0;
+    PartialMatch partialMatch;
+
+    // How many values of each goal to rank by certainty, from every rule at
+    // once and the certainties of the answers; 0 for none.
+    int rankCount = 0;
+    CertaintyRanking certaintyRanking;
+
+    // Set when the user answers a question with suspend (see
+    // SessionCheckpoint); the rest of the solve asks nothing.
+    bool isSuspended = false;
+
+    // Results shared with other sessions; only sessions that did not need to
+    // prompt are stored, since a prompted answer is not part of the key.
+    ResultCache* resultCache = nullptr;
+    bool isLastResultCached = false;
+    int promptCount = 0;
+
+    // When set, every session's answers and results are appended to the log
+    // as the session ends, at resetSession or finishCapture.
+    SessionLog* sessionLog = nullptr;
+
+protected:
+    virtual int findValidConclusionInStatements(std::string conclusionName, int startingIndex, std::string stringToMatch);
+    int evaluateGoal(const std::string& goal);
     bool instantiatePremiseClause(const ClauseItem& clause);
     bool processPremiseList(const Statement& statement);
+    bool evaluateExpression(const ClauseItem& expression);
+    bool isExpressionLeafTrue(const ExpressionPool::Node& leaf);
+    bool isExpressionLeafTrue(const ExpressionPool::Node& leaf, int conclusionLocation);
     void addToIntermediateConclusionList(const ClauseItem& intermediateConclusion);
+    void recordProven(int statement);
+    int findContradictedPremise(const Statement& statement) const;
+    int nextStatementConcluding(const std::string& name, int startingIndex) const;
+    bool isFailedGoal(const std::string& name, const std::string& value) const;
+    void recordFailedGoal(const std::string& name, const std::string& value);
+    void prefetchGoalFacts(const std::string& goal);
+    void collectPrefetchedFacts();
+    bool fetchFact(VariableListItem& variable);
+    void startCapture();
+    void captureEvent(SessionLog::EventType type, const std::string& name, const std::string& value, int location = 0);
+    int captureResult(const std::string& goal, int location);
+
+    // The batched request for the current goal's variables, while it is in
+    // flight, and the values it brought back.
+    std::future<FactValues> pendingFacts;
+    FactValues prefetchedFacts;
+
+    // The session being captured for sessionLog, and when it started.
+    SessionLog::Session capturedSession;
+    std::chrono::steady_clock::time_point captureStart;
 
 };
 
@@ -0,0 +1,42 @@
+#ifndef BINARY_FORMAT_H
+#define BINARY_FORMAT_H
+
+#include <istream>
+#include <ostream>
+#include <string>
+
+/**
+ * BinaryFormat - The encodings the binary files share: fixed size little
+ * endian words, as in the decision table, the trace log and the session log,
+ * and unsigned LEB128 varints and length prefixed strings, as in session
+ * checkpoints. Words read past the end of a stream come back as garbage, so
+ * stream readers check the stream afterwards; Reader instead fails on any
+ * truncated or malformed input without throwing.
+ */
+class BinaryFormat
+{
+public:
+    static void writeWord(std::ostream& out, unsigned long long word, int byteCount);
+    static unsigned long long readWord(std::istream& in, int byteCount);
+
+    static void putWord(std::string& out, unsigned long long word, int byteCount);
+    static void putVarint(std::string& out, unsigned long long value);
+    static void putString(std::string& out, const std::string& text);
+
+    // Reads what the put functions append, from a string held by the caller.
+    struct Reader
+    {
+        explicit Reader(const std::string& dataP);
+
+        bool getWord(int byteCount, unsigned long long& word);
+        bool getVarint(unsigned long long& value);
+        bool getString(std::string& text);
+        bool getBytes(size_t count, size_t& start);
+
+        const std::string& data;
+        size_t position;
+        bool isGood;    // false from the first read that failed on
+    };
+};
+
+#endif // !BINARY_FORMAT_H
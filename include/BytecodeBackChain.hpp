@@ -0,0 +1,61 @@
+#ifndef BYTECODE_BACK_CHAIN_H
+#define BYTECODE_BACK_CHAIN_H
+
+#include <string>
+#include <vector>
+
+#include "BackChain.hpp"
+#include "RuleBytecode.hpp"
+
+/**
+ * BytecodeBackChain - Backward chaining by running the KB compiled to
+ * bytecode (see RuleBytecode) in one dispatch loop, with the variables in
+ * registers and the values as numbers, so a premise is an integer compare
+ * rather than a string compare and a scan of the variable list. Calls to
+ * sub goals push a frame on an explicit stack. Answers, prompts, proofs,
+ * intermediate conclusions and failed goals are exactly those of BackChain.
+ *
+ * The program is compiled again whenever KnowledgeBase::version changes.
+ * A session that is traced, profiled, limited by a budget or loaded as
+ * shards, or a KB with a conclusion cycle, is chained by BackChain.
+ */
+class BytecodeBackChain : public BackChain
+{
+public:
+    explicit BytecodeBackChain(KnowledgeBase* sharedRuleSystem = nullptr, const RuleBytecode* sharedProgram = nullptr);
+
+    const RuleBytecode& compile();
+
+protected:
+    int findValidConclusionInStatements(std::string conclusionName, int startingIndex, std::string stringToMatch) override;
+
+private:
+    // A sub goal being proven, and the PROVE waiting for it.
+    struct Frame
+    {
+        int procedure;
+        int returnTo;
+    };
+
+    bool isInterpretable() const;
+    int run(int procedure);
+    bool loadRegister(int variable);
+
+    // Unless shared, the program of this session's KB.
+    RuleBytecode ownProgram;
+    const RuleBytecode* program;
+
+    // Per goal: the value number in each register, -1 until the variable is
+    // instantiated, and what each procedure came to, as returned by
+    // findValidConclusionInStatements (0 until known).
+    std::vector<int> registers;
+    std::vector<int> procedureResults;
+    std::vector<Frame> frames;
+
+    // The variable list entry of each register, 0 if there is none.
+    std::vector<int> registerEntries;
+    unsigned long long entriesVersion = 0;
+    int entriesVariableCount = -1;
+};
+
+#endif // !BYTECODE_BACK_CHAIN_H
@@ -0,0 +1,96 @@
+#ifndef CERTAINTY_RANKING_H
+#define CERTAINTY_RANKING_H
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "KnowledgeBase.hpp"
+#include "VariableListItem.hpp"
+
+/**
+ * CertaintyRanking - Ranks every value of a goal by how certain the session's
+ * answers make it. An answer holds with the certainty it was given (1 unless
+ * it was followed by [c], see splitCertainty) and any other value of the
+ * same variable with what is left of it; a variable not answered holds no
+ * value. As in MYCIN, a rule holds as much as its least certain premise (an
+ * OR as much as its most certain operand, a NOT as much as what is left of
+ * its test) times the rule's own certainty, and the rules concluding the
+ * same value combine as c1 + c2 (1 - c1). With every answer certain this is
+ * the boolean result: 1 for what holds, 0 for the rest.
+ *
+ * The whole KB is compiled once per version into flat arrays, a rule level
+ * at a time (see RuleStrata). The rules of a level are laid out column-wise,
+ * one row per premise position, short rules padded with a slot that is
+ * always 1, so a level is scored by a few straight loops over contiguous
+ * arrays, without walking any rule or expression. One pass scores every
+ * rule, so every conclusion of the KB is ranked at once.
+ */
+class CertaintyRanking
+{
+public:
+    struct Candidate
+    {
+        std::string value;
+        double certainty;   // in (0, 1]
+        int statement;      // kBase index of the rule contributing the most
+    };
+
+    std::vector<Candidate> rank(const std::string& goal, int count, const KnowledgeBase& knowledgeBase,
+                                const std::vector<VariableListItem>& variableList);
+    static void display(const std::vector<Candidate>& candidates, std::ostream& out);
+
+    static bool splitCertainty(std::string& text, double& certainty);
+    static std::string withCertainty(const std::string& value, double certainty);
+
+    bool isAcyclic = false;     // false until built, and for a KB with a conclusion cycle
+
+private:
+    void build(const KnowledgeBase& knowledgeBase, const std::vector<VariableListItem>& variableList);
+    int addTest(const std::string& name, const std::string& value);
+    int premiseSlot(const ClauseItem& premise, const KnowledgeBase& knowledgeBase);
+    int nodeSlot(int node, const KnowledgeBase& knowledgeBase);
+    void score(const std::vector<VariableListItem>& variableList);
+
+    unsigned long long builtVersion = 0;
+    int builtVariableCount = -1;
+
+    // Every distinct name = value tested or concluded, answered variables
+    // first. Slot 0 always holds 1, slot 1 + t the certainty that test t
+    // holds, slot 1 + testCount + t that it does not, then the OR and AND
+    // groups of EXPRESSION premises.
+    std::map<std::pair<std::string, std::string>, int> testIds;
+    std::vector<std::string> testNames;
+    std::vector<std::string> testValues;
+    int testCount = 0;
+    int answerTestCount = 0;
+    std::vector<int> answerTestVariable;    // variableList index, 0 if not in it
+    std::vector<int> answerTestValue;       // id in valueIds
+    std::unordered_map<std::string, int> valueIds;
+    std::map<std::string, std::vector<int> > conclusionTestsByName;
+
+    std::vector<int> expressionSlots;       // by ExpressionPool node, 0 until given one
+    std::vector<int> groupSlot;             // groups by level, operands before the groups using them
+    std::vector<char> groupIsOr;
+    std::vector<int> operandStart;          // group g's operands are operandSlot[operandStart[g], operandStart[g + 1])
+    std::vector<int> operandSlot;
+    std::vector<int> levelGroupStart;
+
+    std::vector<int> levelRuleStart;        // level l's rules are [levelRuleStart[l], levelRuleStart[l + 1])
+    std::vector<int> levelPremiseStart;     // and its premise rows start at premiseSlots[levelPremiseStart[l]]
+    std::vector<int> levelWidth;            // premise rows of the level
+    std::vector<int> premiseSlots;          // row major: row k holds premise k of each rule of the level
+    std::vector<int> ruleStatement;
+    std::vector<int> ruleConclusion;        // test id
+    std::vector<float> ruleCertainty;
+
+    // Scratch, kept so ranking does not allocate.
+    std::vector<int> answerValue;           // by variable, -1 if unanswered
+    std::vector<float> answerCertainty;
+    std::vector<float> slots;
+    std::vector<float> ruleHeld;
+};
+
+#endif // !CERTAINTY_RANKING_H
@@ -6,6 +6,7 @@
 #define INT 1
 #define STRING 2
 #define FLOAT 3
+#define EXPRESSION 4  // a premise using | ! or ( ), named by its text; see ExpressionPool
 
 /**
  * ClauseItem - Represents either a premise or a conclusion (or both). 
@@ -22,6 +23,7 @@ public:
     ClauseItem();
     ClauseItem(std::string nameP, std::string valueP, int typeP);
     void operator=(const ClauseItem& srcClause);
+    std::string describe() const;
 
 };
 
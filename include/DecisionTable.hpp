@@ -0,0 +1,107 @@
+#ifndef DECISION_TABLE_H
+#define DECISION_TABLE_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "FactProvider.hpp"
+#include "KnowledgeBase.hpp"
+#include "RuleBytecode.hpp"
+#include "RuleStrata.hpp"
+#include "ThreadPool.hpp"
+#include "VariableListItem.hpp"
+
+/**
+ * DecisionTable - Every way a goal can be solved, worked out ahead of time.
+ * The answer space is enumerated by running the reference engine on an
+ * assignment until it asks a question not yet answered, then trying both
+ * y and n; variables the engine never asks on a path are never branched
+ * on. Branches run in parallel on a thread pool. The result is a decision
+ * tree, flattened into fixed size nodes, whose leaves hold what solveGoal
+ * returned, so answering from the table takes one node per question and
+ * no chaining at all. Every leaf is also solved by IterativeBackChain and
+ * BytecodeBackChain and forward chained, a queue at a time and a level at
+ * a time, and any disagreement between the engines is recorded.
+ */
+class DecisionTable
+{
+public:
+    // Returned by lookup when the answer to a question on the path is
+    // missing, or neither y nor n.
+    static const int MISSING_ANSWER = -2;
+
+    // A leaf on which the engines disagreed.
+    struct Mismatch
+    {
+        std::vector<std::pair<std::string, std::string> > answers;  // the path, in the order asked
+        std::string detail;
+    };
+
+    bool build(const std::string& goalP, KnowledgeBase& knowledgeBase,
+               const std::vector<VariableListItem>& variableList, ThreadPool& pool, int maxLeaves);
+    int lookup(const FactValues& answers, std::string& missing) const;
+    void save(const std::string& fileName) const;
+    void load(const std::string& fileName);
+    void displaySummary(std::ostream& out) const;
+
+    std::string goal;
+    unsigned long long version = 0;             // KnowledgeBase::version of the table
+    std::vector<std::string> variables;         // the variables asked somewhere, by node variable
+    std::vector<Mismatch> mismatches;
+    int leafCount = 0;
+
+private:
+    // A node is a question with its y and n children, or a leaf holding the
+    // result (variable -1, result in yes).
+    struct Node
+    {
+        int variable;
+        int yes;
+        int no;
+    };
+
+    // The tree while it is being enumerated.
+    struct Branch
+    {
+        int variable = 0;       // variable list index of the question, 0 for a leaf
+        int result = 0;
+        std::unique_ptr<Branch> yes;
+        std::unique_ptr<Branch> no;
+    };
+
+    // What a build shares between its tasks.
+    struct Enumeration
+    {
+        Enumeration(KnowledgeBase& knowledgeBaseP, const std::vector<VariableListItem>& variableListP,
+                    ThreadPool& poolP, int maxLeavesP)
+            : knowledgeBase(knowledgeBaseP), variableList(variableListP), pool(poolP), maxLeaves(maxLeavesP), leaves(0)
+        {
+            ruleStrata.build(knowledgeBase);
+            program.build(knowledgeBase);
+        }
+
+        KnowledgeBase& knowledgeBase;
+        const std::vector<VariableListItem>& variableList;
+        ThreadPool& pool;
+        int maxLeaves;
+        RuleStrata ruleStrata;
+        RuleBytecode program;   // shared read only by the BytecodeBackChain of every leaf
+        std::atomic<int> leaves;
+        std::mutex lock;        // guards mismatches
+    };
+
+    void explore(Enumeration& enumeration, Branch& branch, const std::vector<std::pair<int, std::string> >& answers);
+    void checkLeaf(Enumeration& enumeration, const std::vector<std::pair<int, std::string> >& answers, int location,
+                   const std::vector<VariableListItem>& solvedVariables,
+                   const std::vector<VariableListItem>& solvedConclusions);
+    int flatten(const Branch& branch, const std::vector<VariableListItem>& variableList, std::vector<int>& variableIds);
+
+    std::vector<Node> nodes;    // node 0 is the root
+};
+
+#endif // !DECISION_TABLE_H
@@ -0,0 +1,101 @@
+#ifndef EXPRESSION_POOL_H
+#define EXPRESSION_POOL_H
+
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ClauseItem.hpp"
+
+/**
+ * ExpressionPool - The premises of a knowledge base that are more than a
+ * plain name = value test, i.e. that use | (OR), ! (NOT) or parentheses.
+ * Every such premise is kept in one normalized form: NOT is pushed down to
+ * the tests (name != value), nested ANDs and ORs are flattened, repeated
+ * operands are dropped and a group of one is replaced by its operand, all
+ * without changing the order of the operands, so the questions are asked in
+ * the order the KB lists them. Nodes are hash consed: a test or group used
+ * by several rules is stored once, and each premise is a node id found by
+ * its canonical text, which is also what the premise list keeps as its
+ * name (see KnowledgeBase::arePremisesGood).
+ */
+class ExpressionPool
+{
+public:
+    enum Kind
+    {
+        LEAF = 0,   // name = value, or name != value
+        AND,
+        OR
+    };
+
+    struct Node
+    {
+        Kind kind;
+        bool isNegated;             // LEAF only
+        ClauseItem clause;          // LEAF only, the name and value tested
+        std::vector<int> operands;  // AND and OR only, in KB order
+        std::vector<int> leaves;    // every distinct LEAF below, in KB order
+    };
+
+    ExpressionPool();
+
+    static bool parsePremises(const std::string& premiseText, std::vector<ClauseItem>& premiseList);
+
+    int compile(const std::string& expressionText);
+    int find(const std::string& expressionText) const;
+    const Node& node(int id) const;
+    int size() const;
+    int expressionCount() const;
+
+    /**
+     * Member Function | ExpressionPool | evaluate
+     *
+     * Summary: Evaluates a node left to right, stopping an AND at the first
+     *          operand that fails and an OR at the first one that holds, so
+     *          only the tests needed are asked for.
+     *
+     * @param int id: The node, from compile or find.
+     * @param LeafTest leafTest: Called with each LEAF node reached; returns
+     *          whether it holds, negation included.
+     *
+     * @return bool: Whether the node holds.
+     */
+    template <typename LeafTest>
+    bool evaluate(int id, const LeafTest& leafTest) const
+    {
+        const Node& expression = nodes.at(id);
+        if (expression.kind == LEAF)
+        {
+            return leafTest(expression);
+        }
+
+        for (int operandIter = 0; operandIter < expression.operands.size(); operandIter++)
+        {
+            bool holds = evaluate(expression.operands.at(operandIter), leafTest);
+            if (holds != (expression.kind == AND))
+            {
+                return holds;
+            }
+        }
+        return expression.kind == AND;
+    }
+
+private:
+    struct Term;
+
+    static bool parse(const std::string& text, Term& term);
+    static bool parseTerm(const std::string& text, size_t& position, int depth, int precedence, Term& term);
+    static Term normalize(const Term& term, bool isNegated);
+    static std::string render(const Term& term);
+    int intern(const Term& term);
+
+    // A deque, so nodes never move while a caller evaluates one and the KB
+    // grows (e.g. a shard is paged in).
+    std::deque<Node> nodes;
+    std::unordered_map<std::string, int> nodeIds;        // structure -> node
+    std::unordered_map<std::string, int> expressionIds;  // canonical text -> node
+};
+
+#endif // !EXPRESSION_POOL_H
@@ -0,0 +1,73 @@
+#ifndef FACT_PROVIDER_H
+#define FACT_PROVIDER_H
+
+#include <future>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "VariableListItem.hpp"
+
+// Values by variable name.
+typedef std::map<std::string, std::string> FactValues;
+
+/**
+ * FactProvider - Supplies the values of variables that back chaining needs
+ * and does not know yet, in place of prompting on the console. Embedders
+ * implement it over whatever holds their facts (a form, telemetry, a test
+ * fixture). Providers behind a round trip should also implement
+ * requestFacts: when a goal is solved, the engine asks for every variable
+ * the goal's rules might need in one request, carries on while it is in
+ * flight, and only waits for it when the first value is actually needed.
+ */
+class FactProvider
+{
+public:
+    virtual ~FactProvider() {}
+
+    // Starts fetching many variables at once. The result holds the values
+    // that were available; the engine falls back to provideFact for the
+    // rest. The default returns no future, which means batches are not
+    // supported and every value is fetched with provideFact.
+    virtual std::future<FactValues> requestFacts(const std::vector<VariableListItem>&)
+    {
+        return std::future<FactValues>();
+    }
+
+    // Returns false when the value is not available; the variable then
+    // stays unknown and the premise that needed it does not hold.
+    virtual bool provideFact(const VariableListItem& variable, std::string& value) = 0;
+};
+
+/**
+ * NoFactProvider - Answers nothing. Stands in where a session must never
+ * read std::cin (an embedded session, a batch case, a shard worker's
+ * session): a value the session was not given stays unknown.
+ */
+class NoFactProvider : public FactProvider
+{
+public:
+    bool provideFact(const VariableListItem&, std::string&) { return false; }
+};
+
+/**
+ * FirstQuestion - Answers nothing, and remembers the first variable asked
+ * for, so a solve runs out without asking anything else and the caller
+ * learns where it would have prompted (see Speculation and DecisionTable).
+ */
+class FirstQuestion : public FactProvider
+{
+public:
+    bool provideFact(const VariableListItem& variable, std::string&)
+    {
+        if (question.empty())
+        {
+            question = variable.name;
+        }
+        return false;
+    }
+
+    std::string question;   // empty if nothing was asked for
+};
+
+#endif // !FACT_PROVIDER_H
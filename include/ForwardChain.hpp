@@ -1,19 +1,29 @@
 #ifndef FORWARD_CHAIN_H
 #define FORWARD_CHAIN_H
 
+#include <functional>
+#include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 #include <queue>
+#include <set>
+#include <utility>
 
 #include "Statement.hpp"
 #include "VariableListItem.hpp"
 #include "ClauseItem.hpp"
 #include "KnowledgeBase.hpp"
+#include "InferenceBudget.hpp"
+#include "RelevanceSlice.hpp"
+#include "RuleStrata.hpp"
+#include "ThreadPool.hpp"
 
 class ForwardChain
 {
 public:
-    void runForwardChaining();
+    explicit ForwardChain(KnowledgeBase* sharedRuleSystem = nullptr);
+    ClauseItem runForwardChaining(std::ostream& log = std::cout);
     void copyVariableList(const std::vector<VariableListItem>& srcVariableList);
     void copyKnowledgeBase(const KnowledgeBase& srcKnowledgeBase);
     int getMatchingVariableListEntry(std::string entryName);
@@ -21,13 +31,35 @@ public:
     
     std::queue<ClauseItem> conclusionVariableQueue;
 
-    KnowledgeBase ruleSystem;
+    // Limits on the work of each runForwardChaining call, see BackChain.
+    InferenceBudget budget;
+
+    // When both are set, and the levels are those of this KB, the rules are
+    // tried a level at a time on the pool instead of from the queue. The
+    // conclusions reached are the same. Only the budget's deadline applies.
+    ThreadPool* threadPool = nullptr;
+    const RuleStrata* ruleStrata = nullptr;
+
+    // When set, only the rules that can contribute to the slice's goal are
+    // tried; the others are never fired.
+    const RelevanceSlice* relevanceSlice = nullptr;
+
+private:
+    // Only set when the knowledge base is not shared, see BackChain.
+    std::unique_ptr<KnowledgeBase> ownedRuleSystem;
+
+public:
+    KnowledgeBase& ruleSystem;
     std::vector<VariableListItem> variableList;
 
 private:
     void processStatementIndex(int variableListEntry);
     bool instantiatePremiseClause(const ClauseItem& clause);
+    bool isExpressionLeafTrue(const ExpressionPool::Node& leaf);
     bool processPremiseList(std::vector<ClauseItem>& premiseList);
+    ClauseItem runLevelParallel(int initialRepairEntry, std::ostream& log);
+    bool isRuleReady(int statement, const std::set<std::pair<std::string, std::string> >& facts,
+                     const std::set<std::string>& reachedNames) const;
 };
 
 #endif // !FORWARD_CHAIN_H
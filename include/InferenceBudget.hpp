@@ -0,0 +1,84 @@
+#ifndef INFERENCE_BUDGET_H
+#define INFERENCE_BUDGET_H
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+#define DEADLINE_CHECK_INTERVAL 64  // premise checks between clock reads, must be a power of two
+
+/**
+ * InferenceBudget - Limits on the work one request may do: rule evaluations,
+ * premise checks and wall clock time (including time spent waiting for
+ * answers). A limit of 0 means none. The engines charge the budget as they
+ * go, with an increment and a compare on the hot path and a clock read every
+ * DEADLINE_CHECK_INTERVAL premise checks. Once a limit is reached the budget
+ * is stopped, the engines unwind without proving anything more, and the
+ * request returns what was proven so far with the reason it stopped.
+ */
+class InferenceBudget
+{
+public:
+    enum StopReason
+    {
+        NOT_STOPPED = 0,
+        RULE_LIMIT,         // maxRuleEvaluations rules were tried
+        PREMISE_LIMIT,      // maxPremiseChecks premises were checked
+        DEADLINE            // timeLimitMilliseconds passed
+    };
+
+    struct Limits
+    {
+        Limits() : maxRuleEvaluations(0), maxPremiseChecks(0), timeLimitMilliseconds(0) {}
+
+        long maxRuleEvaluations;
+        long maxPremiseChecks;
+        long timeLimitMilliseconds;
+    };
+
+    InferenceBudget();
+
+    void start();
+
+    bool chargeRule()
+    {
+        ruleEvaluations++;
+        if (limits.maxRuleEvaluations > 0 && ruleEvaluations > limits.maxRuleEvaluations)
+        {
+            stop(RULE_LIMIT);
+        }
+        return !isStopped();
+    }
+
+    bool chargePremise()
+    {
+        premiseChecks++;
+        if (limits.maxPremiseChecks > 0 && premiseChecks > limits.maxPremiseChecks)
+        {
+            stop(PREMISE_LIMIT);
+        }
+        else if (hasDeadline && (premiseChecks & (DEADLINE_CHECK_INTERVAL - 1)) == 0)
+        {
+            checkDeadline();
+        }
+        return !isStopped();
+    }
+
+    bool checkDeadline();
+    bool isStopped() const { return stopReason.load(std::memory_order_relaxed) != NOT_STOPPED; }
+    StopReason getStopReason() const { return (StopReason)stopReason.load(std::memory_order_relaxed); }
+    std::string describe() const;
+    void stop(StopReason reason);
+
+    Limits limits;
+    long ruleEvaluations;
+    long premiseChecks;
+
+private:
+    // Atomic so that the workers of ParallelBackChain can stop it too.
+    std::atomic<int> stopReason;
+    bool hasDeadline;
+    std::chrono::steady_clock::time_point deadline;
+};
+
+#endif // !INFERENCE_BUDGET_H
@@ -0,0 +1,107 @@
+#ifndef INFERENCE_ENGINE_H
+#define INFERENCE_ENGINE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BackChain.hpp"
+#include "ClauseItem.hpp"
+#include "FactProvider.hpp"
+#include "InferenceBudget.hpp"
+#include "KnowledgeBase.hpp"
+#include "PartialMatch.hpp"
+#include "CertaintyRanking.hpp"
+#include "VariableListItem.hpp"
+
+/**
+ * InferenceEngine.hpp - The interface for embedding the engine in another
+ * program. A KnowledgeHandle loads a knowledge base and variable list once,
+ * without any console output or pause; any number of InferenceSessions,
+ * on any threads, then solve against it without copying it. Sessions take
+ * their facts from setFact and a FactProvider instead of std::cin, and
+ * return structured results instead of printing them.
+ */
+
+// What solving one goal came to.
+struct InferenceResult
+{
+    enum Status
+    {
+        PROVEN,             // a statement concluding the goal holds
+        INCONCLUSIVE,       // the goal is a conclusion but no statement for it holds
+        NOT_A_CONCLUSION,   // no statement concludes the goal
+        STOPPED             // the budget ran out first; see stopReason
+    };
+
+    Status status;
+    InferenceBudget::StopReason stopReason;           // NOT_STOPPED unless STOPPED
+    std::string goal;
+    std::string value;                                // the proven value, empty unless PROVEN
+    int statement;                                    // kBase index of the proving statement, 0 unless PROVEN
+    std::vector<int> proof;                           // statements of the proof, goal first
+    std::vector<ClauseItem> intermediateConclusions;  // conclusions proven on the way, in order
+    int questionsAsked;                               // values the solve needed from the fact provider
+    int providerRequests;                             // round trips to the provider, a batch counting once
+    bool isCached;                                    // answered from the session's result cache
+    long ruleEvaluations;                             // work done, as charged to the budget
+    long premiseChecks;
+};
+
+/**
+ * KnowledgeHandle - A loaded knowledge base and variable list. It is never
+ * changed once loaded, so sessions on several threads can share it.
+ */
+class KnowledgeHandle
+{
+public:
+    static std::shared_ptr<KnowledgeHandle> load(const std::string& knowledgeBaseFile, const std::string& variableListFile);
+
+    const KnowledgeBase& knowledgeBase() const;
+    const std::vector<VariableListItem>& variables() const;
+
+private:
+    friend class InferenceSession;
+    friend class KnowledgeRegistry;
+
+    KnowledgeHandle() {}
+
+    KnowledgeBase ruleSystem;
+    std::vector<VariableListItem> variableList;
+};
+
+/**
+ * InferenceSession - The working memory of one diagnosis: the facts given
+ * or provided so far and the conclusions proven from them. A session is
+ * used by one thread at a time.
+ */
+class InferenceSession
+{
+public:
+    explicit InferenceSession(std::shared_ptr<KnowledgeHandle> handleP, FactProvider* factProviderP = nullptr,
+                              bool isIterative = false);
+
+    bool setFact(const std::string& name, const std::string& value);
+    InferenceResult solve(const std::string& goal, const InferenceBudget::Limits& limits = InferenceBudget::Limits());
+    std::vector<InferenceResult> solveAll(const std::vector<std::string>& goals = std::vector<std::string>(),
+                                          const InferenceBudget::Limits& limits = InferenceBudget::Limits());
+    ClauseItem recommend(const InferenceBudget::Limits& limits = InferenceBudget::Limits(),
+                         InferenceBudget::StopReason* stopReason = nullptr);
+    std::vector<PartialMatch::Candidate> rankCandidates(const std::string& goal, int count);
+    std::vector<CertaintyRanking::Candidate> rankByCertainty(const std::string& goal, int count);
+    int correctFact(const std::string& name, const std::string& value);
+    void reset();
+
+    std::string checkpoint() const;
+    bool restore(const std::string& checkpointP);
+
+    void setFactProvider(FactProvider* factProviderP);
+    void setResultCache(ResultCache* resultCache);
+
+private:
+    std::shared_ptr<KnowledgeHandle> handle;
+    std::unique_ptr<BackChain> backChain;
+    NoFactProvider noFactProvider;     // stands in when no provider is set
+};
+
+#endif // !INFERENCE_ENGINE_H
@@ -0,0 +1,68 @@
+#ifndef INFERENCE_TRACE_H
+#define INFERENCE_TRACE_H
+
+#include <atomic>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "KnowledgeBase.hpp"
+
+#define TRACE_RING_SIZE 16384  // events kept per thread, must be a power of two
+
+/**
+ * InferenceTrace - Structured trace of what the engines do, kept in a fixed
+ * size ring buffer per thread. Each thread only ever writes its own ring,
+ * without locks; readers take a snapshot and discard any slot overwritten
+ * while it was being copied. While tracing is off, record() is a single
+ * relaxed load and a branch.
+ *
+ * Events refer to statements and premises by KB index, so a trace is only
+ * meaningful against the KB version it was taken with.
+ */
+class InferenceTrace
+{
+public:
+    enum EventType
+    {
+        GOAL_PUSHED = 1,     // statement/premise whose premise became a sub goal; 0 for the user's goal
+        RULE_TRIED,          // statement whose premises are about to be checked
+        PREMISE_FAILED,      // statement/premise that did not hold
+        FACT_ASSERTED,       // statement/premise whose variable was answered; flag: answer matched
+        RULE_FIRED           // statement whose premises all held
+    };
+
+    struct Event
+    {
+        unsigned long long sequence;
+        unsigned int thread;
+        EventType type;
+        int statement;
+        int premise;
+        int flag;
+    };
+
+    static void enable(bool isOn);
+    static void muteThisThread(bool isMuted);
+    static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+    static void record(EventType type, int statement, int premise = 0, int flag = 0)
+    {
+        if (isEnabled())
+        {
+            append(type, statement, premise, flag);
+        }
+    }
+
+    static void clear();
+    static std::vector<Event> snapshot();
+    static void explain(const std::vector<Event>& events, const KnowledgeBase& knowledgeBase, std::ostream& out);
+    static void writeLog(const std::string& fileName, const std::vector<Event>& events, unsigned long long knowledgeBaseVersion);
+    static std::vector<Event> readLog(const std::string& fileName, unsigned long long& knowledgeBaseVersion);
+
+private:
+    static void append(EventType type, int statement, int premise, int flag);
+
+    static std::atomic<bool> enabled;
+};
+
+#endif // !INFERENCE_TRACE_H
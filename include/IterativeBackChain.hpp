@@ -0,0 +1,58 @@
+#ifndef ITERATIVE_BACK_CHAIN_H
+#define ITERATIVE_BACK_CHAIN_H
+
+#include <string>
+#include <vector>
+
+#include "BackChain.hpp"
+
+/**
+ * IterativeBackChain - Backward chaining with an explicit goal stack. Gives
+ * the same answers, prompts and intermediate conclusions as BackChain, but
+ * each level of intermediate conclusion is a frame in a preallocated buffer
+ * instead of a native stack frame, so deep rule chains cannot overflow the
+ * stack. OR/NOT premises are evaluated on the same stack, a frame per
+ * expression node, so nothing recurses natively. Chains of more than
+ * maxDepth goals, counted over the whole stack, are treated as unproven.
+ */
+class IterativeBackChain : public BackChain
+{
+public:
+    explicit IterativeBackChain(int maxDepthP = 4096, KnowledgeBase* sharedRuleSystem = nullptr);
+
+    int maxDepth;
+    bool isDepthExceeded;
+
+protected:
+    int findValidConclusionInStatements(std::string conclusionName, int startingIndex, std::string stringToMatch) override;
+
+private:
+    // One goal being solved, or one node of an OR/NOT premise being
+    // evaluated. Names and values point into the knowledge base (or the
+    // caller's arguments for the bottom frame), so nothing is copied.
+    struct GoalFrame
+    {
+        const std::string* name;
+        const std::string* value;
+        int statement;      // candidate statement currently being tried
+        int premise;        // premise of that statement being solved, 0 while searching
+        bool isConclusion;  // some statement concluded this name
+        int premisePrompts; // prompt count when the current premise was started
+
+        int node;           // ExpressionPool node, -1 for a goal
+        int operand;        // next operand of the node; for a LEAF, 1 once its name is being solved
+        bool hasResult;     // result holds what the last operand, or the LEAF's goal, came to
+        int result;
+    };
+
+    void pushGoal(const std::string* name, const std::string* value, int startingIndex);
+    void pushNode(int node);
+    void stepNode();
+    void finishNode(bool holds);
+    void resolvePremise(int conclusionLocation);
+
+    std::vector<GoalFrame> goalStack;
+    int goalDepth;      // goal frames on goalStack, nodes not counted
+};
+
+#endif // !ITERATIVE_BACK_CHAIN_H
@@ -0,0 +1,73 @@
+#ifndef KNOWLEDGE_ANALYZER_H
+#define KNOWLEDGE_ANALYZER_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <utility>
+
+#include "KnowledgeBase.hpp"
+#include "VariableListItem.hpp"
+
+/**
+ * KnowledgeAnalyzer - Static checks over a loaded knowledge base. Builds the
+ * rule dependency graph (conclusion variable -> rules that conclude it ->
+ * premise variables) and reports rules that can never fire, rules that are
+ * shadowed by an earlier rule, and conclusion cycles that would make back
+ * chaining recurse without end. Optionally removes the offending rules.
+ */
+class KnowledgeAnalyzer
+{
+public:
+    // The kinds of problems the analyzer reports.
+    enum FindingKind
+    {
+        UNKNOWN_VARIABLE,     // premise variable is neither a conclusion nor in the variable list
+        CONTRADICTORY_RULE,   // same variable required to hold two different values
+        DEAD_RULE,            // premise value that no live rule can ever conclude
+        DUPLICATE_RULE,       // identical to an earlier rule
+        SUBSUMED_RULE,        // an earlier rule with the same conclusion needs a subset of the premises
+        CYCLIC_RULE           // closes a conclusion cycle
+    };
+
+    struct Finding
+    {
+        FindingKind kind;
+        int statement;          // kBase index of the offending rule
+        int relatedStatement;   // kBase index of the rule it clashes with, 0 when none
+        std::string detail;
+    };
+
+    KnowledgeAnalyzer(const KnowledgeBase& knowledgeBaseP, const std::vector<VariableListItem>& variableListP);
+    void analyze();
+    void displayReport() const;
+    int pruneKnowledgeBase(KnowledgeBase& target) const;
+
+    std::vector<Finding> findings;
+
+    // Conclusion name -> kBase indices of the rules concluding it, in KB order.
+    std::map<std::string, std::vector<int> > conclusionIndex;
+
+private:
+    typedef std::vector<std::pair<std::string, std::string> > PremiseKey;
+
+    void buildDependencyGraph();
+    void findUnknownAndContradictoryPremises();
+    void findDeadRules();
+    void findDuplicateAndSubsumedRules();
+    void findCycles();
+    bool visitConclusion(const std::string& conclusionName, std::map<std::string, int>& visitState,
+                         std::vector<std::string>& path);
+    void addFinding(FindingKind kind, int statement, int relatedStatement, const std::string& detail);
+    std::vector<std::string> namesTested(const std::pair<std::string, std::string>& premise) const;
+    std::string describeStatement(int statement) const;
+    static const char* kindName(FindingKind kind);
+
+    const KnowledgeBase& knowledgeBase;
+    const std::vector<VariableListItem>& variableList;
+
+    std::vector<PremiseKey> premiseKeys;   // sorted, de-duplicated premises per statement; an OR/NOT premise is (its text, "")
+    std::vector<bool> isFlagged;           // statement already has a finding that makes it prunable
+};
+
+#endif // !KNOWLEDGE_ANALYZER_H
@@ -6,6 +6,7 @@
 #include <set>
 
 #include "ClauseItem.hpp"
+#include "ExpressionPool.hpp"
 #include "Statement.hpp"
 
 
@@ -15,13 +16,27 @@ public:
     KnowledgeBase();  // Constructor
     void displayBase();  // Display Entire KnowledgeBase
     void populateKnowledgeBase(std::string fileName);
+    void populateKnowledgeBaseParallel(std::string fileName, int threadCount);
+    int appendKnowledgeBase(std::string fileName);
+    void updateVersion();  // rehash kBase after any change to it
+    std::vector<std::string> premiseNamesReachableFrom(const std::string& goal) const;
+    std::vector<ClauseItem> premiseTests(const ClauseItem& premise) const;
+    std::string finalConclusion() const;  // the one conclusion no premise tests, if there is one
     std::string getConclusion(unsigned int);  //  get a conclusion from index provided
     std::string getPremise(unsigned int, unsigned int);  // first UI is kBase index, second is premise index  
     std::vector<Statement> kBase;
     std::set<std::string> conclusionSet;
+    unsigned long long version;  // hash of the statements, see updateVersion
+    unsigned long long resultVersion;  // changes when a goal solved before may now solve differently
+    ExpressionPool expressions;  // the EXPRESSION premises, compiled by updateVersion
 private:
-    bool isConclusionGood(Statement&, std::string, std::string&);
-    bool arePremisesGood(Statement&, std::string);
+    void foldStatements(unsigned int first);  // hash and compile kBase from first on
+    unsigned int hashedCount;  // statements folded into version
+    std::set<std::string> premiseNameSet;  // names tested by a premise of a folded statement
+    std::set<std::string> ruleConclusionSet;  // names concluded by a folded statement
+    bool isConclusionGood(Statement&, std::string, std::string&) const;
+    bool arePremisesGood(Statement&, std::string) const;
+    void displayLoadSummary(int total_good, int total_bad);
 };
 
 
@@ -0,0 +1,79 @@
+#ifndef KNOWLEDGE_REGISTRY_H
+#define KNOWLEDGE_REGISTRY_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "InferenceEngine.hpp"
+
+/**
+ * SymbolPool - Every distinct string once, numbered in the order first
+ * interned. A symbol's text never moves, and is never freed before the pool.
+ */
+class SymbolPool
+{
+public:
+    unsigned int intern(const std::string& text);
+    const std::string& text(unsigned int symbol) const;
+    int size() const;
+    long bytes() const;
+
+private:
+    struct TextHash
+    {
+        size_t operator()(const std::string* text) const { return std::hash<std::string>()(*text); }
+    };
+    struct TextEqual
+    {
+        bool operator()(const std::string* left, const std::string* right) const { return *left == *right; }
+    };
+
+    std::vector<std::unique_ptr<std::string> > symbols;
+    std::unordered_map<const std::string*, unsigned int, TextHash, TextEqual> symbolIds;
+};
+
+/**
+ * KnowledgeRegistry - The knowledge bases of many vehicle models in one
+ * process, each under a key. A model is kept as an image of symbol numbers
+ * into a pool shared by all of them, so a name, value or prompt used by
+ * every model is stored once, and models whose KB and variable list are the
+ * same share one image. A model is only expanded into a KnowledgeHandle
+ * while sessions hold it; sessions on models with the same image share the
+ * expansion.
+ */
+class KnowledgeRegistry
+{
+public:
+    void add(const std::string& key, const std::string& knowledgeBaseFile, const std::string& variableListFile);
+    std::shared_ptr<KnowledgeHandle> handle(const std::string& key);
+    std::vector<std::string> keys() const;
+    void displayStatistics(std::ostream& out) const;
+
+private:
+    // A statement is its premise list size, then the symbols and type of
+    // its conclusion, its certainty in millionths, and the symbols and type
+    // of each premise list entry; a variable is its
+    // name, description and type. The Empty entries at index 0 are not kept.
+    struct Image
+    {
+        unsigned long long version;
+        std::vector<unsigned int> statements;
+        std::vector<unsigned int> variables;
+        std::weak_ptr<KnowledgeHandle> expansion;
+    };
+
+    std::shared_ptr<Image> compact(const KnowledgeHandle& handleP);
+    std::shared_ptr<KnowledgeHandle> expand(const Image& image) const;
+
+    mutable std::mutex lock;
+    SymbolPool symbolPool;
+    std::map<std::string, std::shared_ptr<Image> > models;
+    std::vector<std::shared_ptr<Image> > images;    // the distinct images
+};
+
+#endif // !KNOWLEDGE_REGISTRY_H
@@ -0,0 +1,46 @@
+#ifndef KNOWLEDGE_SHARDS_H
+#define KNOWLEDGE_SHARDS_H
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "KnowledgeBase.hpp"
+
+/**
+ * KnowledgeShards - A knowledge base split offline into one shard file per
+ * conclusion variable, plus a small manifest naming each shard and the
+ * conclusion variables its premises depend on. At run time only the
+ * manifest is read; the shards a goal can reach are loaded when the goal is
+ * asked for, and any other shard is paged in the first time back chaining
+ * looks for its conclusion.
+ */
+class KnowledgeShards
+{
+public:
+    static void partition(const KnowledgeBase& knowledgeBase, const std::string& directoryP);
+    static std::string formatStatement(const Statement& statement);
+
+    void loadManifest(const std::string& directoryP, KnowledgeBase& knowledgeBase);
+    void ensureGoalLoaded(const std::string& goal, KnowledgeBase& knowledgeBase);
+    void ensureLoaded(const std::string& conclusionName, KnowledgeBase& knowledgeBase);
+    void displayUsage() const;
+    std::vector<std::pair<std::string, int> > shardSizes() const;
+
+private:
+    struct ShardEntry
+    {
+        std::string fileName;
+        int ruleCount;
+        std::vector<std::string> dependencies;
+        bool isLoaded;
+    };
+
+    std::map<std::string, ShardEntry> shards;
+    std::string directory;
+    int totalRules = 0;
+    int loadedRules = 0;
+};
+
+#endif // !KNOWLEDGE_SHARDS_H
@@ -0,0 +1,41 @@
+#ifndef MOCK_FACT_PROVIDER_H
+#define MOCK_FACT_PROVIDER_H
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "FactProvider.hpp"
+#include "VariableListItem.hpp"
+
+/**
+ * MockFactProvider - A local stand-in for a remote fact store, for tests and
+ * benchmarks of embedded sessions. Facts are set up front, in code or from a
+ * facts file, and every request, single or batched, costs the same simulated
+ * round trip. Batches are served on a thread of their own. Facts must not be
+ * changed while a session is solving with the provider.
+ */
+class MockFactProvider : public FactProvider
+{
+public:
+    explicit MockFactProvider(int latencyMillisecondsP = 0);
+
+    void setFact(const std::string& name, const std::string& value);
+    int loadFacts(const std::string& fileName);
+
+    bool provideFact(const VariableListItem& variable, std::string& value);
+    std::future<FactValues> requestFacts(const std::vector<VariableListItem>& variables);
+
+    int getRequestCount() const;
+    int getFactsServed() const;
+
+private:
+    FactValues lookup(const std::vector<std::string>& names);
+
+    int latencyMilliseconds;
+    FactValues facts;
+    std::atomic<int> requestCount;
+    std::atomic<int> factsServed;
+};
+
+#endif // !MOCK_FACT_PROVIDER_H
@@ -0,0 +1,66 @@
+#ifndef PARALLEL_BACK_CHAIN_H
+#define PARALLEL_BACK_CHAIN_H
+
+#include <atomic>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "BackChain.hpp"
+#include "ThreadPool.hpp"
+
+/**
+ * ParallelBackChain - OR-parallel backward chaining for sessions whose facts
+ * are all known up front (see BackChain::loadFacts). The alternative rules
+ * for a goal are independent, so they are spread over a work stealing pool,
+ * and so are the alternatives of every sub goal they need. Once a rule
+ * proves the goal, the alternatives after it in KB order are cancelled; the
+ * ones before it still finish, so the answer is always the first rule in KB
+ * order that holds, exactly as in BackChain.
+ *
+ * Nothing is prompted for. A variable that is not instantiated simply does
+ * not match.
+ */
+class ParallelBackChain : public BackChain
+{
+public:
+    explicit ParallelBackChain(int threadCount, int maxDepthP = 4096, KnowledgeBase* sharedRuleSystem = nullptr);
+
+    int maxDepth;
+
+protected:
+    int findValidConclusionInStatements(std::string conclusionName, int startingIndex, std::string stringToMatch) override;
+
+private:
+    // Cancellation flags form a chain, one link per level of alternatives,
+    // so cancelling an alternative also stops every sub goal it started.
+    struct CancelToken
+    {
+        CancelToken() : isCancelled(false), parent(nullptr) {}
+        bool isSet() const;
+
+        std::atomic<bool> isCancelled;
+        const CancelToken* parent;
+    };
+
+    // A premise proven as an intermediate conclusion, and the statement that proved it.
+    typedef std::vector<std::pair<const ClauseItem*, int> > ProvenList;
+
+    void buildIndexes();
+    int proveGoal(const std::string& name, const std::string& value, int startingIndex, int depth,
+                  const CancelToken& token, ProvenList& proven);
+    bool proveStatement(int statement, int depth, const CancelToken& token, ProvenList& proven);
+    bool proveLeaf(const ExpressionPool::Node& leaf, int depth, const CancelToken& token, ProvenList& proven);
+
+    ThreadPool pool;
+
+    // Statements by conclusion name, rebuilt only when KnowledgeBase::version
+    // changes; the facts change from goal to goal and are indexed per call.
+    std::unordered_map<std::string, std::vector<int> > conclusionIndex;
+    bool isConclusionIndexBuilt = false;
+    unsigned long long conclusionIndexVersion = 0;
+    std::unordered_map<std::string, const std::string*> factIndex;
+};
+
+#endif // !PARALLEL_BACK_CHAIN_H
@@ -0,0 +1,86 @@
+#ifndef PARTIAL_MATCH_H
+#define PARTIAL_MATCH_H
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ClauseItem.hpp"
+#include "KnowledgeBase.hpp"
+#include "VariableListItem.hpp"
+
+/**
+ * PartialMatch - Ranks every rule for a goal by how close the session's
+ * facts come to it, for when no rule for the goal holds. Each distinct
+ * "name = value" premise is given a bit. A rule's premises are flattened,
+ * a premise on a conclusion proven by exactly one rule being replaced by
+ * that rule's premises, and kept as a sparse bitset: the words that have a
+ * bit set and their masks, packed for all rules into one array. The facts
+ * become two dense bitsets, the premises they satisfy and the premises they
+ * contradict (another value of the same variable is known), so scoring a
+ * rule is a popcount of a few ANDed words. The index is built per goal and
+ * rebuilt when the KB version changes.
+ */
+class PartialMatch
+{
+public:
+    struct Candidate
+    {
+        int statement;                              // kBase index of the rule
+        int satisfied;                              // premises the facts satisfy
+        int contradicted;                           // premises the facts contradict
+        int premiseCount;                           // premises after flattening
+        std::vector<ClauseItem> confirmingPremises; // the unknown ones, the questions that would confirm it
+    };
+
+    std::vector<Candidate> rank(const std::string& goal, int count, const KnowledgeBase& knowledgeBase,
+                                const std::vector<VariableListItem>& variableList,
+                                const std::vector<VariableListItem>& intermediateConclusionList);
+    static void display(const std::vector<Candidate>& candidates, const KnowledgeBase& knowledgeBase,
+                        const std::vector<VariableListItem>& variableList, std::ostream& out);
+
+private:
+    // One word of a rule's sparse premise bitset.
+    struct MaskWord
+    {
+        int word;
+        uint64_t mask;
+    };
+
+    // The score of one rule, by its position in rules.
+    struct RuleScore
+    {
+        int rule;
+        int satisfied;
+        int contradicted;
+        int premiseCount;
+    };
+
+    void build(const std::string& goal, const KnowledgeBase& knowledgeBase);
+    void flattenPremises(const std::vector<ClauseItem>& premiseList, const KnowledgeBase& knowledgeBase,
+                         const std::map<std::pair<std::string, std::string>, std::vector<int> >& rulesByConclusion,
+                         int depth, std::vector<int>& bits);
+    int bitFor(const std::string& name, const std::string& value, int type = STRING);
+    void markKnown(const std::string& name, const std::string& value);
+
+    std::string builtGoal;
+    unsigned long long builtVersion = 0;
+
+    std::vector<ClauseItem> atoms;                             // by bit
+    std::map<std::pair<std::string, std::string>, int> bitByAtom;
+    std::map<std::string, std::vector<int> > bitsByName;
+
+    std::vector<int> rules;             // kBase indexes of the goal's rules
+    std::vector<int> ruleStart;         // rule i's words are maskWords[ruleStart[i], ruleStart[i + 1])
+    std::vector<int> rulePremiseCount;
+    std::vector<MaskWord> maskWords;
+
+    std::vector<uint64_t> satisfiedBits;
+    std::vector<uint64_t> contradictedBits;
+    std::vector<RuleScore> scores;
+};
+
+#endif // !PARTIAL_MATCH_H
@@ -0,0 +1,51 @@
+#ifndef RELEVANCE_SLICE_H
+#define RELEVANCE_SLICE_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "KnowledgeBase.hpp"
+
+/**
+ * RelevanceSlice - The part of a knowledge base that can matter to one goal:
+ * the rules concluding the goal or any name reachable backwards from it
+ * over the conclusion -> premise graph, and the names those rules have
+ * premises on. Chaining for the goal only looks at the slice, so a lookup
+ * of the rules concluding a name no longer scans the whole KB, and a
+ * variable outside the slice is never asked for or prefetched.
+ */
+class RelevanceSlice
+{
+public:
+    RelevanceSlice(const std::string& goalP, const KnowledgeBase& knowledgeBase);
+
+    const std::vector<int>& rulesConcluding(const std::string& name) const;
+    bool contains(int statement) const;
+
+    std::string goal;
+    unsigned long long version;             // KnowledgeBase::version of the slice
+    std::vector<int> statements;            // kBase indexes of the slice's rules, in KB order
+    std::vector<std::string> premiseNames;  // sorted, see KnowledgeBase::premiseNamesReachableFrom
+
+private:
+    std::map<std::string, std::vector<int> > rulesByConclusion;
+    std::vector<bool> isInSlice;            // by kBase index
+};
+
+/**
+ * RelevanceSlices - The slices of the goals a session has solved, built on
+ * first use and dropped together when KnowledgeBase::resultVersion changes,
+ * so paging in a shard of new rules keeps them.
+ */
+class RelevanceSlices
+{
+public:
+    const RelevanceSlice& sliceFor(const std::string& goal, const KnowledgeBase& knowledgeBase);
+
+private:
+    unsigned long long version = 0;  // KnowledgeBase::resultVersion of the slices
+    std::map<std::string, RelevanceSlice> slices;
+};
+
+#endif // !RELEVANCE_SLICE_H
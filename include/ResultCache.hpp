@@ -0,0 +1,60 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ClauseItem.hpp"
+#include "KnowledgeBase.hpp"
+#include "VariableListItem.hpp"
+
+/**
+ * ResultCache - LRU cache of back chaining results shared across sessions.
+ * The key is the goal plus the canonical (sorted) list of instantiated facts
+ * on variables the goal can reach; facts on any other variable cannot change
+ * the answer and are left out. Entries belong to one knowledge base version:
+ * the first lookup or store with a different KnowledgeBase::resultVersion
+ * empties the cache, so paging in a shard of new rules does not. Goals with
+ * no rules are not cached. All members are safe to call from
+ * concurrent sessions.
+ */
+class ResultCache
+{
+public:
+    struct Result
+    {
+        int location;                                 // as returned by findValidConclusionInStatements
+        std::vector<int> proof;                       // statements of the proof, goal first
+        std::vector<ClauseItem> intermediateConclusions;
+    };
+
+    explicit ResultCache(int capacityP);
+
+    std::string makeKey(const std::string& goal, const KnowledgeBase& knowledgeBase,
+                        const std::vector<VariableListItem>& variableList);
+    bool lookup(unsigned long long knowledgeBaseVersion, const std::string& key, Result& result);
+    void store(unsigned long long knowledgeBaseVersion, const std::string& key, const Result& result);
+    void displayStatistics() const;
+
+private:
+    typedef std::list<std::pair<std::string, Result> > EntryList;
+
+    void checkVersion(unsigned long long knowledgeBaseVersion);
+    const std::vector<std::string>& relevantVariables(const std::string& goal, const KnowledgeBase& knowledgeBase);
+
+    mutable std::mutex lock;
+    int capacity;
+    unsigned long long version;
+    EntryList entries;                                           // most recently used first
+    std::unordered_map<std::string, EntryList::iterator> index;
+    std::map<std::string, std::vector<std::string> > relevantByGoal;
+    int hitCount;
+    int missCount;
+};
+
+#endif // !RESULT_CACHE_H
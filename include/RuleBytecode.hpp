@@ -0,0 +1,84 @@
+#ifndef RULE_BYTECODE_H
+#define RULE_BYTECODE_H
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ClauseItem.hpp"
+#include "KnowledgeBase.hpp"
+
+/**
+ * RuleBytecode - A knowledge base compiled for BytecodeBackChain. Every
+ * variable tested by a premise gets a register, every value a number, and
+ * every name = value a rule concludes (or a premise asks to be proven) a
+ * procedure: the rules concluding it, in KB order, each a run of tests
+ * that jump to the next rule when one fails and end in PROVEN. A procedure
+ * that runs out of rules ends in FAILED. OR/NOT premises compile to the
+ * same tests with short circuit jumps, evaluated left to right as
+ * ExpressionPool::evaluate does. Each conclusion name also gets a goal
+ * procedure over all of its rules, for a goal asked with DONTCARE.
+ *
+ * Building is a single pass over the KB, so a program is rebuilt whenever
+ * KnowledgeBase::version changes.
+ */
+class RuleBytecode
+{
+public:
+    enum Opcode
+    {
+        TEST = 0,       // register operand holds value
+        TEST_NOT,       // register operand holds a value other than value
+        PROVE,          // the conclusion of procedure operand is proven
+        PROVE_NOT,      // the conclusion of procedure operand cannot be proven
+        PROVEN,         // statement operand holds; return from the procedure
+        FAILED          // no statement of procedure operand holds; return
+    };
+
+    // A test jumps to target when its outcome equals jumpIf, and falls
+    // through otherwise.
+    struct Instruction
+    {
+        unsigned char opcode;
+        unsigned char jumpIf;
+        int operand;
+        int value;
+        int target;
+    };
+
+    // A conclusion, name = value or name = DONTCARE, and where its code starts.
+    struct Procedure
+    {
+        ClauseItem conclusion;
+        int start;
+    };
+
+    void build(const KnowledgeBase& knowledgeBase);
+    int findProcedure(const std::string& name, const std::string& value) const;
+    int findValue(const std::string& value) const;
+
+    bool isBuilt = false;
+    bool isAcyclic = false;             // BytecodeBackChain only runs a program without conclusion cycles
+    unsigned long long version = 0;     // KnowledgeBase::version of the program
+
+    std::vector<Instruction> code;
+    std::vector<Procedure> procedures;
+    std::vector<std::string> registerNames;     // the variable of each register
+
+private:
+    int addProcedure(const ClauseItem& conclusion);
+    int addRegister(const std::string& name);
+    int addValue(const std::string& value);
+    void emitProcedure(int procedure, const KnowledgeBase& knowledgeBase);
+    void emitNode(int node, bool jumpIf, std::vector<int>& exits, const KnowledgeBase& knowledgeBase);
+    void emitTest(const ClauseItem& test, bool isNegated, bool jumpIf, std::vector<int>& exits);
+    void patch(const std::vector<int>& exits, int target);
+
+    std::unordered_map<std::string, std::vector<int> > rulesByConclusion;
+    std::unordered_map<std::string, int> procedureIds;      // name '\x1f' value -> procedure
+    std::unordered_map<std::string, int> registerIds;
+    std::unordered_map<std::string, int> valueIds;          // ids start at 1; 0 is any value no premise tests
+};
+
+#endif // !RULE_BYTECODE_H
@@ -0,0 +1,67 @@
+#ifndef RULE_PROFILE_H
+#define RULE_PROFILE_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "KnowledgeBase.hpp"
+#include "Statement.hpp"
+
+/**
+ * RuleProfile - Per rule success rates and per premise failure rates
+ * gathered over back chaining sessions and kept in a stats file between
+ * runs. Rules are identified by their conclusion and sorted premises, so a
+ * profile survives reordering and edits to unrelated lines of the KB. At
+ * load time the profile reorders the premises on variables of every
+ * statement, cheapest per chance of failing first, where the cost of a
+ * premise is the questions its evaluation asked, and the rules that prove
+ * the same conclusion, likely to succeed first, so fewer premises are
+ * evaluated and fewer questions asked.
+ */
+class RuleProfile
+{
+public:
+    bool load(const std::string& fileName);
+    void save(const std::string& fileName, const KnowledgeBase& knowledgeBase);
+    int reorder(KnowledgeBase& knowledgeBase) const;
+
+    void recordTried(int statement);
+    void recordFired(int statement);
+    void recordPremise(int statement, int premise, bool isValid, int prompts);
+
+    static std::string ruleKey(const Statement& statement);
+
+private:
+    struct PremiseStats
+    {
+        long evaluations;
+        long failures;
+        long prompts;       // questions asked while evaluating the premise
+    };
+
+    struct RuleStats
+    {
+        long tries;
+        long successes;
+        std::map<std::string, PremiseStats> premises;   // by "name = value"
+    };
+
+    // Counters of the current run, by kBase index and premise index. They
+    // are folded into the profile, by rule key, when it is saved.
+    struct SessionStats
+    {
+        long tries;
+        long successes;
+        std::vector<PremiseStats> premises;
+    };
+
+    SessionStats& sessionStatsFor(int statement);
+    double successRate(const Statement& statement) const;
+    double premiseScore(const std::string& key, const ClauseItem& premise) const;
+
+    std::map<std::string, RuleStats> profile;
+    std::vector<SessionStats> sessionStats;
+};
+
+#endif // !RULE_PROFILE_H
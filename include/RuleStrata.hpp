@@ -0,0 +1,35 @@
+#ifndef RULE_STRATA_H
+#define RULE_STRATA_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "KnowledgeBase.hpp"
+
+/**
+ * RuleStrata - The rule dependency graph cut into topological levels. A
+ * rule whose premises are all on variables is on level 0; any other rule is
+ * one level above the highest rule concluding one of its premises. Rules on
+ * the same level never depend on each other, so forward chaining can try a
+ * whole level at once (see ForwardChain). A KB with a conclusion cycle has
+ * no levels.
+ */
+class RuleStrata
+{
+public:
+    void build(const KnowledgeBase& knowledgeBase);
+
+    // kBase indexes of the rules on each level, in KB order.
+    std::vector<std::vector<int> > levels;
+    bool isAcyclic = false;
+    unsigned long long version = 0;     // KnowledgeBase::version the levels were built for
+
+private:
+    int levelOfConclusion(const std::string& name, const KnowledgeBase& knowledgeBase);
+
+    std::map<std::string, std::vector<int> > rulesByConclusion;
+    std::map<std::string, int> conclusionLevel;     // -1 while being visited
+};
+
+#endif // !RULE_STRATA_H
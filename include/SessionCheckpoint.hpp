@@ -0,0 +1,29 @@
+#ifndef SESSION_CHECKPOINT_H
+#define SESSION_CHECKPOINT_H
+
+#include <string>
+
+#include "BackChain.hpp"
+
+/**
+ * SessionCheckpoint - Compact binary snapshots of an idle back chaining
+ * session, so it can be parked on disk and resumed later by another
+ * process. A checkpoint holds the KB version, the answers as 2 bit codes by
+ * variable ID (y, n, unknown, or a value spelled out after the codes), the
+ * statements proven in order, the intermediate conclusions as the statement
+ * that proved each, and the goal being solved. There is no goal stack to
+ * keep: a session is checkpointed between solves, and solving the goal
+ * again on the restored answers rebuilds the stack without asking anything
+ * already answered. A session of the bundled KB takes about 35 bytes.
+ */
+class SessionCheckpoint
+{
+public:
+    static std::string save(const BackChain& backChain);
+    static bool restore(BackChain& backChain, const std::string& checkpoint);
+
+    static void saveFile(const BackChain& backChain, const std::string& fileName);
+    static bool restoreFile(BackChain& backChain, const std::string& fileName);
+};
+
+#endif // !SESSION_CHECKPOINT_H
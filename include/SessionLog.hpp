@@ -0,0 +1,55 @@
+#ifndef SESSION_LOG_H
+#define SESSION_LOG_H
+
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * SessionLog - An append-only binary log of captured sessions, so production
+ * load can be reproduced (see SessionReplay). A session is kept as the KB
+ * version, when it started, and its events in order: answers given up front
+ * or as corrections, answers to the questions asked, and the result of every
+ * goal solved, each with its time into the session. Every record is written
+ * with one write call, so several sessions and processes can append to the
+ * same log; a record cut short at the end of the log is ignored.
+ */
+class SessionLog
+{
+public:
+    enum EventType
+    {
+        FACT_GIVEN = 0,     // loaded before chaining, or a corrected answer
+        FACT_ASKED,         // the answer to a question
+        GOAL_SOLVED         // a goal and what solving it came to
+    };
+
+    struct Event
+    {
+        EventType type;
+        long long offsetMicroseconds;   // since the session started
+        std::string name;               // the variable, or the goal
+        std::string value;              // the answer, or the value proven
+        int location;                   // for GOAL_SOLVED, as returned by solveGoal
+    };
+
+    struct Session
+    {
+        unsigned long long version = 0;
+        long long startMicroseconds = 0;    // since the epoch; 0 until the session starts
+        std::vector<Event> events;
+    };
+
+    explicit SessionLog(const std::string& fileNameP);
+    void append(const Session& session);
+
+    static std::vector<Session> read(const std::string& fileName);
+
+private:
+    std::string fileName;
+    std::mutex lock;
+    std::ofstream logFile;
+};
+
+#endif // !SESSION_LOG_H
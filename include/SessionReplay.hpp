@@ -0,0 +1,71 @@
+#ifndef SESSION_REPLAY_H
+#define SESSION_REPLAY_H
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "BackChain.hpp"
+#include "SessionLog.hpp"
+
+/**
+ * SessionReplay - Drives captured sessions (see SessionLog) through an
+ * engine as load. Each session is replayed on a fresh engine instance:
+ * given answers and corrections are applied in order, goals are solved in
+ * the order they were, and the questions the engine asks are answered from
+ * the capture. Sessions are spread over a number of lanes, each running one
+ * session at a time. At full speed nothing waits; with a pace, sessions
+ * start and answers arrive at their recorded times divided by the pace.
+ * Every result is compared with the captured one.
+ */
+class SessionReplay
+{
+public:
+    // Makes a fresh engine over the loaded KB, for one lane.
+    typedef std::function<std::unique_ptr<BackChain>()> SessionFactory;
+
+    // A goal whose result differs from the one captured.
+    struct Difference
+    {
+        int session;                // from 1, in log order
+        std::string goal;
+        std::string captured;
+        std::string replayed;
+    };
+
+    explicit SessionReplay(const std::vector<SessionLog::Session>& sessionsP);
+
+    void run(const SessionFactory& makeSession, unsigned long long version, int laneCount, double pace);
+    void displayReport(std::ostream& out) const;
+
+    std::vector<Difference> differences;
+
+private:
+    struct Lane
+    {
+        std::vector<long long> goalMicroseconds;        // engine time per goal, waits excluded
+        std::vector<long long> sessionMicroseconds;
+        std::vector<Difference> differences;
+    };
+
+    void replaySession(BackChain& engine, int sessionIndex, bool isComparingLocations, Lane& lane) const;
+
+    static std::string describe(int location, const std::string& value);
+    static void displayPercentiles(const std::string& label, std::vector<long long> samples, std::ostream& out);
+
+    const std::vector<SessionLog::Session>& sessions;
+    double pace = 0;
+    std::chrono::steady_clock::time_point replayStart;
+    long long firstStartMicroseconds = 0;
+
+    std::vector<long long> goalMicroseconds;
+    std::vector<long long> sessionMicroseconds;
+    long long wallMicroseconds = 0;
+    int laneCount = 0;
+    bool isVersionMismatch = false;
+};
+
+#endif // !SESSION_REPLAY_H
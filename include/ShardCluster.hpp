@@ -0,0 +1,107 @@
+#ifndef SHARD_CLUSTER_H
+#define SHARD_CLUSTER_H
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "BackChain.hpp"
+#include "KnowledgeBase.hpp"
+#include "KnowledgeShards.hpp"
+#include "VariableListItem.hpp"
+
+/**
+ * ShardCluster - A partitioned knowledge base (see KnowledgeShards) spread
+ * over local worker processes. Every shard is owned by one worker, which
+ * loads only its own shards and answers for their conclusions; the
+ * coordinator process holds just the manifest and the variable list.
+ * Workers are forked at start and talk to the coordinator over a Unix
+ * socket pair each, one line per message, tagged with the session it
+ * belongs to, so any number of sessions can be in flight at once.
+ *
+ * Statements are numbered as in the partitioned KB: shard by shard in
+ * manifest order, then in shard file order.
+ */
+class ShardCluster
+{
+public:
+    ShardCluster() {}
+    ~ShardCluster();
+
+    void start(const std::string& directory, int workerCount, const std::vector<VariableListItem>& variableList);
+    int ownerOf(const std::string& conclusionName) const;
+    int getTotalRules() const;
+    int getWorkerCount() const;
+    void displayUsage(std::ostream& out) const;
+
+    int openSession();
+    void send(int worker, int session, const std::string& message);
+    std::pair<int, std::string> receive(int session);
+
+private:
+    struct Worker
+    {
+        int pid;
+        int socket;
+        int ruleCount;
+        std::mutex writeLock;
+        std::string readBuffer;
+        bool isOpen;
+    };
+
+    // The messages for one session that it has not taken yet, with the
+    // worker each came from.
+    struct Mailbox
+    {
+        std::deque<std::pair<int, std::string> > messages;
+        std::condition_variable arrived;
+    };
+
+    void route();
+
+    std::map<std::string, int> owners;      // conclusion -> worker
+    std::vector<std::unique_ptr<Worker> > workers;
+    int totalRules = 0;
+
+    std::mutex mailLock;                    // guards mailboxes and isStopped
+    std::map<int, Mailbox> mailboxes;
+    int sessionCount = 0;
+    bool isStopped = false;
+    std::thread router;
+};
+
+/**
+ * ShardSession - A back chaining session whose knowledge base lives in a
+ * ShardCluster. Every conclusion is proven by the worker owning it, which
+ * asks the session for the answers it needs and for the conclusions of
+ * other workers. The statements workers prove are copied into the session's
+ * KB at their numbers, so getProof and displayResult work as usual.
+ * Answers missing from the variable list are unknown; nothing is prompted.
+ */
+class ShardSession : public BackChain
+{
+public:
+    ShardSession(ShardCluster& clusterP, KnowledgeBase* proofBase, const std::vector<VariableListItem>& variableListP);
+
+    void resetSession() override;
+
+protected:
+    int findValidConclusionInStatements(std::string conclusionName, int startingIndex, std::string stringToMatch) override;
+
+private:
+    std::string answer(const std::string& name);
+    void absorbProven(const std::vector<std::string>& fields, int countField);
+
+    ShardCluster& cluster;
+    int session;
+    NoFactProvider noFactProvider;     // a case is solved on its own answers
+};
+
+#endif // !SHARD_CLUSTER_H
@@ -0,0 +1,59 @@
+#ifndef SPECULATION_H
+#define SPECULATION_H
+
+#include <future>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "BackChain.hpp"
+#include "TruthMaintenance.hpp"
+#include "VariableListItem.hpp"
+
+/**
+ * Speculation - Solves a goal for a session that prompts on the console,
+ * using the time the user spends answering. The goal is solved by probes:
+ * throwaway copies of the session that chain on the answers given so far
+ * and stop at the first question. While a question is on screen, one probe
+ * per possible answer (y and n) runs on a thread of its own; when the
+ * answer arrives, the matching probe already knows the next question or
+ * the final result, and the other is dropped. The last probe's working
+ * memory becomes the session's.
+ *
+ * Evaluation order is fixed by the answers, so the questions and results
+ * are those of the plain engines. Of the session's settings a probe takes
+ * only checkKnownFactsFirst and the budget, which is applied per probe and
+ * so runs out where the session's would. Probes get no result cache, no
+ * rule profile and no tracing, and do not reuse the session's relevance
+ * slices.
+ */
+class Speculation
+{
+public:
+    explicit Speculation(BackChain& sessionP);
+
+    int solveGoal(const std::string& goal);
+
+private:
+    struct Outcome
+    {
+        std::string question;               // the next variable to ask for, empty if none is needed
+        int location;                       // as returned by solveGoal, once no question is needed
+        std::unique_ptr<BackChain> probe;   // the working memory the outcome was reached with
+    };
+
+    Outcome runProbe(const std::string& goal, std::vector<VariableListItem> answers) const;
+    std::future<Outcome> speculate(const std::string& goal, int variable, const std::string& answer) const;
+
+    BackChain& session;
+
+    // The session's working memory when the goal was started, which every
+    // probe starts from.
+    std::vector<VariableListItem> startingConclusions;
+    std::vector<int> startingProof;
+    TruthMaintenance startingJustifications;
+    std::set<std::string> startingFailedGoals;
+};
+
+#endif // !SPECULATION_H
@@ -17,6 +17,7 @@ public:
     Statement(ClauseItem conclusionP, std::vector<ClauseItem>& premiseListP);
     ClauseItem conclusion;
     std::vector<ClauseItem> premiseList;
+    double certainty;  // how far the conclusion follows from the premises, 1 unless given (see CertaintyRanking)
 };
 
 #endif // !STATEMENT_H
@@ -0,0 +1,76 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * ThreadPool - Fixed set of worker threads with one task deque each. A worker
+ * takes the newest task from its own deque and, when that is empty, steals
+ * the oldest task from another worker. Tasks submitted from a worker go on
+ * that worker's deque, so nested work stays local until someone is idle.
+ */
+class ThreadPool
+{
+public:
+    explicit ThreadPool(int threadCount);
+    ~ThreadPool();
+
+    void submit(std::function<void()> task);
+    bool runPendingTask();
+    int size() const;
+
+private:
+    struct WorkQueue
+    {
+        std::mutex lock;
+        std::deque<std::function<void()> > tasks;
+    };
+
+    void workerLoop(int index);
+    bool takeTask(int index, std::function<void()>& task);
+    int currentWorker() const;
+
+    std::vector<std::unique_ptr<WorkQueue> > queues;
+    std::vector<std::thread> workers;
+
+    std::mutex sleepLock;
+    std::condition_variable wakeUp;
+    std::atomic<int> queuedCount;
+    std::atomic<unsigned int> nextQueue;
+    bool isStopping;
+};
+
+/**
+ * TaskGroup - A set of tasks on a ThreadPool that can be waited on. Waiting
+ * runs other pool tasks instead of blocking, so a task may itself start a
+ * group and wait for it without starving the pool. The first exception a
+ * task throws is rethrown by wait once every task of the group is done.
+ */
+class TaskGroup
+{
+public:
+    explicit TaskGroup(ThreadPool& poolP);
+    ~TaskGroup();
+
+    void run(std::function<void()> task);
+    void wait();
+
+private:
+    void finish();
+
+    ThreadPool& pool;
+    std::atomic<int> pendingCount;
+
+    std::mutex errorLock;
+    std::exception_ptr firstError;
+};
+
+#endif // !THREAD_POOL_H
@@ -0,0 +1,36 @@
+#ifndef TRUTH_MAINTENANCE_H
+#define TRUTH_MAINTENANCE_H
+
+#include <string>
+#include <vector>
+
+#include "ClauseItem.hpp"
+#include "KnowledgeBase.hpp"
+
+/**
+ * TruthMaintenance - Justification based truth maintenance over the working
+ * memory of a back chaining session. Every statement that fires is recorded
+ * as the justification of its conclusion; its antecedents are the premises
+ * of the statement, which are either facts from the variable list or other
+ * justified conclusions. A conclusion is IN while at least one of its
+ * justifications is IN. When a fact changes, only the justifications that
+ * depend on it, directly or through other conclusions, go OUT; everything
+ * else stays IN and is reused when the goal is solved again.
+ */
+class TruthMaintenance
+{
+public:
+    void justify(int statement);
+    int findSupport(const ClauseItem& conclusion, const KnowledgeBase& knowledgeBase) const;
+    std::vector<int> retract(const std::string& factName, const KnowledgeBase& knowledgeBase);
+    void clear();
+
+private:
+    bool isExpressionOut(const ClauseItem& premise, const std::string& factName, const KnowledgeBase& knowledgeBase) const;
+
+    // kBase indexes of the statements whose justification is IN, in the
+    // order they fired. OUT justifications are dropped.
+    std::vector<int> justifications;
+};
+
+#endif // !TRUTH_MAINTENANCE_H
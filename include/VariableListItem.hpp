@@ -11,12 +11,14 @@ class VariableListItem
 public:
     VariableListItem(std::string nameP, bool instantiatedP, std::string valueP, std::string descriptionP, int typeP);
     void populateStatementIndex(const KnowledgeBase& knowledgeBase);
+    static int find(const std::vector<VariableListItem>& variableList, const std::string& name);
     
     std::string name;
     bool instantiated;
     std::string value;
     std::string description;
     int type;
+    double certainty;  // of the value, 1 unless the answer gave one (see CertaintyRanking)
     std::vector<int>statementIndex;
 };
 
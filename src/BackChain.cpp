@@ -1,10 +1,32 @@
+#include <algorithm>
 #include <iostream>
 #include <fstream>
+#include <stdexcept>
+#include <sstream>
+#include <thread>
 
 #include "ClauseItem.hpp"
 #include "BackChain.hpp"
+#include "KnowledgeAnalyzer.hpp"
+#include "InferenceTrace.hpp"
+#include "Speculation.hpp"
 
 
+/**
+ * Constructor | BackChain | BackChain
+ *
+ * @param KnowledgeBase* sharedRuleSystem: A loaded knowledge base to solve
+ *          against instead of one of this instance's own. It is only read
+ *          and must outlive the instance. nullptr to own one.
+ */
+BackChain::BackChain(KnowledgeBase* sharedRuleSystem)
+    : ownedRuleSystem(sharedRuleSystem == nullptr ? new KnowledgeBase() : nullptr),
+      ruleSystem(sharedRuleSystem == nullptr ? *ownedRuleSystem : *sharedRuleSystem)
+{
+    if (ownedRuleSystem)
+        std::cout << "\nCreating knowledge base instance..." << std::endl;
+}
+
 /**
  * Member Function | BackChain | populateLists
  *
@@ -21,8 +43,76 @@ void BackChain::populateLists()
     intermediateConclusionList.push_back(VariableListItem("Empty", false, "", "This is an error string", STRING));
 
     // Populate the knowledge base and variable list.
-    ruleSystem.populateKnowledgeBase("knowledgeBase.txt");
-    populateVariableList("variablesList.csv");
+    if (!shardDirectory.empty())
+    {
+        knowledgeShards.loadManifest(shardDirectory, ruleSystem);
+        populateVariableList(variableListFile);
+    }
+    else if (loadThreads > 1)
+    {
+        // The variable list is small; load it on its own thread while the KB
+        // is parsed, and print its log afterwards so the output stays in order.
+        std::ostringstream variableLog;
+        std::thread variableLoader([this, &variableLog]() { populateVariableList(variableListFile, variableLog); });
+        try
+        {
+            ruleSystem.populateKnowledgeBaseParallel(knowledgeBaseFile, loadThreads);
+        }
+        catch (...)
+        {
+            variableLoader.join();
+            throw;
+        }
+        variableLoader.join();
+        std::cout << variableLog.str();
+    }
+    else
+    {
+        ruleSystem.populateKnowledgeBase(knowledgeBaseFile);
+        populateVariableList(variableListFile);
+    }
+
+    if (analyzeOnLoad || pruneOnLoad)
+    {
+        analyzeKnowledgeBase();
+    }
+
+    if (ruleProfile != nullptr)
+    {
+        int reorderedCount = ruleProfile->reorder(ruleSystem);
+        if (reorderedCount > 0)
+        {
+            ruleSystem.updateVersion();
+        }
+        std::cout << reorderedCount << " statement(s) reordered by the rule profile." << std::endl;
+    }
+
+    if (forwardPool != nullptr)
+    {
+        ruleStrata.build(ruleSystem);
+    }
+}
+
+/**
+ * Member Function | BackChain | analyzeKnowledgeBase
+ *
+ * Summary: Runs the static analyzer over the loaded knowledge base and
+ *          variable list and prints its report. If pruning is enabled, the
+ *          rules it flagged are removed so neither engine scans them.
+ *
+ * Preconditions:   Both the knowledge base and variable list are populated.
+ */
+void BackChain::analyzeKnowledgeBase()
+{
+    KnowledgeAnalyzer analyzer(ruleSystem, variableList);
+    analyzer.analyze();
+    analyzer.displayReport();
+
+    if (pruneOnLoad && !analyzer.findings.empty())
+    {
+        int removedCount = analyzer.pruneKnowledgeBase(ruleSystem);
+        std::cout << removedCount << " rule(s) pruned from the knowledge base." << std::endl;
+    }
 }
 
 /**
@@ -34,9 +124,10 @@ void BackChain::populateLists()
  *
  * @param string fileName: The name of the file to read entries from. This file
  *                  is in a CSV format of name, prompt, type.
+ * @param ostream& log: Where the list of variables is printed.
  *
  */
-void BackChain::populateVariableList(std::string fileName)
+void BackChain::populateVariableList(std::string fileName, std::ostream& log)
 {
     std::string csvLine;
 
@@ -51,7 +142,7 @@ void BackChain::populateVariableList(std::string fileName)
     variableListFile.open(fileName);
     int varCount = 0;
 
-    std::cout << "List of variables: "; 
+    log << "List of variables: "; 
 
     if (variableListFile)
     {
@@ -65,7 +156,7 @@ void BackChain::populateVariableList(std::string fileName)
             }
             name = csvLine.substr(startParseLocation, endParseLocation);
 
-            std::cout << name << ", ";
+            log << name << ", ";
 
             startParseLocation = endParseLocation + 1;
             endParseLocation = (csvLine.find(',', startParseLocation) - startParseLocation);
@@ -89,17 +180,108 @@ void BackChain::populateVariableList(std::string fileName)
             }
             else
             {
-                std::cout << "\nInvalid entry, line " << csvLine << " not added." << std::endl;
+                log << "\nInvalid entry, line " << csvLine << " not added." << std::endl;
             }
         }
-        std::cout << "\nNumber of variables: " << varCount << std::endl;
+        log << "\nNumber of variables: " << varCount << std::endl;
     }
     else
     {
-        std::cout << "Could not find the file" << std::endl;
+        log << "Could not find the file" << std::endl;
     }
 }
 
+/**
+ * Member Function | BackChain | loadFacts
+ *
+ * Summary: Instantiates variables from a facts file before chaining starts,
+ *          so their questions are never asked. Used for batch and telemetry
+ *          fed sessions. Each line reads name = value.
+ *
+ * Preconditions:   The variable list is populated.
+ *
+ * @param string fileName: The name of the facts file.
+ *
+ */
+void BackChain::loadFacts(std::string fileName)
+{
+    std::ifstream factsFile;
+    factsFile.open(fileName);
+
+    if (!factsFile)
+    {
+        throw std::runtime_error("Error reading facts file " + fileName + ".");
+    }
+
+    int factCount = loadFacts(factsFile);
+    std::cout << factCount << " fact(s) loaded from " << fileName << std::endl;
+}
+
+/**
+ * Member Function | BackChain | loadFacts
+ *
+ * Summary: Reads name = value lines from a stream until the end of the
+ *          stream or a blank line, so a batch file can hold one case per
+ *          paragraph. A value may end in its certainty, e.g. has_fuel = y [0.6].
+ *
+ * @param istream& factsStream: Where the facts are read from.
+ *
+ * @return int: The number of facts that matched a variable.
+ */
+int BackChain::loadFacts(std::istream& factsStream)
+{
+    std::string factLine;
+    int factCount = 0;
+    failedGoals.clear();
+
+    while (getline(factsStream, factLine) && factLine.find_first_not_of(" \r\t") != std::string::npos)
+    {
+        int equalsLocation = factLine.find('=', 0);
+        if (equalsLocation == -1)
+        {
+            continue;
+        }
+
+        std::string name = factLine.substr(0, equalsLocation);
+        std::string value = factLine.substr(equalsLocation + 1);
+        name.erase(0, name.find_first_not_of(' '));
+        name.erase(name.find_last_not_of(' ') + 1);
+        value.erase(0, value.find_first_not_of(' '));
+        value.erase(value.find_last_not_of(" \r") + 1);
+
+        double certainty;
+        if (!CertaintyRanking::splitCertainty(value, certainty))
+        {
+            std::cout << "Fact " << name << " has a certainty outside (0, 1] and was ignored." << std::endl;
+            continue;
+        }
+
+        bool isFound = false;
+        for (int varListIter = 1; varListIter < variableList.size(); varListIter++)
+        {
+            if (name == variableList.at(varListIter).name)
+            {
+                variableList.at(varListIter).value = value;
+                variableList.at(varListIter).certainty = certainty;
+                variableList.at(varListIter).instantiated = true;
+                isFound = true;
+            }
+        }
+
+        if (isFound)
+        {
+            factCount++;
+            captureEvent(SessionLog::FACT_GIVEN, name, CertaintyRanking::withCertainty(value, certainty));
+        }
+        else
+        {
+            std::cout << "Fact " << name << " is not in the variable list and was ignored." << std::endl;
+        }
+    }
+
+    return factCount;
+}
+
 /**
  * Member Function | BackChain | processPremiseList
  *
@@ -123,18 +305,66 @@ bool BackChain::processPremiseList(const Statement &statement)
     int location = 0;
     int conclusionLocation = 0;
     std::string valueToMatch = "";
+    int statementIndex = &statement - &ruleSystem.kBase.front();
+
+    // An answer already given that contradicts a premise fails the statement
+    // before anything is asked for the premises ahead of it.
+    if (checkKnownFactsFirst)
+    {
+        int contradictedPremise = findContradictedPremise(statement);
+        if (contradictedPremise > 0)
+        {
+            InferenceTrace::record(InferenceTrace::PREMISE_FAILED, statementIndex, contradictedPremise);
+            if (ruleProfile != nullptr)
+            {
+                ruleProfile->recordPremise(statementIndex, contradictedPremise, false, 0);
+            }
+            return false;
+        }
+    }
 
     // Process the premise list for a conclusion that was found to be valid.
     for (int premiseIter = 1; (isValid && premiseIter < statement.premiseList.size()); premiseIter++)
     {
+        if (!budget.chargePremise())
+        {
+            return false;
+        }
+        int premisePrompts = promptCount;
+
+        if (InferenceTrace::isEnabled() && ruleSystem.conclusionSet.count(statement.premiseList.at(premiseIter).name) > 0)
+        {
+            InferenceTrace::record(InferenceTrace::GOAL_PUSHED, statementIndex, premiseIter);
+        }
+
+        // An OR/NOT premise is evaluated as a whole, once.
+        if (statement.premiseList.at(premiseIter).type == EXPRESSION)
+        {
+            isValid = evaluateExpression(statement.premiseList.at(premiseIter));
+            if (ruleProfile != nullptr)
+            {
+                ruleProfile->recordPremise(statementIndex, premiseIter, isValid, promptCount - premisePrompts);
+            }
+            if (!isValid)
+            {
+                InferenceTrace::record(InferenceTrace::PREMISE_FAILED, statementIndex, premiseIter);
+            }
+            continue;
+        }
 
         // Go through and if it is a conclusion on the premise side,
         // back chain with it.
         // This will cause another recursive call by adding a conclusion
         // to the stack. It is this step that allows the removal of the actual
         // stack in back chaining.
-        conclusionLocation = findValidConclusionInStatements(statement.premiseList.at(premiseIter).name, 1,
-                                                             statement.premiseList.at(premiseIter).value);
+        // A conclusion that is already justified this session holds without
+        // being proven again.
+        conclusionLocation = truthMaintenance.findSupport(statement.premiseList.at(premiseIter), ruleSystem);
+        if (conclusionLocation == 0)
+        {
+            conclusionLocation = findValidConclusionInStatements(statement.premiseList.at(premiseIter).name, 1,
+                                                                 statement.premiseList.at(premiseIter).value);
+        }
 
         // It is a conclusion but not valid
         if (conclusionLocation == -1)
@@ -157,13 +387,152 @@ bool BackChain::processPremiseList(const Statement &statement)
         // check if it is instantiated as well as what the value was.
         if (conclusionLocation == 0)
         {
+            int promptsBefore = promptCount;
             isValid = instantiatePremiseClause(statement.premiseList.at(premiseIter));
+            if (promptCount != promptsBefore)
+            {
+                InferenceTrace::record(InferenceTrace::FACT_ASSERTED, statementIndex, premiseIter, isValid);
+            }
+        }
+
+        if (ruleProfile != nullptr)
+        {
+            ruleProfile->recordPremise(statementIndex, premiseIter, isValid, promptCount - premisePrompts);
+        }
+
+        if (!isValid)
+        {
+            InferenceTrace::record(InferenceTrace::PREMISE_FAILED, statementIndex, premiseIter);
         }
     }
 
     return isValid;
 }
 
+/**
+ * Member Function | BackChain | evaluateExpression
+ *
+ * Summary: Evaluates an EXPRESSION premise over its compiled node, each
+ *          test in it the way processPremiseList treats a premise. Only
+ *          the tests needed to decide it are solved or asked for.
+ *
+ * @param const ClauseItem& expression: An EXPRESSION premise.
+ *
+ * @return bool: Whether it holds.
+ */
+bool BackChain::evaluateExpression(const ClauseItem& expression)
+{
+    return ruleSystem.expressions.evaluate(ruleSystem.expressions.find(expression.name),
+        [this](const ExpressionPool::Node& leaf) { return isExpressionLeafTrue(leaf); });
+}
+
+/**
+ * Member Function | BackChain | isExpressionLeafTrue
+ *
+ * Summary: Decides one test of an expression, looking its name up in the
+ *          truth maintenance or solving it as a goal first.
+ *
+ * @param const ExpressionPool::Node& leaf: A LEAF node.
+ *
+ * @return bool: Whether the test holds.
+ */
+bool BackChain::isExpressionLeafTrue(const ExpressionPool::Node& leaf)
+{
+    int conclusionLocation = truthMaintenance.findSupport(leaf.clause, ruleSystem);
+    if (conclusionLocation == 0)
+    {
+        conclusionLocation = findValidConclusionInStatements(leaf.clause.name, 1, leaf.clause.value);
+    }
+    return isExpressionLeafTrue(leaf, conclusionLocation);
+}
+
+/**
+ * Member Function | BackChain | isExpressionLeafTrue
+ *
+ * Summary: Decides one test of an expression once its name has been looked
+ *          up or solved as a goal. A test on a conclusion holds when the
+ *          conclusion is proven, and is recorded as an intermediate
+ *          conclusion; negated, it holds when the conclusion cannot be
+ *          proven (negation as failure). A test on a variable is looked up or
+ *          asked for; negated, it holds when the answer is another value.
+ *
+ * @param const ExpressionPool::Node& leaf: A LEAF node.
+ * @param int conclusionLocation: What the name came to, as returned by
+ *          findValidConclusionInStatements (or the truth maintenance).
+ *
+ * @return bool: Whether the test holds.
+ */
+bool BackChain::isExpressionLeafTrue(const ExpressionPool::Node& leaf, int conclusionLocation)
+{
+    if (conclusionLocation > 0)
+    {
+        if (!leaf.isNegated)
+        {
+            addToIntermediateConclusionList(leaf.clause);
+        }
+        return !leaf.isNegated;
+    }
+
+    // Cut short by the budget, the conclusion is not known to be unprovable.
+    if (conclusionLocation == -1)
+    {
+        return leaf.isNegated && !budget.isStopped();
+    }
+
+    bool isMatched = instantiatePremiseClause(leaf.clause);
+    if (!leaf.isNegated)
+    {
+        return isMatched;
+    }
+
+    // As in instantiatePremiseClause, the first entry of a name is the one used.
+    for (int varListIter = 1; varListIter < variableList.size(); varListIter++)
+    {
+        if (leaf.clause.name == variableList.at(varListIter).name)
+        {
+            return variableList.at(varListIter).instantiated && !isMatched;
+        }
+    }
+    return false;
+}
+
+/**
+ * Member Function | BackChain | askUser
+ *
+ * Summary: Prompts for the value of a variable on the console. An answer
+ *          the user is not sure of carries its certainty, e.g. y[0.6]. Nothing
+ *          more is asked once the user answers suspend; the solve runs out
+ *          and the caller checkpoints the session (see SessionCheckpoint).
+ *
+ * @param VariableListItem& variable: The variable; instantiated with the
+ *          answer unless the user suspended.
+ *
+ * @return bool: False if the user suspended the session.
+ */
+bool BackChain::askUser(VariableListItem& variable)
+{
+    std::cout << variable.description << ": ";
+    std::cin >> variable.value;
+    std::cout << "\nYou entered: " << variable.value << std::endl;
+
+    if (variable.value == "suspend")
+    {
+        variable.value = "";
+        isSuspended = true;
+        return false;
+    }
+
+    while (!CertaintyRanking::splitCertainty(variable.value, variable.certainty) && std::cin)
+    {
+        std::cout << "A certainty is more than 0 and at most 1, e.g. y[0.6]. " << variable.description << ": ";
+        std::cin >> variable.value;
+    }
+
+    variable.instantiated = true;
+    captureEvent(SessionLog::FACT_ASKED, variable.name, CertaintyRanking::withCertainty(variable.value, variable.certainty));
+    return true;
+}
+
 /**
  * Member Function | BackChain | instantiatePremiseClause
  *
@@ -204,16 +573,24 @@ bool BackChain::instantiatePremiseClause(const ClauseItem &clause)
             // premise. We need more info and will get it in this step.
             if (!variableList.at(premiseClauseIter).instantiated)
             {
-                std::cout << variableList.at(premiseClauseIter).description << ": ";
-                std::cin >> variableList.at(premiseClauseIter).value;
-                std::cout << "\nYou entered: " << variableList.at(premiseClauseIter).value << std::endl;
-                variableList.at(premiseClauseIter).instantiated = true;
+                if (factProvider != nullptr)
+                {
+                    // A provider without the value leaves the variable
+                    // unknown, so the premise does not hold.
+                    promptCount++;
+                    fetchFact(variableList.at(premiseClauseIter));
+                }
+                else if (!isSuspended)
+                {
+                    promptCount++;
+                    askUser(variableList.at(premiseClauseIter));
+                }
             }
 
-            // Clause variable list is guaranteed to be updated here.
-            // It can now be safely compared to the incoming premise clause
-            // value.
-            if (variableList.at(premiseClauseIter).value == clause.value)
+            // Clause variable list is updated here unless the provider had
+            // no value. It can now be safely compared to the incoming
+            // premise clause value.
+            if (variableList.at(premiseClauseIter).instantiated && variableList.at(premiseClauseIter).value == clause.value)
             {
                 isValid = true;
             }
@@ -252,39 +629,60 @@ int BackChain::findValidConclusionInStatements(std::string conclusionName, int s
     bool isConclusion = false;
     bool isValid = false;
 
+    // Page in the conclusion's shard if the goal's dependencies missed it.
+    if (!shardDirectory.empty())
+    {
+        knowledgeShards.ensureLoaded(conclusionName, ruleSystem);
+    }
+
+    // Failed before this session, so it would fail again.
+    if (isFailedGoal(conclusionName, stringToMatch))
+    {
+        return -1;
+    }
+
     // This loop will go through the knowledge base and look for a matching
     // conclusion in all of the statements. It initially is not trying to
     // find a match to the conclusion value, as the first inquiry will be
     // the open ended question that the user wants the system to solve.
-    // It also begins at index 1 for the first run.
-    for (int conclusionIter = startingIndex; (conclusionIter < ruleSystem.kBase.size() && !isValid); conclusionIter++)
-    {
-        // Check that the conclusion name matches what the user entered or
-        // if the back chain is recursing, see if it matches the conclusion
-        // Next in the list.
-        if (conclusionName == ruleSystem.kBase.at(conclusionIter).conclusion.name)
-        {
-            // It matched the conclusion name, just that at this point.
-            isConclusion = true;
-
-            // Note the DONTCARE here. This allows the initial inquiry to go through
-            // Since it is open ended. However, if not DONTCARE, the stringToMatch
-            // Parameter that was passed in must match. This is due to the multi
-            // purposing of this function.
-            if (stringToMatch == ruleSystem.kBase.at(conclusionIter).conclusion.value || stringToMatch == "DONTCARE")
+    // It also begins at index 1 for the first run. Only the statements
+    // concluding the name the user entered, or the premise being recursed
+    // on, are visited.
+    for (int conclusionIter = nextStatementConcluding(conclusionName, startingIndex);
+         (conclusionIter < ruleSystem.kBase.size() && !isValid && !budget.isStopped());
+         conclusionIter = nextStatementConcluding(conclusionName, conclusionIter + 1))
+    {
+        // It matched the conclusion name, just that at this point.
+        isConclusion = true;
+
+        // Note the DONTCARE here. This allows the initial inquiry to go through
+        // Since it is open ended. However, if not DONTCARE, the stringToMatch
+        // Parameter that was passed in must match. This is due to the multi
+        // purposing of this function.
+        if (stringToMatch == ruleSystem.kBase.at(conclusionIter).conclusion.value || stringToMatch == "DONTCARE")
+        {
+            // It matched the conclusion name (above) and now it also matched the
+            // value in the knowledge base. This needs to be fully processed.
+            // Process premiseList will do just that for this statement.
+            // If everything lines up, we are good.
+            if (!budget.chargeRule())
             {
-                // It matched the conclusion name (above) and now it also matched the
-                // value in the knowledge base. This needs to be fully processed.
-                // Process premiseList will do just that for this statement.
-                // If everything lines up, we are good.
-                isValid = processPremiseList(ruleSystem.kBase.at(conclusionIter));
+                break;
+            }
+            InferenceTrace::record(InferenceTrace::RULE_TRIED, conclusionIter);
+            if (ruleProfile != nullptr)
+            {
+                ruleProfile->recordTried(conclusionIter);
+            }
+            isValid = processPremiseList(ruleSystem.kBase.at(conclusionIter));
 
-                if (isValid)
-                {
-                    // Everything matched up, conclusion name, conclusion value
-                    // and the premises all were good.
-                    location = conclusionIter;
-                }
+            if (isValid)
+            {
+                // Everything matched up, conclusion name, conclusion value
+                // and the premises all were good.
+                location = conclusionIter;
+                recordProven(conclusionIter);
+                InferenceTrace::record(InferenceTrace::RULE_FIRED, conclusionIter);
             }
         }
     }
@@ -303,6 +701,12 @@ int BackChain::findValidConclusionInStatements(std::string conclusionName, int s
     if (isConclusion && !isValid)
     {
         location = -1;
+
+        // A goal cut short by the budget might still hold.
+        if (!budget.isStopped())
+        {
+            recordFailedGoal(conclusionName, stringToMatch);
+        }
     }
 
     // See comment right above this one for info on this return value.
@@ -320,10 +724,9 @@ void BackChain::runBackwardChaining()
 {
 
     std::string conclusionToSolve = "";
-    int conclusionLocation = 0;
     bool isSolvedStatement = false;     
 
-    std::cout << "Please enter a conclusion to solve (values can be: "; 
+    std::cout << "Please enter a conclusion to solve (values can be: all, "; 
     int tmpSetCounter = 0; 
     for (auto f : ruleSystem.conclusionSet) 
     {
@@ -338,12 +741,70 @@ void BackChain::runBackwardChaining()
     std::cin >> conclusionToSolve;
     std::cout << "\nYou entered: " << conclusionToSolve << std::endl;
 
-    conclusionLocation = findValidConclusionInStatements(conclusionToSolve, 1, "DONTCARE");
+    solveAndDisplay(conclusionToSolve);
+}
 
+/**
+ * Member Function | BackChain | solveAndDisplay
+ *
+ * Summary: Solves the goal the user asked for and shows the result, unless
+ *          the user suspended the session on the way. all solves every
+ *          conclusion in one pass (see solveGoals) and shows each result.
+ *
+ * @param string goal: A conclusion name, or all.
+ */
+void BackChain::solveAndDisplay(const std::string& goal)
+{
+    if (goal != "all")
+    {
+        int location = solveGoal(goal);
+        if (!isSuspended)
+        {
+            displayResult(location, goal);
+        }
+        return;
+    }
+
+    std::vector<int> locations = solveGoals(std::vector<std::string>());
+    if (isSuspended)
+    {
+        lastGoal = goal;
+        return;
+    }
+    std::set<std::string>::const_iterator conclusion = ruleSystem.conclusionSet.begin();
+    for (int goalIter = 0; goalIter < locations.size(); goalIter++, ++conclusion)
+    {
+        std::cout << "\n" << *conclusion << ": ";
+        displayResult(locations.at(goalIter), *conclusion);
+    }
+
+    // So a corrected answer solves them all again.
+    lastGoal = goal;
+}
+
+/**
+ * Member Function | BackChain | displayResult
+ *
+ * Summary: Tells the user what solving the goal came to. When it is
+ *          inconclusive and candidateCount is set, the rules for the goal
+ *          that come closest are listed (see PartialMatch); when rankCount
+ *          is set, its values are ranked by certainty (see CertaintyRanking).
+ *
+ * @param int conclusionLocation: As returned by solveGoal.
+ * @param string goal: The goal that was solved.
+ */
+void BackChain::displayResult(int conclusionLocation, const std::string& goal)
+{
     //is a conclusion but not valid
     if (conclusionLocation == -1)
     {
         std::cout << "No conclusion match available. Based on your entries, the results are inconclusive. ";
+        if (candidateCount > 0)
+        {
+            std::cout << "\nClosest " << goal << " candidates:" << std::endl;
+            PartialMatch::display(partialMatch.rank(goal, candidateCount, ruleSystem, variableList, intermediateConclusionList),
+                                  ruleSystem, variableList, std::cout);
+        }
     }
     
     //is a conclusion and valid
@@ -351,6 +812,10 @@ void BackChain::runBackwardChaining()
     {
         std::cout << "\nResult is: " << ruleSystem.kBase.at(conclusionLocation).conclusion.value << std::endl;
         std::cout << "Conclusion is valid. ";
+        if (isLastResultCached)
+        {
+            std::cout << "(cached) ";
+        }
     }
 
     //not a conclusion
@@ -358,6 +823,534 @@ void BackChain::runBackwardChaining()
     {
         std::cout << "No conclusion. ";
     }
+
+    if (rankCount > 0 && conclusionLocation != 0)
+    {
+        std::cout << "\n" << goal << " by certainty:" << std::endl;
+        displayRanking(goal, std::cout);
+    }
+
+    if (budget.isStopped())
+    {
+        std::cout << "\nInference stopped early because " << budget.describe()
+                  << "; only the conclusions proven by then are kept. ";
+    }
+
+    if (!shardDirectory.empty())
+    {
+        knowledgeShards.displayUsage();
+    }
+}
+
+/**
+ * Member Function | BackChain | displayRanking
+ *
+ * Summary: Lists the rankCount values of a goal the session's answers make
+ *          most certain, from every rule of the KB at once.
+ *
+ * @param string goal: A conclusion.
+ * @param ostream& out: Where to print.
+ */
+void BackChain::displayRanking(const std::string& goal, std::ostream& out)
+{
+    std::vector<CertaintyRanking::Candidate> candidates = certaintyRanking.rank(goal, rankCount, ruleSystem, variableList);
+    if (!certaintyRanking.isAcyclic)
+        out << "  The knowledge base has a conclusion cycle; nothing can be ranked." << std::endl;
+    else if (candidates.empty())
+        out << "  No value of " << goal << " follows from the answers given." << std::endl;
+    CertaintyRanking::display(candidates, out);
+}
+
+/**
+ * Member Function | BackChain | solveGoal
+ *
+ * Summary: Solves one goal without asking for it. Loads the goal's shards
+ *          when the KB is partitioned and consults the shared result cache
+ *          first when there is one. On a cache hit the intermediate
+ *          conclusions and proof of the cached session are restored, so
+ *          forward chaining sees the same state as after a real run. Each
+ *          call is one request against the budget.
+ *
+ * @param string goal: The conclusion to solve.
+ *
+ * @return int location:   As returned by findValidConclusionInStatements.
+ */
+int BackChain::solveGoal(const std::string& goal)
+{
+    budget.start();
+    startCapture();
+    isLastResultCached = false;
+    lastGoal = goal;
+    InferenceTrace::record(InferenceTrace::GOAL_PUSHED, 0);
+
+    if (!shardDirectory.empty())
+    {
+        knowledgeShards.ensureGoalLoaded(goal, ruleSystem);
+    }
+    goalSlice = shardDirectory.empty() ? &relevanceSlices.sliceFor(goal, ruleSystem) : nullptr;
+
+    // A goal with no rules yet may get some from an append that leaves
+    // resultVersion alone, and has nothing worth caching anyway. Sharded
+    // sessions have just loaded the goal's rules.
+    if (resultCache == nullptr || (goalSlice != nullptr && goalSlice->statements.empty()))
+    {
+        return captureResult(goal, evaluateGoal(goal));
+    }
+
+    ResultCache::Result cached;
+    std::string key = resultCache->makeKey(goal, ruleSystem, variableList);
+    if (resultCache->lookup(ruleSystem.resultVersion, key, cached))
+    {
+        for (int conclusionIter = 0; conclusionIter < cached.intermediateConclusions.size(); conclusionIter++)
+        {
+            addToIntermediateConclusionList(cached.intermediateConclusions.at(conclusionIter));
+        }
+        for (int proofIter = cached.proof.size() - 1; proofIter >= 0; proofIter--)
+        {
+            recordProven(cached.proof.at(proofIter));
+        }
+        isLastResultCached = true;
+        return captureResult(goal, cached.location);
+    }
+
+    int firstIntermediate = intermediateConclusionList.size();
+    int promptsBefore = promptCount;
+    int location = evaluateGoal(goal);
+
+    if (promptCount == promptsBefore && !budget.isStopped())
+    {
+        cached.location = location;
+        cached.proof = getProof(location);
+        for (int conclusionIter = firstIntermediate; conclusionIter < intermediateConclusionList.size(); conclusionIter++)
+        {
+            const VariableListItem& conclusion = intermediateConclusionList.at(conclusionIter);
+            cached.intermediateConclusions.push_back(ClauseItem(conclusion.name, conclusion.value, conclusion.type));
+        }
+        resultCache->store(ruleSystem.resultVersion, key, cached);
+    }
+
+    return captureResult(goal, location);
+}
+
+/**
+ * Member Function | BackChain | evaluateGoal
+ *
+ * Summary: Chains on a goal the cache did not have. Speculative sessions
+ *          that prompt on the console work out the consequences of each
+ *          answer while the user is still thinking (see Speculation).
+ *
+ * @param string goal: The conclusion to solve.
+ *
+ * @return int location:   As returned by findValidConclusionInStatements.
+ */
+int BackChain::evaluateGoal(const std::string& goal)
+{
+    // Shards load into the shared KB while chaining, which speculative
+    // threads could race, so partitioned KBs are not speculated on.
+    if (isSpeculative && factProvider == nullptr && shardDirectory.empty())
+    {
+        Speculation speculation(*this);
+        return speculation.solveGoal(goal);
+    }
+
+    prefetchGoalFacts(goal);
+    return findValidConclusionInStatements(goal, 1, "DONTCARE");
+}
+
+/**
+ * Member Function | BackChain | solveGoals
+ *
+ * Summary: Solves several goals in one pass over the same working memory.
+ *          Answers, conclusions proven for one goal and subgoals that failed
+ *          for one goal are all reused by the next, so a subgoal shared by
+ *          several goals is only proven (or disproven) once.
+ *
+ * @param vector<string> goals: The conclusions to solve, in order. Empty for
+ *          every conclusion in the knowledge base.
+ *
+ * @return vector<int>: The location for each goal, as returned by solveGoal.
+ */
+std::vector<int> BackChain::solveGoals(const std::vector<std::string>& goals)
+{
+    std::vector<std::string> allGoals;
+    if (goals.empty())
+    {
+        allGoals.assign(ruleSystem.conclusionSet.begin(), ruleSystem.conclusionSet.end());
+    }
+    const std::vector<std::string>& goalsToSolve = goals.empty() ? allGoals : goals;
+
+    std::vector<int> locations;
+    for (int goalIter = 0; goalIter < goalsToSolve.size(); goalIter++)
+    {
+        locations.push_back(solveGoal(goalsToSolve.at(goalIter)));
+    }
+
+    return locations;
+}
+
+/**
+ * Member Function | BackChain | prefetchGoalFacts
+ *
+ * Summary: Asks the fact provider, in one batched request, for every
+ *          variable the goal's rules might need and the session does not
+ *          know yet. Solving carries on while the request is in flight; the
+ *          values are only taken up one by one, as premises need them, so
+ *          the order of evaluation and the questions counted are the same as
+ *          without prefetching.
+ *
+ * @param string goal: The conclusion about to be solved.
+ */
+void BackChain::prefetchGoalFacts(const std::string& goal)
+{
+    if (factProvider == nullptr)
+    {
+        return;
+    }
+
+    std::vector<std::string> reachable = (goalSlice != nullptr && goalSlice->goal == goal) ? goalSlice->premiseNames
+                                                                                          : ruleSystem.premiseNamesReachableFrom(goal);
+    std::vector<VariableListItem> wanted;
+    for (int varListIter = 1; varListIter < variableList.size(); varListIter++)
+    {
+        const VariableListItem& variable = variableList.at(varListIter);
+        if (!variable.instantiated && prefetchedFacts.find(variable.name) == prefetchedFacts.end() &&
+            std::binary_search(reachable.begin(), reachable.end(), variable.name))
+        {
+            wanted.push_back(variable);
+        }
+    }
+    if (wanted.empty())
+    {
+        return;
+    }
+
+    collectPrefetchedFacts();
+    std::future<FactValues> request = factProvider->requestFacts(wanted);
+    if (request.valid())
+    {
+        pendingFacts = std::move(request);
+        providerRequests++;
+    }
+}
+
+/**
+ * Member Function | BackChain | collectPrefetchedFacts
+ *
+ * Summary: Waits for the batched request in flight, if any, and keeps its
+ *          values for fetchFact.
+ */
+void BackChain::collectPrefetchedFacts()
+{
+    if (pendingFacts.valid())
+    {
+        FactValues arrived = pendingFacts.get();
+        prefetchedFacts.insert(arrived.begin(), arrived.end());
+    }
+}
+
+/**
+ * Member Function | BackChain | fetchFact
+ *
+ * Summary: Gets the value of a variable from the fact provider, from the
+ *          prefetched values when the batch had it and with a request of
+ *          its own otherwise.
+ *
+ * @param VariableListItem& variable: The variable; instantiated on success.
+ *
+ * @return bool: False if the provider has no value for it.
+ */
+bool BackChain::fetchFact(VariableListItem& variable)
+{
+    collectPrefetchedFacts();
+
+    std::string value;
+    FactValues::const_iterator prefetched = prefetchedFacts.find(variable.name);
+    if (prefetched != prefetchedFacts.end())
+    {
+        value = prefetched->second;
+    }
+    else
+    {
+        providerRequests++;
+        if (!factProvider->provideFact(variable, value))
+        {
+            return false;
+        }
+    }
+
+    // A value whose certainty is out of range is kept whole, as given.
+    if (!CertaintyRanking::splitCertainty(value, variable.certainty))
+    {
+        variable.certainty = 1;
+    }
+    variable.value = value;
+    variable.instantiated = true;
+    captureEvent(SessionLog::FACT_ASKED, variable.name, CertaintyRanking::withCertainty(value, variable.certainty));
+    return true;
+}
+
+/**
+ * Member Function | BackChain | isFailedGoal
+ *
+ * Summary: Looks a goal up in the table of goals that failed this session.
+ *          Answers are only added during a session, never changed (short of
+ *          changeFact or loadFacts, which empty the table), so a goal that
+ *          failed once would fail again.
+ *
+ * @param string name: The conclusion.
+ * @param string value: The value it was solved for, or DONTCARE.
+ */
+bool BackChain::isFailedGoal(const std::string& name, const std::string& value) const
+{
+    return !failedGoals.empty() && failedGoals.count(name + " = " + value) > 0;
+}
+
+/**
+ * Member Function | BackChain | recordFailedGoal
+ *
+ * @param string name: A conclusion that could not be proven.
+ * @param string value: The value it was solved for, or DONTCARE.
+ */
+void BackChain::recordFailedGoal(const std::string& name, const std::string& value)
+{
+    failedGoals.insert(name + " = " + value);
+}
+
+/**
+ * Member Function | BackChain | getProof
+ *
+ * Summary: Rebuilds the proof of a proven statement from the statements
+ *          proven this session: the statement itself, then for each premise
+ *          that is a conclusion, the proof of the statement that proved it.
+ *
+ * @param int location: A statement returned by a successful solve.
+ *
+ * @return vector<int>: Statement indexes, goal first, depth first.
+ */
+std::vector<int> BackChain::getProof(int location) const
+{
+    std::vector<int> proof;
+    if (location <= 0)
+    {
+        return proof;
+    }
+
+    std::vector<int> pending(1, location);
+    while (!pending.empty())
+    {
+        int statement = pending.back();
+        pending.pop_back();
+        proof.push_back(statement);
+
+        // The tests of an expression that were proven are part of the proof;
+        // those of a branch that did not decide it may be too.
+        std::vector<ClauseItem> tests;
+        const std::vector<ClauseItem>& premiseList = ruleSystem.kBase.at(statement).premiseList;
+        for (int premiseIter = 1; premiseIter < premiseList.size(); premiseIter++)
+        {
+            std::vector<ClauseItem> leafTests = ruleSystem.premiseTests(premiseList.at(premiseIter));
+            tests.insert(tests.end(), leafTests.begin(), leafTests.end());
+        }
+
+        for (int testIter = tests.size() - 1; testIter >= 0; testIter--)
+        {
+            for (int provenIter = 0; provenIter < provenStatements.size(); provenIter++)
+            {
+                const ClauseItem& conclusion = ruleSystem.kBase.at(provenStatements.at(provenIter)).conclusion;
+                if (conclusion.name == tests.at(testIter).name && conclusion.value == tests.at(testIter).value)
+                {
+                    pending.push_back(provenStatements.at(provenIter));
+                    break;
+                }
+            }
+        }
+    }
+
+    return proof;
+}
+
+/**
+ * Member Function | BackChain | resetSession
+ *
+ * Summary: Forgets every answer and conclusion so the loaded KB and variable
+ *          list can serve the next session.
+ */
+void BackChain::resetSession()
+{
+    finishCapture();
+    for (int varListIter = 1; varListIter < variableList.size(); varListIter++)
+    {
+        variableList.at(varListIter).instantiated = false;
+        variableList.at(varListIter).value = "";
+        variableList.at(varListIter).certainty = 1;
+    }
+    if (intermediateConclusionList.size() > 1)
+    {
+        intermediateConclusionList.erase(intermediateConclusionList.begin() + 1, intermediateConclusionList.end());
+    }
+    provenStatements.clear();
+    truthMaintenance.clear();
+    failedGoals.clear();
+    if (pendingFacts.valid())
+    {
+        pendingFacts.wait();
+        pendingFacts = std::future<FactValues>();
+    }
+    prefetchedFacts.clear();
+    promptCount = 0;
+    providerRequests = 0;
+    isSuspended = false;
+    isLastResultCached = false;
+}
+
+/**
+ * Member Function | BackChain | changeFact
+ *
+ * Summary: Corrects the answer to a variable. The conclusions that depended
+ *          on the old answer are retracted, along with their intermediate
+ *          conclusions and proof steps; every other conclusion of the
+ *          session stays in place, so solving the goal again only re-derives
+ *          the part of the proof the answer reached.
+ *
+ * @param string name: The variable to correct.
+ * @param string value: The new answer, possibly ending in its certainty.
+ *
+ * @return int: The number of conclusions retracted, or -1 if the name is
+ *          not in the variable list or the certainty is not in (0, 1].
+ */
+int BackChain::changeFact(const std::string& name, const std::string& value)
+{
+    std::string answer = value;
+    double certainty;
+    if (!CertaintyRanking::splitCertainty(answer, certainty))
+    {
+        return -1;
+    }
+
+    bool isFound = false;
+    for (int varListIter = 1; varListIter < variableList.size(); varListIter++)
+    {
+        if (name == variableList.at(varListIter).name)
+        {
+            variableList.at(varListIter).value = answer;
+            variableList.at(varListIter).certainty = certainty;
+            variableList.at(varListIter).instantiated = true;
+            isFound = true;
+        }
+    }
+
+    if (!isFound)
+    {
+        return -1;
+    }
+    captureEvent(SessionLog::FACT_GIVEN, name, value);
+
+    // The new answer may make any goal that failed provable.
+    failedGoals.clear();
+
+    std::vector<int> retracted = truthMaintenance.retract(name, ruleSystem);
+    for (int retractedIter = 0; retractedIter < retracted.size(); retractedIter++)
+    {
+        provenStatements.erase(std::remove(provenStatements.begin(), provenStatements.end(), retracted.at(retractedIter)),
+                               provenStatements.end());
+    }
+
+    // Keep only the intermediate conclusions that are still justified.
+    for (int conclusionIter = intermediateConclusionList.size() - 1; conclusionIter >= 1; conclusionIter--)
+    {
+        const VariableListItem& conclusion = intermediateConclusionList.at(conclusionIter);
+        if (truthMaintenance.findSupport(ClauseItem(conclusion.name, conclusion.value, conclusion.type), ruleSystem) == 0)
+        {
+            intermediateConclusionList.erase(intermediateConclusionList.begin() + conclusionIter);
+        }
+    }
+
+    return retracted.size();
+}
+
+/**
+ * Member Function | BackChain | nextStatementConcluding
+ *
+ * Summary: Finds the next candidate statement for a goal. With a relevance
+ *          slice this is a lookup in the slice instead of a scan of the KB;
+ *          the statements found, and their order, are the same.
+ *
+ * @param string name: The conclusion name.
+ * @param int startingIndex: The first kBase index that may be returned.
+ *
+ * @return int: The kBase index of the first statement at or after
+ *          startingIndex concluding the name, or kBase.size() if none does.
+ */
+int BackChain::nextStatementConcluding(const std::string& name, int startingIndex) const
+{
+    if (goalSlice != nullptr)
+    {
+        const std::vector<int>& rules = goalSlice->rulesConcluding(name);
+        std::vector<int>::const_iterator next = std::lower_bound(rules.begin(), rules.end(), startingIndex);
+        return (next != rules.end()) ? *next : ruleSystem.kBase.size();
+    }
+
+    int statement = startingIndex;
+    while (statement < ruleSystem.kBase.size() && ruleSystem.kBase.at(statement).conclusion.name != name)
+    {
+        statement++;
+    }
+    return statement;
+}
+
+/**
+ * Member Function | BackChain | recordProven
+ *
+ * Summary: Notes that a statement was proven: it joins the session's proof
+ *          steps and justifies its conclusion.
+ *
+ * @param int statement: kBase index of the proven statement.
+ */
+void BackChain::recordProven(int statement)
+{
+    provenStatements.push_back(statement);
+    truthMaintenance.justify(statement);
+    if (ruleProfile != nullptr)
+    {
+        ruleProfile->recordFired(statement);
+    }
+}
+
+/**
+ * Member Function | BackChain | findContradictedPremise
+ *
+ * Summary: Looks for a premise on a variable that is already answered with
+ *          a different value. Conclusions and OR/NOT premises are not
+ *          considered; proving one may ask questions.
+ *
+ * @param const Statement& statement: The statement about to be processed.
+ *
+ * @return int: Index of the first contradicted premise, or 0 if none is.
+ */
+int BackChain::findContradictedPremise(const Statement& statement) const
+{
+    for (int premiseIter = 1; premiseIter < statement.premiseList.size(); premiseIter++)
+    {
+        const ClauseItem& premise = statement.premiseList.at(premiseIter);
+        if (premise.type == EXPRESSION || ruleSystem.conclusionSet.count(premise.name) > 0)
+        {
+            continue;
+        }
+
+        // As in instantiatePremiseClause, the first entry of a name is the one used.
+        for (int varListIter = 1; varListIter < variableList.size(); varListIter++)
+        {
+            if (premise.name == variableList.at(varListIter).name)
+            {
+                if (variableList.at(varListIter).instantiated && variableList.at(varListIter).value != premise.value)
+                {
+                    return premiseIter;
+                }
+                break;
+            }
+        }
+    }
+    return 0;
 }
 
 /**
@@ -382,3 +1375,83 @@ void BackChain::addToIntermediateConclusionList(const ClauseItem &intermediateCo
                          intermediateConclusion.type));
 }
 
+/**
+ * Member Function | BackChain | startCapture
+ *
+ * Summary: Starts the session's clock for sessionLog, unless it is running.
+ */
+void BackChain::startCapture()
+{
+    if (sessionLog == nullptr || capturedSession.startMicroseconds != 0)
+    {
+        return;
+    }
+
+    capturedSession.startMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    captureStart = std::chrono::steady_clock::now();
+}
+
+/**
+ * Member Function | BackChain | captureEvent
+ *
+ * Summary: Adds an event to the session being captured, if any.
+ *
+ * @param EventType type: What happened.
+ * @param string name: The variable, or the goal.
+ * @param string value: The answer, or the value proven.
+ * @param int location: For GOAL_SOLVED, as returned by solveGoal.
+ */
+void BackChain::captureEvent(SessionLog::EventType type, const std::string& name, const std::string& value, int location)
+{
+    if (sessionLog == nullptr)
+    {
+        return;
+    }
+
+    startCapture();
+    SessionLog::Event event;
+    event.type = type;
+    event.offsetMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - captureStart).count();
+    event.name = name;
+    event.value = value;
+    event.location = location;
+    capturedSession.events.push_back(event);
+}
+
+/**
+ * Member Function | BackChain | captureResult
+ *
+ * Summary: Captures what solving a goal came to. A solve the user suspended
+ *          has no result.
+ *
+ * @param string goal: The goal solved.
+ * @param int location: As returned by solveGoal.
+ *
+ * @return int: location, unchanged.
+ */
+int BackChain::captureResult(const std::string& goal, int location)
+{
+    if (!isSuspended)
+    {
+        captureEvent(SessionLog::GOAL_SOLVED, goal, (location > 0) ? ruleSystem.kBase.at(location).conclusion.value : "", location);
+    }
+    return location;
+}
+
+/**
+ * Member Function | BackChain | finishCapture
+ *
+ * Summary: Appends the session captured so far to sessionLog, if anything
+ *          happened in it, and starts a new one.
+ */
+void BackChain::finishCapture()
+{
+    if (sessionLog != nullptr && !capturedSession.events.empty())
+    {
+        capturedSession.version = ruleSystem.version;
+        sessionLog->append(capturedSession);
+    }
+    capturedSession = SessionLog::Session();
+}
@@ -0,0 +1,184 @@
+#include "BinaryFormat.hpp"
+
+
+/**
+ * Static Function | BinaryFormat | writeWord
+ *
+ * @param ostream& out: Where the word goes.
+ * @param unsigned long long word: The value; bytes beyond byteCount are
+ *          dropped.
+ * @param int byteCount: How many bytes to write, least significant first.
+ */
+void BinaryFormat::writeWord(std::ostream& out, unsigned long long word, int byteCount)
+{
+    for (int byteIter = 0; byteIter < byteCount; byteIter++)
+    {
+        out.put((char)((word >> (8 * byteIter)) & 0xFF));
+    }
+}
+
+/**
+ * Static Function | BinaryFormat | readWord
+ *
+ * @param istream& in: Where the word is read from.
+ * @param int byteCount: How many bytes it takes, least significant first.
+ *
+ * @return unsigned long long: The value.
+ */
+unsigned long long BinaryFormat::readWord(std::istream& in, int byteCount)
+{
+    unsigned long long word = 0;
+    for (int byteIter = 0; byteIter < byteCount; byteIter++)
+    {
+        word |= (unsigned long long)(unsigned char)in.get() << (8 * byteIter);
+    }
+    return word;
+}
+
+/**
+ * Static Function | BinaryFormat | putWord
+ *
+ * @param string& out: Appended to.
+ * @param unsigned long long word: The value; bytes beyond byteCount are
+ *          dropped.
+ * @param int byteCount: How many bytes to append, least significant first.
+ */
+void BinaryFormat::putWord(std::string& out, unsigned long long word, int byteCount)
+{
+    for (int byteIter = 0; byteIter < byteCount; byteIter++)
+    {
+        out.push_back((char)((word >> (8 * byteIter)) & 0xFF));
+    }
+}
+
+/**
+ * Static Function | BinaryFormat | putVarint
+ *
+ * Summary: Appends an unsigned LEB128 varint: 7 bits a byte, so small
+ *          counts and indexes take one byte.
+ *
+ * @param string& out: Appended to.
+ * @param unsigned long long value: The value.
+ */
+void BinaryFormat::putVarint(std::string& out, unsigned long long value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back((char)((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back((char)value);
+}
+
+/**
+ * Static Function | BinaryFormat | putString
+ *
+ * @param string& out: Appended to.
+ * @param string text: Appended as its length, a varint, then its bytes.
+ */
+void BinaryFormat::putString(std::string& out, const std::string& text)
+{
+    putVarint(out, text.size());
+    out.append(text);
+}
+
+/**
+ * Constructor | BinaryFormat::Reader | Reader
+ *
+ * @param string dataP: What to read, from the start. It must outlive the
+ *          reader.
+ */
+BinaryFormat::Reader::Reader(const std::string& dataP)
+    : data(dataP), position(0), isGood(true)
+{
+}
+
+/**
+ * Member Function | BinaryFormat::Reader | getWord
+ *
+ * @param int byteCount: How many bytes the word takes, as put by putWord.
+ * @param unsigned long long& word: Receives the value.
+ *
+ * @return bool: False if the data ran out.
+ */
+bool BinaryFormat::Reader::getWord(int byteCount, unsigned long long& word)
+{
+    size_t start;
+    if (!getBytes(byteCount, start))
+    {
+        return false;
+    }
+    word = 0;
+    for (int byteIter = 0; byteIter < byteCount; byteIter++)
+    {
+        word |= (unsigned long long)(unsigned char)data[start + byteIter] << (8 * byteIter);
+    }
+    return true;
+}
+
+/**
+ * Member Function | BinaryFormat::Reader | getVarint
+ *
+ * @param unsigned long long& value: Receives the value put by putVarint.
+ *
+ * @return bool: False if the data ran out or the varint is over 64 bits.
+ */
+bool BinaryFormat::Reader::getVarint(unsigned long long& value)
+{
+    value = 0;
+    for (int shift = 0; isGood && shift < 64; shift += 7)
+    {
+        if (position >= data.size())
+        {
+            break;
+        }
+        unsigned char byte = data[position++];
+        value |= (unsigned long long)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+    isGood = false;
+    return false;
+}
+
+/**
+ * Member Function | BinaryFormat::Reader | getString
+ *
+ * @param string& text: Receives the text put by putString.
+ *
+ * @return bool: False if the data ran out.
+ */
+bool BinaryFormat::Reader::getString(std::string& text)
+{
+    unsigned long long length;
+    if (!getVarint(length) || length > data.size() - position)
+    {
+        isGood = false;
+        return false;
+    }
+    text.assign(data, position, length);
+    position += length;
+    return true;
+}
+
+/**
+ * Member Function | BinaryFormat::Reader | getBytes
+ *
+ * @param size_t count: How many bytes to skip over.
+ * @param size_t& start: Receives where they start in data.
+ *
+ * @return bool: False if the data ran out.
+ */
+bool BinaryFormat::Reader::getBytes(size_t count, size_t& start)
+{
+    if (!isGood || count > data.size() - position)
+    {
+        isGood = false;
+        return false;
+    }
+    start = position;
+    position += count;
+    return true;
+}
@@ -0,0 +1,254 @@
+#include <unordered_map>
+
+#include "BytecodeBackChain.hpp"
+#include "InferenceTrace.hpp"
+
+
+/**
+ * Constructor | BytecodeBackChain | BytecodeBackChain
+ *
+ * @param KnowledgeBase* sharedRuleSystem: See BackChain::BackChain.
+ * @param RuleBytecode* sharedProgram: A program compiled from the shared KB,
+ *          used read only instead of compiling one per session; it must
+ *          outlive the session. nullptr to compile one.
+ */
+BytecodeBackChain::BytecodeBackChain(KnowledgeBase* sharedRuleSystem, const RuleBytecode* sharedProgram)
+    : BackChain(sharedRuleSystem), program(sharedProgram != nullptr ? sharedProgram : &ownProgram)
+{
+}
+
+/**
+ * Member Function | BytecodeBackChain | compile
+ *
+ * Summary: Compiles the KB, unless the program is shared or already
+ *          compiled from this version of it, and points each register at
+ *          its variable list entry.
+ *
+ * @return RuleBytecode: The program.
+ */
+const RuleBytecode& BytecodeBackChain::compile()
+{
+    if (program == &ownProgram && (!ownProgram.isBuilt || ownProgram.version != ruleSystem.version))
+    {
+        ownProgram.build(ruleSystem);
+        entriesVariableCount = -1;
+    }
+
+    if (entriesVariableCount != variableList.size() || entriesVersion != program->version)
+    {
+        // As in instantiatePremiseClause, the first entry of a name is the one used.
+        std::unordered_map<std::string, int> firstEntries;
+        for (int varListIter = variableList.size() - 1; varListIter >= 1; varListIter--)
+        {
+            firstEntries[variableList.at(varListIter).name] = varListIter;
+        }
+
+        registerEntries.assign(program->registerNames.size(), 0);
+        for (int registerIter = 0; registerIter < program->registerNames.size(); registerIter++)
+        {
+            std::unordered_map<std::string, int>::const_iterator entry = firstEntries.find(program->registerNames.at(registerIter));
+            if (entry != firstEntries.end())
+            {
+                registerEntries.at(registerIter) = entry->second;
+            }
+        }
+        entriesVariableCount = variableList.size();
+        entriesVersion = program->version;
+    }
+
+    return *program;
+}
+
+/**
+ * Member Function | BytecodeBackChain | findValidConclusionInStatements
+ *
+ * Summary: Same contract as BackChain::findValidConclusionInStatements.
+ *          The goal's procedure is run on fresh registers; what the session
+ *          already proved or failed to prove is picked up from the truth
+ *          maintenance and the goal table as each sub goal is first reached.
+ *
+ * @param string conclusionName: The name of a conclusion to match up to.
+ * @param int startingIndex: The first index location to begin searching from.
+ * @param string stringToMatch: The value to match, or DONTCARE.
+ *
+ * @return int location:   Specifies the location of a conclusion.
+ */
+int BytecodeBackChain::findValidConclusionInStatements(std::string conclusionName, int startingIndex, std::string stringToMatch)
+{
+    compile();
+    int procedure = program->findProcedure(conclusionName, stringToMatch);
+    if (!isInterpretable() || startingIndex != 1 || procedure < 0)
+    {
+        return BackChain::findValidConclusionInStatements(conclusionName, startingIndex, stringToMatch);
+    }
+
+    // See BackChain::isFailedGoal.
+    if (isFailedGoal(conclusionName, stringToMatch))
+    {
+        return -1;
+    }
+
+    registers.assign(program->registerNames.size(), -1);
+    procedureResults.assign(program->procedures.size(), 0);
+    return run(procedure);
+}
+
+/**
+ * Member Function | BytecodeBackChain | isInterpretable
+ *
+ * @return bool: False if this session needs what only BackChain does:
+ *          tracing, profiling, a budget, shards, or chaining a KB with a
+ *          conclusion cycle.
+ */
+bool BytecodeBackChain::isInterpretable() const
+{
+    return program->isAcyclic && !InferenceTrace::isEnabled() && ruleProfile == nullptr && !checkKnownFactsFirst &&
+           shardDirectory.empty() && budget.limits.maxRuleEvaluations == 0 && budget.limits.maxPremiseChecks == 0 &&
+           budget.limits.timeLimitMilliseconds == 0;
+}
+
+/**
+ * Member Function | BytecodeBackChain | run
+ *
+ * Summary: The dispatch loop. A PROVE whose sub goal is not known yet pushes
+ *          a frame and jumps to the sub goal's procedure; PROVEN and FAILED
+ *          pop it, note the outcome, and go back to the PROVE, which then
+ *          finds the outcome known.
+ *
+ * @param int procedure: The goal's procedure.
+ *
+ * @return int location:   As returned by findValidConclusionInStatements.
+ */
+int BytecodeBackChain::run(int procedure)
+{
+    const std::vector<RuleBytecode::Instruction>& code = program->code;
+    const std::vector<RuleBytecode::Procedure>& procedures = program->procedures;
+
+    frames.clear();
+    Frame bottom = { procedure, -1 };
+    frames.push_back(bottom);
+    int pc = procedures.at(procedure).start;
+
+    while (true)
+    {
+        const RuleBytecode::Instruction& instruction = code[pc];
+        bool holds = false;
+
+        switch (instruction.opcode)
+        {
+        case RuleBytecode::TEST:
+            holds = loadRegister(instruction.operand) && registers[instruction.operand] == instruction.value;
+            break;
+
+        case RuleBytecode::TEST_NOT:
+            holds = loadRegister(instruction.operand) && registers[instruction.operand] != instruction.value;
+            break;
+
+        case RuleBytecode::PROVE:
+        case RuleBytecode::PROVE_NOT:
+        {
+            const ClauseItem& conclusion = procedures[instruction.operand].conclusion;
+            int& result = procedureResults[instruction.operand];
+            if (result == 0)
+            {
+                result = truthMaintenance.findSupport(conclusion, ruleSystem);
+            }
+            if (result == 0 && isFailedGoal(conclusion.name, conclusion.value))
+            {
+                result = -1;
+            }
+            if (result == 0)
+            {
+                Frame frame = { instruction.operand, pc };
+                frames.push_back(frame);
+                pc = procedures[instruction.operand].start;
+                continue;
+            }
+
+            holds = (result > 0) == (instruction.opcode == RuleBytecode::PROVE);
+            if (result > 0 && instruction.opcode == RuleBytecode::PROVE)
+            {
+                addToIntermediateConclusionList(conclusion);
+            }
+            break;
+        }
+
+        case RuleBytecode::PROVEN:
+        case RuleBytecode::FAILED:
+        {
+            Frame frame = frames.back();
+            frames.pop_back();
+
+            int result = -1;
+            if (instruction.opcode == RuleBytecode::PROVEN)
+            {
+                result = instruction.operand;
+                recordProven(result);
+            }
+            else
+            {
+                const ClauseItem& conclusion = procedures[frame.procedure].conclusion;
+                recordFailedGoal(conclusion.name, conclusion.value);
+            }
+
+            procedureResults[frame.procedure] = result;
+            if (frame.returnTo < 0)
+            {
+                return result;
+            }
+            pc = frame.returnTo;
+            continue;
+        }
+        }
+
+        pc = (holds == (instruction.jumpIf != 0)) ? instruction.target : pc + 1;
+    }
+}
+
+/**
+ * Member Function | BytecodeBackChain | loadRegister
+ *
+ * Summary: Makes sure a register holds its variable's value, getting the
+ *          value from the fact provider or the user, as
+ *          instantiatePremiseClause does, the first time it is needed.
+ *
+ * @param int variable: The register.
+ *
+ * @return bool: False if the variable is not in the variable list or is
+ *          still not instantiated; it is asked for again next time.
+ */
+bool BytecodeBackChain::loadRegister(int variable)
+{
+    if (registers[variable] >= 0)
+    {
+        return true;
+    }
+
+    int entry = registerEntries[variable];
+    if (entry == 0)
+    {
+        return false;
+    }
+
+    VariableListItem& item = variableList[entry];
+    if (!item.instantiated)
+    {
+        if (factProvider != nullptr)
+        {
+            promptCount++;
+            fetchFact(item);
+        }
+        else if (!isSuspended)
+        {
+            promptCount++;
+            askUser(item);
+        }
+    }
+    if (!item.instantiated)
+    {
+        return false;
+    }
+
+    registers[variable] = program->findValue(item.value);
+    return true;
+}
@@ -0,0 +1,446 @@
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+
+#include "CertaintyRanking.hpp"
+#include "RuleStrata.hpp"
+
+
+/**
+ * Static Function | CertaintyRanking | splitCertainty
+ *
+ * Summary: Takes a trailing certainty off a value, as in
+ *          has_fuel = y [0.6] or : repair = Dead Battery [0.8]. Brackets
+ *          that do not hold a number are left as part of the value.
+ *
+ * @param string& text: A value; the certainty and the spaces before it are
+ *          removed from it.
+ * @param double& certainty: Receives the certainty, 1 if none was given.
+ *
+ * @return bool: False, with the text left as it was, if the certainty is
+ *          not in (0, 1] or nothing is left of the value.
+ */
+bool CertaintyRanking::splitCertainty(std::string& text, double& certainty)
+{
+    certainty = 1;
+    size_t close = text.find_last_not_of(" \t\r");
+    if (close == std::string::npos || text[close] != ']')
+    {
+        return true;
+    }
+    size_t open = text.rfind('[', close);
+    if (open == std::string::npos)
+    {
+        return true;
+    }
+
+    std::string number = text.substr(open + 1, close - open - 1);
+    char* numberEnd = nullptr;
+    double parsed = strtod(number.c_str(), &numberEnd);
+    if (number.find_first_not_of(" \t") == std::string::npos || numberEnd == number.c_str() ||
+        number.find_first_not_of(" \t", numberEnd - number.c_str()) != std::string::npos)
+    {
+        return true;
+    }
+
+    std::string value = text.substr(0, open);
+    value.erase(value.find_last_not_of(" \t") + 1);
+    if (!(parsed > 0 && parsed <= 1) || value.empty())
+    {
+        return false;
+    }
+    text = value;
+    certainty = parsed;
+    return true;
+}
+
+/**
+ * Static Function | CertaintyRanking | withCertainty
+ *
+ * @param string value: A value.
+ * @param double certainty: Its certainty.
+ *
+ * @return string: The value as splitCertainty reads it back; the value alone
+ *          when it is certain.
+ */
+std::string CertaintyRanking::withCertainty(const std::string& value, double certainty)
+{
+    if (certainty == 1)
+    {
+        return value;
+    }
+    std::ostringstream text;
+    text << value << " [" << certainty << "]";
+    return text.str();
+}
+
+/**
+ * Member Function | CertaintyRanking | addTest
+ *
+ * @param string name: A variable or conclusion.
+ * @param string value: A value tested or concluded.
+ *
+ * @return int: The test's id, given in the order tests are first seen.
+ */
+int CertaintyRanking::addTest(const std::string& name, const std::string& value)
+{
+    std::pair<std::map<std::pair<std::string, std::string>, int>::iterator, bool> inserted =
+        testIds.insert(std::make_pair(std::make_pair(name, value), (int)testNames.size()));
+    if (inserted.second)
+    {
+        testNames.push_back(name);
+        testValues.push_back(value);
+    }
+    return inserted.first->second;
+}
+
+/**
+ * Member Function | CertaintyRanking | nodeSlot
+ *
+ * Summary: The slot of an ExpressionPool node. A group is given one the
+ *          first time a level uses it, after its operands, so it is worked
+ *          out once, on the lowest level that needs it.
+ *
+ * @param int node: A node id.
+ * @param KnowledgeBase knowledgeBase: The KB being compiled.
+ *
+ * @return int: The slot.
+ */
+int CertaintyRanking::nodeSlot(int node, const KnowledgeBase& knowledgeBase)
+{
+    const ExpressionPool::Node& expression = knowledgeBase.expressions.node(node);
+    if (expression.kind == ExpressionPool::LEAF)
+    {
+        int test = testIds.at(std::make_pair(expression.clause.name, expression.clause.value));
+        return 1 + test + (expression.isNegated ? testCount : 0);
+    }
+    if (expressionSlots.at(node) > 0)
+    {
+        return expressionSlots.at(node);
+    }
+
+    std::vector<int> operands;
+    for (int operandIter = 0; operandIter < expression.operands.size(); operandIter++)
+    {
+        operands.push_back(nodeSlot(expression.operands.at(operandIter), knowledgeBase));
+    }
+
+    int slot = 1 + 2 * testCount + groupSlot.size();
+    groupSlot.push_back(slot);
+    groupIsOr.push_back(expression.kind == ExpressionPool::OR);
+    operandStart.push_back(operandSlot.size());
+    operandSlot.insert(operandSlot.end(), operands.begin(), operands.end());
+    expressionSlots.at(node) = slot;
+    return slot;
+}
+
+/**
+ * Member Function | CertaintyRanking | premiseSlot
+ *
+ * @param ClauseItem premise: A premise of a rule being compiled.
+ * @param KnowledgeBase knowledgeBase: The KB being compiled.
+ *
+ * @return int: The slot holding the certainty of the premise.
+ */
+int CertaintyRanking::premiseSlot(const ClauseItem& premise, const KnowledgeBase& knowledgeBase)
+{
+    if (premise.type == EXPRESSION)
+    {
+        return nodeSlot(knowledgeBase.expressions.find(premise.name), knowledgeBase);
+    }
+    return 1 + testIds.at(std::make_pair(premise.name, premise.value));
+}
+
+/**
+ * Member Function | CertaintyRanking | build
+ *
+ * Summary: Compiles the KB: numbers every test, answered variables first,
+ *          and lays out every level's rules and the groups they use.
+ *
+ * @param KnowledgeBase knowledgeBase: The loaded KB.
+ * @param vector<VariableListItem> variableList: The variables answers are
+ *          given for.
+ */
+void CertaintyRanking::build(const KnowledgeBase& knowledgeBase, const std::vector<VariableListItem>& variableList)
+{
+    testIds.clear();
+    testNames.clear();
+    testValues.clear();
+    answerTestVariable.clear();
+    answerTestValue.clear();
+    valueIds.clear();
+    conclusionTestsByName.clear();
+    groupSlot.clear();
+    groupIsOr.clear();
+    operandStart.clear();
+    operandSlot.clear();
+    levelGroupStart.clear();
+    levelRuleStart.clear();
+    levelPremiseStart.clear();
+    levelWidth.clear();
+    premiseSlots.clear();
+    ruleStatement.clear();
+    ruleConclusion.clear();
+    ruleCertainty.clear();
+    builtVersion = knowledgeBase.version;
+    builtVariableCount = variableList.size();
+
+    RuleStrata ruleStrata;
+    ruleStrata.build(knowledgeBase);
+    isAcyclic = ruleStrata.isAcyclic;
+    if (!isAcyclic)
+    {
+        return;
+    }
+
+    // Every test in the order it is first seen, then renumbered so the
+    // tests on answers come first and are scored by one loop.
+    for (int statementIter = 1; statementIter < knowledgeBase.kBase.size(); statementIter++)
+    {
+        const Statement& statement = knowledgeBase.kBase.at(statementIter);
+        for (int premiseIter = 1; premiseIter < statement.premiseList.size(); premiseIter++)
+        {
+            std::vector<ClauseItem> tests = knowledgeBase.premiseTests(statement.premiseList.at(premiseIter));
+            for (int testIter = 0; testIter < tests.size(); testIter++)
+            {
+                addTest(tests.at(testIter).name, tests.at(testIter).value);
+            }
+        }
+        addTest(statement.conclusion.name, statement.conclusion.value);
+    }
+
+    std::vector<std::string> names;
+    std::vector<std::string> values;
+    names.swap(testNames);
+    values.swap(testValues);
+    testIds.clear();
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (int testIter = 0; testIter < names.size(); testIter++)
+        {
+            bool isConclusion = knowledgeBase.conclusionSet.count(names.at(testIter)) > 0;
+            if (isConclusion == (pass == 1))
+                addTest(names.at(testIter), values.at(testIter));
+        }
+        if (pass == 0)
+            answerTestCount = testNames.size();
+    }
+    testCount = testNames.size();
+
+    // As when chaining, the first entry of a name is the one answered.
+    std::map<std::string, int> variableIndex;
+    for (int varListIter = variableList.size() - 1; varListIter >= 1; varListIter--)
+    {
+        variableIndex[variableList.at(varListIter).name] = varListIter;
+    }
+    for (int testIter = 0; testIter < answerTestCount; testIter++)
+    {
+        std::map<std::string, int>::const_iterator variable = variableIndex.find(testNames.at(testIter));
+        answerTestVariable.push_back((variable != variableIndex.end()) ? variable->second : 0);
+        answerTestValue.push_back(valueIds.insert(std::make_pair(testValues.at(testIter), (int)valueIds.size())).first->second);
+    }
+    for (int testIter = answerTestCount; testIter < testCount; testIter++)
+    {
+        conclusionTestsByName[testNames.at(testIter)].push_back(testIter);
+    }
+
+    expressionSlots.assign(knowledgeBase.expressions.size() + 1, 0);
+    std::vector<std::vector<int> > rulePremises;
+    for (int levelIter = 0; levelIter < ruleStrata.levels.size(); levelIter++)
+    {
+        const std::vector<int>& level = ruleStrata.levels.at(levelIter);
+        levelRuleStart.push_back(ruleStatement.size());
+        levelGroupStart.push_back(groupSlot.size());
+        levelPremiseStart.push_back(premiseSlots.size());
+
+        int width = 0;
+        rulePremises.assign(level.size(), std::vector<int>());
+        for (int ruleIter = 0; ruleIter < level.size(); ruleIter++)
+        {
+            const Statement& statement = knowledgeBase.kBase.at(level.at(ruleIter));
+            for (int premiseIter = 1; premiseIter < statement.premiseList.size(); premiseIter++)
+            {
+                rulePremises.at(ruleIter).push_back(premiseSlot(statement.premiseList.at(premiseIter), knowledgeBase));
+            }
+            width = std::max(width, (int)rulePremises.at(ruleIter).size());
+
+            ruleStatement.push_back(level.at(ruleIter));
+            ruleConclusion.push_back(testIds.at(std::make_pair(statement.conclusion.name, statement.conclusion.value)));
+            ruleCertainty.push_back((float)statement.certainty);
+        }
+
+        // Row k holds premise k of every rule; slot 0 pads the short ones.
+        levelWidth.push_back(width);
+        for (int premiseIter = 0; premiseIter < width; premiseIter++)
+        {
+            for (int ruleIter = 0; ruleIter < level.size(); ruleIter++)
+            {
+                const std::vector<int>& premises = rulePremises.at(ruleIter);
+                premiseSlots.push_back((premiseIter < premises.size()) ? premises.at(premiseIter) : 0);
+            }
+        }
+    }
+    levelRuleStart.push_back(ruleStatement.size());
+    levelGroupStart.push_back(groupSlot.size());
+    levelPremiseStart.push_back(premiseSlots.size());
+    operandStart.push_back(operandSlot.size());
+}
+
+/**
+ * Member Function | CertaintyRanking | score
+ *
+ * Summary: Works out the certainty of every test and rule from the answers,
+ *          a level at a time.
+ *
+ * @param vector<VariableListItem> variableList: The session's answers.
+ */
+void CertaintyRanking::score(const std::vector<VariableListItem>& variableList)
+{
+    answerValue.assign(variableList.size(), -1);
+    answerCertainty.assign(variableList.size(), 0);
+    for (int varListIter = 1; varListIter < variableList.size(); varListIter++)
+    {
+        const VariableListItem& variable = variableList.at(varListIter);
+        if (variable.instantiated)
+        {
+            // An answer no rule tests for matches no test.
+            std::unordered_map<std::string, int>::const_iterator valueId = valueIds.find(variable.value);
+            answerValue[varListIter] = (valueId != valueIds.end()) ? valueId->second : (int)valueIds.size();
+            answerCertainty[varListIter] = (float)variable.certainty;
+        }
+    }
+
+    slots.assign(1 + 2 * testCount + groupSlot.size(), 0.0f);
+    slots[0] = 1;
+    float* held = &slots[1];
+    float* notHeld = held + testCount;
+
+    for (int testIter = 0; testIter < answerTestCount; testIter++)
+    {
+        int variable = answerTestVariable[testIter];
+        int answer = answerValue[variable];
+        float given = (answer == answerTestValue[testIter]) ? answerCertainty[variable] : 1 - answerCertainty[variable];
+        held[testIter] = (answer >= 0) ? given : 0.0f;
+        notHeld[testIter] = (answer >= 0) ? 1 - given : 0.0f;
+    }
+    for (int testIter = answerTestCount; testIter < testCount; testIter++)
+    {
+        notHeld[testIter] = 1;
+    }
+
+    ruleHeld.assign(ruleStatement.size(), 1.0f);
+    for (int levelIter = 0; levelIter + 1 < levelRuleStart.size(); levelIter++)
+    {
+        for (int groupIter = levelGroupStart[levelIter]; groupIter < levelGroupStart[levelIter + 1]; groupIter++)
+        {
+            float certainty = groupIsOr[groupIter] ? 0.0f : 1.0f;
+            for (int operandIter = operandStart[groupIter]; operandIter < operandStart[groupIter + 1]; operandIter++)
+            {
+                float operand = slots[operandSlot[operandIter]];
+                certainty = groupIsOr[groupIter] ? std::max(certainty, operand) : std::min(certainty, operand);
+            }
+            slots[groupSlot[groupIter]] = certainty;
+        }
+
+        int first = levelRuleStart[levelIter];
+        int ruleCount = levelRuleStart[levelIter + 1] - first;
+        float* levelHeld = &ruleHeld[first];
+        for (int premiseIter = 0; premiseIter < levelWidth[levelIter]; premiseIter++)
+        {
+            const int* row = &premiseSlots[levelPremiseStart[levelIter] + premiseIter * ruleCount];
+            for (int ruleIter = 0; ruleIter < ruleCount; ruleIter++)
+            {
+                levelHeld[ruleIter] = std::min(levelHeld[ruleIter], slots[row[ruleIter]]);
+            }
+        }
+        const float* levelCertainty = &ruleCertainty[first];
+        for (int ruleIter = 0; ruleIter < ruleCount; ruleIter++)
+        {
+            levelHeld[ruleIter] *= levelCertainty[ruleIter];
+        }
+
+        // Several rules of a level may conclude the same value, so this
+        // last step stays scalar.
+        for (int ruleIter = 0; ruleIter < ruleCount; ruleIter++)
+        {
+            int conclusion = ruleConclusion[first + ruleIter];
+            held[conclusion] += levelHeld[ruleIter] * (1 - held[conclusion]);
+            notHeld[conclusion] = 1 - held[conclusion];
+        }
+    }
+}
+
+/**
+ * Member Function | CertaintyRanking | rank
+ *
+ * Summary: Scores every rule of the KB against the session's answers and
+ *          returns the goal's values that hold at all, most certain first.
+ *          Proven conclusions are not used; they follow from the answers.
+ *
+ * @param string goal: The conclusion, e.g. repair.
+ * @param int count: How many values to return at most.
+ * @param KnowledgeBase knowledgeBase: The session's KB.
+ * @param vector<VariableListItem> variableList: The session's answers.
+ *
+ * @return vector<Candidate>: The values, best first; empty for a KB with a
+ *          conclusion cycle.
+ */
+std::vector<CertaintyRanking::Candidate> CertaintyRanking::rank(const std::string& goal, int count, const KnowledgeBase& knowledgeBase,
+                                                                const std::vector<VariableListItem>& variableList)
+{
+    if (knowledgeBase.version != builtVersion || (int)variableList.size() != builtVariableCount)
+        build(knowledgeBase, variableList);
+
+    std::vector<Candidate> candidates;
+    std::map<std::string, std::vector<int> >::const_iterator goalTests = conclusionTestsByName.find(goal);
+    if (!isAcyclic || goalTests == conclusionTestsByName.end())
+        return candidates;
+
+    score(variableList);
+
+    std::vector<int> bestRule(testCount, -1);
+    for (int ruleIter = 0; ruleIter < ruleStatement.size(); ruleIter++)
+    {
+        int& best = bestRule[ruleConclusion[ruleIter]];
+        if (best < 0 || ruleHeld[ruleIter] > ruleHeld[best] ||
+            (ruleHeld[ruleIter] == ruleHeld[best] && ruleStatement[ruleIter] < ruleStatement[best]))
+            best = ruleIter;
+    }
+
+    for (int testIter = 0; testIter < goalTests->second.size(); testIter++)
+    {
+        int test = goalTests->second.at(testIter);
+        if (slots[1 + test] > 0)
+        {
+            Candidate candidate = { testValues.at(test), slots[1 + test], ruleStatement.at(bestRule.at(test)) };
+            candidates.push_back(candidate);
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end(),
+        [](const Candidate& left, const Candidate& right)
+        {
+            if (left.certainty != right.certainty)
+                return left.certainty > right.certainty;
+            return left.statement < right.statement;
+        });
+    if (candidates.size() > std::max(count, 0))
+        candidates.resize(std::max(count, 0));
+    return candidates;
+}
+
+/**
+ * Static Function | CertaintyRanking | display
+ *
+ * @param vector<Candidate> candidates: As returned by rank.
+ * @param ostream& out: Where to print.
+ */
+void CertaintyRanking::display(const std::vector<Candidate>& candidates, std::ostream& out)
+{
+    for (int candidateIter = 0; candidateIter < candidates.size(); candidateIter++)
+    {
+        const Candidate& candidate = candidates.at(candidateIter);
+        out << "  " << (candidateIter + 1) << ". " << candidate.value << "  (certainty " << candidate.certainty
+            << ", rule " << candidate.statement << ")" << std::endl;
+    }
+}
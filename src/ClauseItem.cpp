@@ -61,3 +61,20 @@ void ClauseItem::operator=(const ClauseItem& srcClause)
     type = srcClause.type;
 }
 
+
+
+/**
+ * Member Function | ClauseItem | describe
+ *
+ * Summary: The clause as it is written in the knowledge base file.
+ *
+ * @return string: name = value, or the text of an EXPRESSION premise.
+ */
+std::string ClauseItem::describe() const
+{
+    if (type == EXPRESSION)
+    {
+        return name;
+    }
+    return name + " = " + value;
+}
@@ -0,0 +1,423 @@
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#include "DecisionTable.hpp"
+#include "BinaryFormat.hpp"
+#include "BackChain.hpp"
+#include "ForwardChain.hpp"
+#include "InferenceTrace.hpp"
+#include "IterativeBackChain.hpp"
+#include "BytecodeBackChain.hpp"
+
+#define TABLE_MAGIC "VDTABLE1"
+
+namespace
+{
+    std::vector<VariableListItem> withAnswers(const std::vector<VariableListItem>& variableList,
+                                              const std::vector<std::pair<int, std::string> >& answers)
+    {
+        std::vector<VariableListItem> answered(variableList);
+        for (int answerIter = 0; answerIter < answers.size(); answerIter++)
+        {
+            VariableListItem& variable = answered.at(answers.at(answerIter).first);
+            variable.value = answers.at(answerIter).second;
+            variable.instantiated = true;
+        }
+        return answered;
+    }
+
+    ClauseItem forwardChain(KnowledgeBase& knowledgeBase, const std::vector<VariableListItem>& solvedVariables,
+                            const std::vector<VariableListItem>& solvedConclusions,
+                            ThreadPool* threadPool, const RuleStrata* ruleStrata)
+    {
+        ForwardChain forwardChain(&knowledgeBase);
+        forwardChain.copyVariableList(solvedVariables);
+        forwardChain.addIntermediateConclusions(solvedConclusions);
+        forwardChain.threadPool = threadPool;
+        forwardChain.ruleStrata = ruleStrata;
+
+        std::ostream nullLog(nullptr);
+        return forwardChain.runForwardChaining(nullLog);
+    }
+}
+
+
+/**
+ * Member Function | DecisionTable | build
+ *
+ * Summary: Enumerates every path to a result for the goal, checks the
+ *          engines against each other on every one, and flattens the tree.
+ *
+ * @param string goalP: The conclusion the table answers.
+ * @param KnowledgeBase knowledgeBase: The loaded KB.
+ * @param vector<VariableListItem> variableList: The loaded variable list,
+ *          nothing instantiated.
+ * @param ThreadPool& pool: Where the branches run.
+ * @param int maxLeaves: The most paths to enumerate.
+ *
+ * @return bool: False, with no table, if there are more paths than that.
+ */
+bool DecisionTable::build(const std::string& goalP, KnowledgeBase& knowledgeBase,
+                          const std::vector<VariableListItem>& variableList, ThreadPool& pool, int maxLeaves)
+{
+    goal = goalP;
+    version = knowledgeBase.version;
+    variables.clear();
+    mismatches.clear();
+    nodes.clear();
+    leafCount = 0;
+
+    Enumeration enumeration(knowledgeBase, variableList, pool, maxLeaves);
+    Branch root;
+    explore(enumeration, root, std::vector<std::pair<int, std::string> >());
+    if (enumeration.leaves.load() > maxLeaves)
+    {
+        mismatches.clear();
+        return false;
+    }
+
+    std::vector<int> variableIds(variableList.size(), -1);
+    flatten(root, variableList, variableIds);
+    leafCount = enumeration.leaves.load();
+
+    // Branches finish in any order.
+    std::sort(mismatches.begin(), mismatches.end(),
+        [](const Mismatch& left, const Mismatch& right) { return left.answers < right.answers; });
+    return true;
+}
+
+/**
+ * Member Function | DecisionTable | explore
+ *
+ * Summary: Solves the goal on the answers of one path. If the engine needs
+ *          another answer, the path forks on it, y and n in parallel;
+ *          otherwise the path ends in a leaf holding the result.
+ *
+ * @param Enumeration& enumeration: The build in progress.
+ * @param Branch& branch: Receives the subtree of the path.
+ * @param vector answers: The path so far, by variable list index.
+ */
+void DecisionTable::explore(Enumeration& enumeration, Branch& branch, const std::vector<std::pair<int, std::string> >& answers)
+{
+    if (enumeration.leaves.load() > enumeration.maxLeaves)
+    {
+        return;
+    }
+
+    // The enumeration is not a session; only its results are of interest.
+    InferenceTrace::muteThisThread(true);
+
+    BackChain probe(&enumeration.knowledgeBase);
+    probe.variableList = withAnswers(enumeration.variableList, answers);
+    probe.intermediateConclusionList.push_back(VariableListItem("Empty", false, "", "This is an error string", STRING));
+
+    // Stands in for the user: the first question not answered on the path.
+    FirstQuestion firstQuestion;
+    probe.factProvider = &firstQuestion;
+    int location = probe.solveGoal(goal);
+    probe.factProvider = nullptr;
+
+    if (firstQuestion.question.empty())
+    {
+        branch.result = location;
+        enumeration.leaves++;
+        checkLeaf(enumeration, answers, location, probe.variableList, probe.intermediateConclusionList);
+        InferenceTrace::muteThisThread(false);
+        return;
+    }
+
+    branch.variable = VariableListItem::find(enumeration.variableList, firstQuestion.question);
+    branch.yes.reset(new Branch());
+    branch.no.reset(new Branch());
+
+    std::vector<std::pair<int, std::string> > ifYes(answers);
+    ifYes.push_back(std::make_pair(branch.variable, std::string("y")));
+    std::vector<std::pair<int, std::string> > ifNo(answers);
+    ifNo.push_back(std::make_pair(branch.variable, std::string("n")));
+
+    TaskGroup group(enumeration.pool);
+    group.run([&]() { explore(enumeration, *branch.yes, ifYes); });
+    explore(enumeration, *branch.no, ifNo);
+    group.wait();
+    InferenceTrace::muteThisThread(false);
+}
+
+/**
+ * Member Function | DecisionTable | checkLeaf
+ *
+ * Summary: The consistency check of one path. IterativeBackChain must give
+ *          the same result without asking anything more, BytecodeBackChain
+ *          too, with the same intermediate conclusions, forward chaining
+ *          must end on the same conclusion either way it runs, and if that
+ *          is the goal, on the value back chaining proved.
+ *
+ * @param Enumeration& enumeration: The build in progress.
+ * @param vector answers: The path.
+ * @param int location: What BackChain::solveGoal returned on it.
+ * @param vector<VariableListItem> solvedVariables: The probe's variables.
+ * @param vector<VariableListItem> solvedConclusions: The probe's
+ *          intermediate conclusions.
+ */
+void DecisionTable::checkLeaf(Enumeration& enumeration, const std::vector<std::pair<int, std::string> >& answers, int location,
+                              const std::vector<VariableListItem>& solvedVariables,
+                              const std::vector<VariableListItem>& solvedConclusions)
+{
+    KnowledgeBase& knowledgeBase = enumeration.knowledgeBase;
+    std::string detail;
+
+    IterativeBackChain iterative(4096, &knowledgeBase);
+    iterative.variableList = withAnswers(enumeration.variableList, answers);
+    iterative.intermediateConclusionList.push_back(VariableListItem("Empty", false, "", "This is an error string", STRING));
+    FirstQuestion firstQuestion;
+    iterative.factProvider = &firstQuestion;
+    int iterativeLocation = iterative.solveGoal(goal);
+    if (iterativeLocation != location || !firstQuestion.question.empty())
+    {
+        detail = "IterativeBackChain returned " + std::to_string(iterativeLocation) + " instead of " + std::to_string(location);
+    }
+
+    BytecodeBackChain bytecode(&knowledgeBase, &enumeration.program);
+    bytecode.variableList = withAnswers(enumeration.variableList, answers);
+    bytecode.intermediateConclusionList.push_back(VariableListItem("Empty", false, "", "This is an error string", STRING));
+    FirstQuestion bytecodeQuestion;
+    bytecode.factProvider = &bytecodeQuestion;
+    int bytecodeLocation = bytecode.solveGoal(goal);
+    bool isSameConclusions = (bytecode.intermediateConclusionList.size() == solvedConclusions.size());
+    for (int conclusionIter = 0; isSameConclusions && conclusionIter < solvedConclusions.size(); conclusionIter++)
+    {
+        isSameConclusions = bytecode.intermediateConclusionList.at(conclusionIter).name == solvedConclusions.at(conclusionIter).name &&
+                            bytecode.intermediateConclusionList.at(conclusionIter).value == solvedConclusions.at(conclusionIter).value;
+    }
+    if (bytecodeLocation != location || !bytecodeQuestion.question.empty() || !isSameConclusions)
+    {
+        detail += (detail.empty() ? "" : "; ");
+        detail += "BytecodeBackChain returned " + std::to_string(bytecodeLocation) + " instead of " + std::to_string(location);
+        if (!isSameConclusions)
+            detail += ", with other intermediate conclusions";
+    }
+
+    // Forward chaining picks up where back chaining left off, as in
+    // recommendRepair, once from the queue and once a level at a time.
+    ClauseItem conclusion = forwardChain(knowledgeBase, solvedVariables, solvedConclusions, nullptr, nullptr);
+    if (enumeration.ruleStrata.isAcyclic)
+    {
+        ClauseItem levelConclusion = forwardChain(knowledgeBase, solvedVariables, solvedConclusions,
+                                                  &enumeration.pool, &enumeration.ruleStrata);
+        if (levelConclusion.name != conclusion.name || levelConclusion.value != conclusion.value)
+        {
+            detail += (detail.empty() ? "" : "; ");
+            detail += "forward chaining a level at a time ended on " + levelConclusion.name + " = " + levelConclusion.value
+                    + " instead of " + conclusion.name + " = " + conclusion.value;
+        }
+    }
+    if (conclusion.name == goal && (location <= 0 || conclusion.value != knowledgeBase.kBase.at(location).conclusion.value))
+    {
+        detail += (detail.empty() ? "" : "; ");
+        detail += "forward chaining concluded " + conclusion.name + " = " + conclusion.value;
+    }
+
+    if (!detail.empty())
+    {
+        Mismatch mismatch;
+        for (int answerIter = 0; answerIter < answers.size(); answerIter++)
+        {
+            mismatch.answers.push_back(std::make_pair(enumeration.variableList.at(answers.at(answerIter).first).name,
+                                                      answers.at(answerIter).second));
+        }
+        mismatch.detail = detail;
+
+        std::lock_guard<std::mutex> guard(enumeration.lock);
+        mismatches.push_back(mismatch);
+    }
+}
+
+/**
+ * Member Function | DecisionTable | flatten
+ *
+ * Summary: Appends a subtree to nodes depth first, the node before its
+ *          children, numbering the variables in the order they are reached.
+ *
+ * @param Branch branch: The subtree.
+ * @param vector<VariableListItem> variableList: For the variable names.
+ * @param vector<int>& variableIds: Table variable by variable list index,
+ *          -1 until numbered.
+ *
+ * @return int: The index of the subtree's node.
+ */
+int DecisionTable::flatten(const Branch& branch, const std::vector<VariableListItem>& variableList, std::vector<int>& variableIds)
+{
+    int index = nodes.size();
+    nodes.push_back(Node());
+
+    if (branch.variable == 0)
+    {
+        nodes.at(index).variable = -1;
+        nodes.at(index).yes = branch.result;
+        nodes.at(index).no = 0;
+        return index;
+    }
+
+    if (variableIds.at(branch.variable) == -1)
+    {
+        variableIds.at(branch.variable) = variables.size();
+        variables.push_back(variableList.at(branch.variable).name);
+    }
+    int variable = variableIds.at(branch.variable);
+    int yes = flatten(*branch.yes, variableList, variableIds);
+    int no = flatten(*branch.no, variableList, variableIds);
+
+    nodes.at(index).variable = variable;
+    nodes.at(index).yes = yes;
+    nodes.at(index).no = no;
+    return index;
+}
+
+/**
+ * Member Function | DecisionTable | lookup
+ *
+ * Summary: Answers the goal from the table: follows the answers from the
+ *          root to a leaf, one node per question.
+ *
+ * @param FactValues answers: The answers by variable name; only those on
+ *          the path are read.
+ * @param string& missing: Receives the variable whose answer was needed and
+ *          missing, if any.
+ *
+ * @return int: As BackChain::solveGoal would return on the same answers,
+ *          or MISSING_ANSWER.
+ */
+int DecisionTable::lookup(const FactValues& answers, std::string& missing) const
+{
+    int index = 0;
+    while (index < nodes.size() && nodes[index].variable >= 0)
+    {
+        const Node& node = nodes[index];
+        FactValues::const_iterator answer = answers.find(variables[node.variable]);
+        if (answer == answers.end() || (answer->second != "y" && answer->second != "n"))
+        {
+            missing = variables[node.variable];
+            return MISSING_ANSWER;
+        }
+        index = (answer->second == "y") ? node.yes : node.no;
+    }
+
+    return (index < nodes.size()) ? nodes[index].yes : 0;
+}
+
+/**
+ * Member Function | DecisionTable | save
+ *
+ * Summary: Writes the table: the magic, the KB version, the goal, the
+ *          variable names, then 12 bytes per node, all little endian.
+ *
+ * @param string fileName: The table file to write.
+ */
+void DecisionTable::save(const std::string& fileName) const
+{
+    std::ofstream tableFile(fileName.c_str(), std::ios::out | std::ios::binary);
+    if (!tableFile)
+    {
+        throw std::runtime_error("Error writing decision table " + fileName + ".");
+    }
+
+    tableFile.write(TABLE_MAGIC, 8);
+    BinaryFormat::writeWord(tableFile, version, 8);
+    BinaryFormat::writeWord(tableFile, goal.size(), 4);
+    tableFile.write(goal.data(), goal.size());
+    BinaryFormat::writeWord(tableFile, variables.size(), 4);
+    for (int variableIter = 0; variableIter < variables.size(); variableIter++)
+    {
+        BinaryFormat::writeWord(tableFile, variables.at(variableIter).size(), 4);
+        tableFile.write(variables.at(variableIter).data(), variables.at(variableIter).size());
+    }
+    BinaryFormat::writeWord(tableFile, leafCount, 4);
+    BinaryFormat::writeWord(tableFile, nodes.size(), 4);
+    for (int nodeIter = 0; nodeIter < nodes.size(); nodeIter++)
+    {
+        BinaryFormat::writeWord(tableFile, (unsigned int)nodes.at(nodeIter).variable, 4);
+        BinaryFormat::writeWord(tableFile, (unsigned int)nodes.at(nodeIter).yes, 4);
+        BinaryFormat::writeWord(tableFile, (unsigned int)nodes.at(nodeIter).no, 4);
+    }
+}
+
+/**
+ * Member Function | DecisionTable | load
+ *
+ * @param string fileName: A table written by save. Check version against
+ *          the loaded KB before using it.
+ */
+void DecisionTable::load(const std::string& fileName)
+{
+    std::ifstream tableFile(fileName.c_str(), std::ios::in | std::ios::binary);
+    char magic[8];
+    if (!tableFile || !tableFile.read(magic, 8) || std::string(magic, 8) != TABLE_MAGIC)
+    {
+        throw std::runtime_error("Error reading decision table " + fileName + ".");
+    }
+
+    version = BinaryFormat::readWord(tableFile, 8);
+    goal.assign(BinaryFormat::readWord(tableFile, 4), ' ');
+    tableFile.read(&goal[0], goal.size());
+    variables.assign(BinaryFormat::readWord(tableFile, 4), std::string());
+    for (int variableIter = 0; (tableFile && variableIter < variables.size()); variableIter++)
+    {
+        variables.at(variableIter).assign(BinaryFormat::readWord(tableFile, 4), ' ');
+        tableFile.read(&variables.at(variableIter)[0], variables.at(variableIter).size());
+    }
+    leafCount = BinaryFormat::readWord(tableFile, 4);
+    nodes.assign(BinaryFormat::readWord(tableFile, 4), Node());
+    for (int nodeIter = 0; (tableFile && nodeIter < nodes.size()); nodeIter++)
+    {
+        nodes.at(nodeIter).variable = (int)BinaryFormat::readWord(tableFile, 4);
+        nodes.at(nodeIter).yes = (int)BinaryFormat::readWord(tableFile, 4);
+        nodes.at(nodeIter).no = (int)BinaryFormat::readWord(tableFile, 4);
+    }
+    mismatches.clear();
+
+    if (!tableFile)
+    {
+        throw std::runtime_error("Error reading decision table " + fileName + ".");
+    }
+}
+
+/**
+ * Member Function | DecisionTable | displaySummary
+ *
+ * Summary: Prints the size of the table and the outcome of the consistency
+ *          check, with every path on which the engines disagreed.
+ *
+ * @param KnowledgeBase knowledgeBase: The KB the table was built from.
+ * @param ostream& out: Where to print.
+ */
+void DecisionTable::displaySummary(std::ostream& out) const
+{
+    int provenCount = 0;
+    for (int nodeIter = 0; nodeIter < nodes.size(); nodeIter++)
+    {
+        if (nodes.at(nodeIter).variable < 0 && nodes.at(nodeIter).yes > 0)
+            provenCount++;
+    }
+
+    out << "Decision table for " << goal << ": " << leafCount << " path(s) over " << variables.size()
+        << " variable(s), " << provenCount << " ending in a conclusion, " << nodes.size() << " nodes ("
+        << nodes.size() * 12 << " bytes)." << std::endl;
+
+    if (mismatches.empty())
+    {
+        out << "BackChain, IterativeBackChain, BytecodeBackChain and ForwardChain agree on every path." << std::endl;
+        return;
+    }
+
+    out << mismatches.size() << " path(s) on which the engines disagree:" << std::endl;
+    for (int mismatchIter = 0; mismatchIter < mismatches.size(); mismatchIter++)
+    {
+        const Mismatch& mismatch = mismatches.at(mismatchIter);
+        out << " ";
+        for (int answerIter = 0; answerIter < mismatch.answers.size(); answerIter++)
+        {
+            out << " " << mismatch.answers.at(answerIter).first << " = " << mismatch.answers.at(answerIter).second;
+        }
+        out << ": " << mismatch.detail << std::endl;
+    }
+}
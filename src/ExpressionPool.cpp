@@ -0,0 +1,437 @@
+#include <algorithm>
+#include <set>
+
+#include "ExpressionPool.hpp"
+
+// A parsed premise before it is normalized: a test or a group, either of
+// which may be negated.
+struct ExpressionPool::Term
+{
+    Kind kind = LEAF;
+    bool isNegated = false;
+    std::string name;
+    std::string value;
+    std::vector<Term> operands;
+};
+
+namespace
+{
+    void skipSpaces(const std::string& text, size_t& position)
+    {
+        while (position < text.size() && (text[position] == ' ' || text[position] == '\t'))
+        {
+            position++;
+        }
+    }
+
+    std::string trim(const std::string& text)
+    {
+        size_t first = text.find_first_not_of(" \t");
+        if (first == std::string::npos)
+        {
+            return "";
+        }
+        return text.substr(first, text.find_last_not_of(" \t") - first + 1);
+    }
+}
+
+
+/**
+ * Constructor | ExpressionPool | ExpressionPool
+ *
+ * Summary: Starts the pool with a NULL node at index 0, as the other lists
+ *          of the KB do, so 0 can mean "not compiled".
+ */
+ExpressionPool::ExpressionPool()
+{
+    Node sentinel;
+    sentinel.kind = LEAF;
+    sentinel.isNegated = false;
+    nodes.push_back(sentinel);
+}
+
+/**
+ * Static Function | ExpressionPool | parsePremises
+ *
+ * Summary: Parses the premise side of a KB line with the full grammar: |
+ *          is OR, ^ is AND, ! before a test or a group is NOT, name != value
+ *          is the same as !name = value, and parentheses group. NOT binds
+ *          tightest, then AND, then OR. The premise is normalized, and each
+ *          operand of an AND at the top becomes one premise; a plain
+ *          name = value stays an ordinary premise, anything else becomes an
+ *          EXPRESSION premise named by its canonical text.
+ *
+ * @param string premiseText: Everything before the : of the line.
+ * @param vector<ClauseItem>& premiseList: The premises are appended to it.
+ *
+ * @return bool: False if the text is not well formed; nothing is appended.
+ */
+bool ExpressionPool::parsePremises(const std::string& premiseText, std::vector<ClauseItem>& premiseList)
+{
+    Term parsed;
+    if (!parse(premiseText, parsed))
+    {
+        return false;
+    }
+
+    Term root = normalize(parsed, false);
+    std::vector<Term> premises;
+    if (root.kind == AND)
+        premises = root.operands;
+    else
+        premises.push_back(root);
+
+    for (int premiseIter = 0; premiseIter < premises.size(); premiseIter++)
+    {
+        const Term& premise = premises.at(premiseIter);
+        if (premise.kind == LEAF && !premise.isNegated)
+            premiseList.push_back(ClauseItem(premise.name, premise.value, STRING));
+        else
+            premiseList.push_back(ClauseItem(render(premise), "", EXPRESSION));
+    }
+    return true;
+}
+
+/**
+ * Member Function | ExpressionPool | compile
+ *
+ * Summary: Adds an EXPRESSION premise to the pool, sharing every node that
+ *          is already there. Compiling the same text again costs a lookup.
+ *
+ * @param string expressionText: The name of an EXPRESSION premise.
+ *
+ * @return int: The id of its node, or 0 if the text is not well formed.
+ */
+int ExpressionPool::compile(const std::string& expressionText)
+{
+    int id = find(expressionText);
+    if (id > 0)
+    {
+        return id;
+    }
+
+    Term parsed;
+    if (!parse(expressionText, parsed))
+    {
+        return 0;
+    }
+
+    id = intern(normalize(parsed, false));
+    expressionIds[expressionText] = id;
+    return id;
+}
+
+/**
+ * Member Function | ExpressionPool | find
+ *
+ * @param string expressionText: The name of an EXPRESSION premise.
+ *
+ * @return int: The id of its node, or 0 if it was never compiled.
+ */
+int ExpressionPool::find(const std::string& expressionText) const
+{
+    std::unordered_map<std::string, int>::const_iterator found = expressionIds.find(expressionText);
+    return (found != expressionIds.end()) ? found->second : 0;
+}
+
+/**
+ * Member Function | ExpressionPool | node
+ *
+ * @param int id: A node id.
+ *
+ * @return Node: The node; it does not move while the pool lives.
+ */
+const ExpressionPool::Node& ExpressionPool::node(int id) const
+{
+    return nodes.at(id);
+}
+
+/**
+ * Member Function | ExpressionPool | size
+ *
+ * @return int: The number of distinct nodes, the NULL node aside.
+ */
+int ExpressionPool::size() const
+{
+    return nodes.size() - 1;
+}
+
+/**
+ * Member Function | ExpressionPool | expressionCount
+ *
+ * @return int: The number of distinct EXPRESSION premises compiled.
+ */
+int ExpressionPool::expressionCount() const
+{
+    return expressionIds.size();
+}
+
+/**
+ * Static Function | ExpressionPool | parse
+ *
+ * @param string text: A premise side, or the text of an EXPRESSION premise.
+ * @param Term& term: Receives the parse.
+ *
+ * @return bool: False unless all of the text is one well formed term.
+ */
+bool ExpressionPool::parse(const std::string& text, Term& term)
+{
+    size_t position = 0;
+    if (!parseTerm(text, position, 0, 0, term))
+    {
+        return false;
+    }
+    skipSpaces(text, position);
+    return position == text.size();
+}
+
+/**
+ * Static Function | ExpressionPool | parseTerm
+ *
+ * Summary: Recursive descent over the three levels of precedence. A value
+ *          runs to the next ^ or |, or to the ) closing its group, so values
+ *          of existing KBs that contain ) or ! outside a group still load.
+ *
+ * @param string text: What is parsed.
+ * @param size_t& position: Where the term starts; moved past it.
+ * @param int depth: How many parentheses are open.
+ * @param int precedence: 0 for an OR, 1 for an AND, 2 for a NOT, a group or
+ *          a test.
+ * @param Term& term: Receives the term.
+ *
+ * @return bool: False if the term is not well formed.
+ */
+bool ExpressionPool::parseTerm(const std::string& text, size_t& position, int depth, int precedence, Term& term)
+{
+    skipSpaces(text, position);
+
+    if (precedence < 2)
+    {
+        char separator = (precedence == 0) ? '|' : '^';
+        Term first;
+        if (!parseTerm(text, position, depth, precedence + 1, first))
+        {
+            return false;
+        }
+
+        skipSpaces(text, position);
+        if (position >= text.size() || text[position] != separator)
+        {
+            term = first;
+            return true;
+        }
+
+        term.kind = (precedence == 0) ? OR : AND;
+        term.operands.push_back(first);
+        while (position < text.size() && text[position] == separator)
+        {
+            position++;
+            Term next;
+            if (!parseTerm(text, position, depth, precedence + 1, next))
+            {
+                return false;
+            }
+            term.operands.push_back(next);
+            skipSpaces(text, position);
+        }
+        return true;
+    }
+
+    if (position < text.size() && text[position] == '!')
+    {
+        position++;
+        if (!parseTerm(text, position, depth, 2, term))
+        {
+            return false;
+        }
+        term.isNegated = !term.isNegated;
+        return true;
+    }
+
+    if (position < text.size() && text[position] == '(')
+    {
+        position++;
+        if (!parseTerm(text, position, depth + 1, 0, term))
+        {
+            return false;
+        }
+        skipSpaces(text, position);
+        if (position >= text.size() || text[position] != ')')
+        {
+            return false;
+        }
+        position++;
+        return true;
+    }
+
+    // A test: name = value, or name != value.
+    size_t equalsLocation = text.find('=', position);
+    if (equalsLocation == std::string::npos)
+    {
+        return false;
+    }
+
+    term.kind = LEAF;
+    term.name = trim(text.substr(position, equalsLocation - position));
+    if (!term.name.empty() && term.name.back() == '!')
+    {
+        term.isNegated = true;
+        term.name = trim(term.name.substr(0, term.name.size() - 1));
+    }
+    if (term.name.empty() || term.name.find_first_of("()|^") != std::string::npos)
+    {
+        return false;
+    }
+
+    position = equalsLocation + 1;
+    size_t valueStart = position;
+    while (position < text.size() && text[position] != '^' && text[position] != '|' && !(text[position] == ')' && depth > 0))
+    {
+        position++;
+    }
+    term.value = trim(text.substr(valueStart, position - valueStart));
+    return !term.value.empty();
+}
+
+/**
+ * Static Function | ExpressionPool | normalize
+ *
+ * Summary: Pushes NOT down to the tests (De Morgan, a double NOT cancels),
+ *          flattens an AND in an AND and an OR in an OR, drops an operand
+ *          equal to one before it and replaces a group of one by its operand.
+ *          The operands keep their order.
+ *
+ * @param Term term: A parsed term.
+ * @param bool isNegated: Whether a NOT above applies to it.
+ *
+ * @return Term: The normal form.
+ */
+ExpressionPool::Term ExpressionPool::normalize(const Term& term, bool isNegated)
+{
+    bool isTermNegated = (isNegated != term.isNegated);
+    if (term.kind == LEAF)
+    {
+        Term leaf = term;
+        leaf.isNegated = isTermNegated;
+        return leaf;
+    }
+
+    Term group;
+    group.kind = term.kind;
+    if (isTermNegated)
+    {
+        group.kind = (term.kind == AND) ? OR : AND;
+    }
+
+    std::set<std::string> seen;
+    for (int operandIter = 0; operandIter < term.operands.size(); operandIter++)
+    {
+        Term operand = normalize(term.operands.at(operandIter), isTermNegated);
+        std::vector<Term> parts;
+        if (operand.kind == group.kind)
+            parts.swap(operand.operands);
+        else
+            parts.push_back(operand);
+
+        for (int partIter = 0; partIter < parts.size(); partIter++)
+        {
+            if (seen.insert(render(parts.at(partIter))).second)
+            {
+                group.operands.push_back(parts.at(partIter));
+            }
+        }
+    }
+
+    if (group.operands.size() == 1)
+    {
+        return group.operands.front();
+    }
+    return group;
+}
+
+/**
+ * Static Function | ExpressionPool | render
+ *
+ * @param Term term: A normalized term.
+ *
+ * @return string: Its canonical text, which parses back to the same term.
+ */
+std::string ExpressionPool::render(const Term& term)
+{
+    if (term.kind == LEAF)
+    {
+        return term.name + (term.isNegated ? " != " : " = ") + term.value;
+    }
+
+    std::string text = "(";
+    for (int operandIter = 0; operandIter < term.operands.size(); operandIter++)
+    {
+        if (operandIter > 0)
+        {
+            text += (term.kind == AND) ? " ^ " : " | ";
+        }
+        text += render(term.operands.at(operandIter));
+    }
+    return text + ")";
+}
+
+/**
+ * Member Function | ExpressionPool | intern
+ *
+ * Summary: Finds or adds the node of a normalized term, its operands first,
+ *          so equal subterms of any premise end up as the same node.
+ *
+ * @param Term term: A normalized term.
+ *
+ * @return int: The node id.
+ */
+int ExpressionPool::intern(const Term& term)
+{
+    Node added;
+    added.kind = term.kind;
+    added.isNegated = term.isNegated;
+
+    std::string key;
+    if (term.kind == LEAF)
+    {
+        added.clause = ClauseItem(term.name, term.value, STRING);
+        key = (term.isNegated ? "!" : "=") + term.name + '\x1f' + term.value;
+    }
+    else
+    {
+        key = (term.kind == AND) ? "&" : "|";
+        for (int operandIter = 0; operandIter < term.operands.size(); operandIter++)
+        {
+            int operand = intern(term.operands.at(operandIter));
+            added.operands.push_back(operand);
+            key += std::to_string(operand) + ",";
+        }
+    }
+
+    std::unordered_map<std::string, int>::const_iterator existing = nodeIds.find(key);
+    if (existing != nodeIds.end())
+    {
+        return existing->second;
+    }
+
+    int id = nodes.size();
+    if (term.kind == LEAF)
+    {
+        added.leaves.push_back(id);
+    }
+    for (int operandIter = 0; operandIter < added.operands.size(); operandIter++)
+    {
+        const std::vector<int>& operandLeaves = nodes.at(added.operands.at(operandIter)).leaves;
+        for (int leafIter = 0; leafIter < operandLeaves.size(); leafIter++)
+        {
+            if (std::find(added.leaves.begin(), added.leaves.end(), operandLeaves.at(leafIter)) == added.leaves.end())
+            {
+                added.leaves.push_back(operandLeaves.at(leafIter));
+            }
+        }
+    }
+
+    nodes.push_back(added);
+    nodeIds[key] = id;
+    return id;
+}
@@ -1,6 +1,23 @@
+#include <algorithm>
 #include <iostream>
 
 #include "ForwardChain.hpp"
+#include "InferenceTrace.hpp"
+
+/**
+ * Constructor | ForwardChain | ForwardChain
+ *
+ * @param KnowledgeBase* sharedRuleSystem: A loaded knowledge base to chain
+ *          over instead of a copy (see copyKnowledgeBase). It is only read
+ *          and must outlive the instance. nullptr to own one.
+ */
+ForwardChain::ForwardChain(KnowledgeBase* sharedRuleSystem)
+    : ownedRuleSystem(sharedRuleSystem == nullptr ? new KnowledgeBase() : nullptr),
+      ruleSystem(sharedRuleSystem == nullptr ? *ownedRuleSystem : *sharedRuleSystem)
+{
+    if (ownedRuleSystem)
+        std::cout << "\nCreating knowledge base instance..." << std::endl;
+}
 
 /**
  * Member Function | ForwardChain | copyVariableList
@@ -64,6 +81,7 @@ void ForwardChain::copyKnowledgeBase(const KnowledgeBase &srcKnowledgeBase)
     {
         ruleSystem.kBase.push_back(srcKnowledgeBase.kBase.at(kBaseIter));
     }
+    ruleSystem.updateVersion();
 }
 
 /**
@@ -72,8 +90,14 @@ void ForwardChain::copyKnowledgeBase(const KnowledgeBase &srcKnowledgeBase)
  * Summary: Entry point for running forward chaining. This is expected to run
  *          after backward chaining, as part of the suggested fix step.
  *
+ * @param ostream& log: Where the progress and the final conclusion are
+ *          printed.
+ *
+ * @return ClauseItem: The final conclusion, named inconclusive if forward
+ *          chaining could not start, or the last one reached if the budget
+ *          ran out.
  */
-void ForwardChain::runForwardChaining()
+ClauseItem ForwardChain::runForwardChaining(std::ostream& log)
 {
     ClauseItem queueTopPtr;
     int variableListEntry;
@@ -81,27 +105,33 @@ void ForwardChain::runForwardChaining()
 
     queueTopPtr.name = "inconclusive";
     queueTopPtr.value = "no valid solution.";
+    budget.start();
 
-    std::cout << std::endl
-              << std::endl
-              << "Now running forward chain" << std::endl;
+    log << std::endl
+        << std::endl
+        << "Now running forward chain" << std::endl;
 
     // Start the chain by looking for the very first prompt, does it have an issue.
     // Note that this will also prevent forward chaining from running if the user
     // entered in a bad value to resolve while back chaining.
     initialRepairEntry = getMatchingVariableListEntry("has_issue");
 
-    if (variableList.at(initialRepairEntry).instantiated)
+    if (threadPool != nullptr && ruleStrata != nullptr && ruleStrata->isAcyclic && ruleStrata->version == ruleSystem.version)
+    {
+        return runLevelParallel(initialRepairEntry, log);
+    }
+
+    if (initialRepairEntry != -1 && variableList.at(initialRepairEntry).instantiated)
     {
         conclusionVariableQueue.push(ClauseItem(variableList.at(initialRepairEntry).name,
                                                 variableList.at(initialRepairEntry).value,
                                                 variableList.at(initialRepairEntry).type));
     }
 
-    while (!conclusionVariableQueue.empty())
+    while (!conclusionVariableQueue.empty() && !budget.isStopped())
     {
         queueTopPtr = conclusionVariableQueue.front();
-        std::cout << "Processing " << queueTopPtr.name << std::endl;
+        log << "Processing " << queueTopPtr.name << std::endl;
         // Note that this is the only location where the queue is reduced.
         conclusionVariableQueue.pop();
 
@@ -116,7 +146,168 @@ void ForwardChain::runForwardChaining()
         }
     }
 
-    std::cout << "The final conclusion is - " << queueTopPtr.name << " - with a value of: " << queueTopPtr.value << std::endl;
+    // Out of budget: the last conclusion reached is the best there is.
+    if (budget.isStopped())
+    {
+        log << "Forward chaining stopped early because " << budget.describe() << "." << std::endl;
+    }
+
+    log << "The final conclusion is - " << queueTopPtr.name << " - with a value of: " << queueTopPtr.value << std::endl;
+    return queueTopPtr;
+}
+
+/**
+ * Member Function | ForwardChain | runLevelParallel
+ *
+ * Summary: Forward chaining a level at a time (see RuleStrata). A rule is
+ *          tried once a conclusion it has a premise on was reached, as when
+ *          it comes up in the queue, and everything it needs to know is known
+ *          by the time its level starts. So each level is tried on the pool
+ *          in chunks, with a barrier after it, and what fired is merged in KB
+ *          order. The conclusions reached are those the queue reaches; the
+ *          final one is the last of the highest level that fired anything.
+ *
+ * @param int initialRepairEntry: The has_issue entry, or -1.
+ * @param ostream& log: Where the progress and the final conclusion are
+ *          printed.
+ *
+ * @return ClauseItem: As from runForwardChaining.
+ */
+ClauseItem ForwardChain::runLevelParallel(int initialRepairEntry, std::ostream& log)
+{
+    ClauseItem lastConclusion("inconclusive", "no valid solution.", STRING);
+
+    std::set<std::pair<std::string, std::string> > facts;
+    std::set<std::string> reachedNames;
+    if (initialRepairEntry != -1 && variableList.at(initialRepairEntry).instantiated)
+    {
+        lastConclusion = ClauseItem(variableList.at(initialRepairEntry).name, variableList.at(initialRepairEntry).value,
+                                    variableList.at(initialRepairEntry).type);
+        reachedNames.insert(lastConclusion.name);
+        log << "Processing " << lastConclusion.name << std::endl;
+
+        // Premises are checked against the variable list only, as in
+        // instantiatePremiseClause; conclusions reached are not facts.
+        for (int varListIter = 1; varListIter < variableList.size(); varListIter++)
+        {
+            if (variableList.at(varListIter).instantiated)
+                facts.insert(std::make_pair(variableList.at(varListIter).name, variableList.at(varListIter).value));
+        }
+    }
+
+    for (int levelIter = 0; !reachedNames.empty() && levelIter < ruleStrata->levels.size() && budget.checkDeadline(); levelIter++)
+    {
+        const std::vector<int>& level = ruleStrata->levels.at(levelIter);
+        std::vector<char> isFired(level.size(), 0);
+
+        int chunkCount = std::min<int>(level.size(), threadPool->size() * 4);
+        int chunkSize = (level.size() + chunkCount - 1) / chunkCount;
+        chunkCount = (level.size() + chunkSize - 1) / chunkSize;
+        {
+            TaskGroup group(*threadPool);
+            for (int chunkIter = 0; chunkIter < chunkCount; chunkIter++)
+            {
+                group.run([&, chunkIter]()
+                {
+                    int lastRule = std::min<int>((chunkIter + 1) * chunkSize, level.size());
+                    for (int ruleIter = chunkIter * chunkSize; ruleIter < lastRule && budget.checkDeadline(); ruleIter++)
+                    {
+                        isFired.at(ruleIter) = isRuleReady(level.at(ruleIter), facts, reachedNames);
+                    }
+                });
+            }
+            group.wait();
+        }
+
+        for (int ruleIter = 0; ruleIter < level.size(); ruleIter++)
+        {
+            if (isFired.at(ruleIter))
+            {
+                lastConclusion = ruleSystem.kBase.at(level.at(ruleIter)).conclusion;
+                if (reachedNames.insert(lastConclusion.name).second)
+                    log << "Processing " << lastConclusion.name << std::endl;
+            }
+        }
+    }
+
+    if (budget.isStopped())
+    {
+        log << "Forward chaining stopped early because " << budget.describe() << "." << std::endl;
+    }
+
+    log << "The final conclusion is - " << lastConclusion.name << " - with a value of: " << lastConclusion.value << std::endl;
+    return lastConclusion;
+}
+
+/**
+ * Member Function | ForwardChain | isRuleReady
+ *
+ * Summary: Whether a rule fires in level parallel forward chaining. Only
+ *          reads, so any number of workers may call it at once.
+ *
+ * @param int statement: The kBase index of the rule.
+ * @param set facts: The instantiated "name", "value" pairs.
+ * @param set reachedNames: The conclusions reached on lower levels.
+ *
+ * @return bool: True if the rule is in the relevance slice, if any, a
+ *          premise is on a reached conclusion and every premise holds.
+ */
+bool ForwardChain::isRuleReady(int statement, const std::set<std::pair<std::string, std::string> >& facts,
+                               const std::set<std::string>& reachedNames) const
+{
+    if (relevanceSlice != nullptr && !relevanceSlice->contains(statement))
+    {
+        return false;
+    }
+
+    const std::vector<ClauseItem>& premiseList = ruleSystem.kBase.at(statement).premiseList;
+
+    bool isReached = false;
+    for (int premiseIter = 1; !isReached && premiseIter < premiseList.size(); premiseIter++)
+    {
+        const ClauseItem& premise = premiseList.at(premiseIter);
+        if (premise.type == EXPRESSION)
+        {
+            std::vector<ClauseItem> tests = ruleSystem.premiseTests(premise);
+            for (int testIter = 0; !isReached && testIter < tests.size(); testIter++)
+            {
+                isReached = reachedNames.count(tests.at(testIter).name) > 0;
+            }
+        }
+        else
+        {
+            isReached = reachedNames.count(premise.name) > 0;
+        }
+    }
+    if (!isReached)
+    {
+        return false;
+    }
+
+    // See isExpressionLeafTrue; a name with a value is in facts from (name, "") on.
+    std::function<bool(const ExpressionPool::Node&)> isLeafTrue = [&facts](const ExpressionPool::Node& leaf)
+    {
+        std::pair<std::string, std::string> test(leaf.clause.name, leaf.clause.value);
+        if (!leaf.isNegated)
+            return facts.count(test) > 0;
+        std::set<std::pair<std::string, std::string> >::const_iterator known = facts.lower_bound(std::make_pair(test.first, std::string()));
+        return known != facts.end() && known->first == test.first && facts.count(test) == 0;
+    };
+
+    InferenceTrace::record(InferenceTrace::RULE_TRIED, statement);
+    for (int premiseIter = 1; premiseIter < premiseList.size(); premiseIter++)
+    {
+        const ClauseItem& premise = premiseList.at(premiseIter);
+        bool holds = (premise.type == EXPRESSION)
+            ? ruleSystem.expressions.evaluate(ruleSystem.expressions.find(premise.name), isLeafTrue)
+            : facts.count(std::make_pair(premise.name, premise.value)) > 0;
+        if (!holds)
+        {
+            return false;
+        }
+    }
+    InferenceTrace::record(InferenceTrace::RULE_FIRED, statement);
+    return true;
 }
 
 /**
@@ -143,8 +334,18 @@ void ForwardChain::processStatementIndex(int variableListEntry)
     {
         //           = The matching variable list entry  . The individual statment number
         curStatement = variableList.at(variableListEntry).statementIndex.at(variableListIter);
+        if (relevanceSlice != nullptr && !relevanceSlice->contains(curStatement))
+        {
+            continue;
+        }
+        if (!budget.chargeRule())
+        {
+            return;
+        }
+        InferenceTrace::record(InferenceTrace::RULE_TRIED, curStatement);
         if (true == processPremiseList(ruleSystem.kBase.at(curStatement).premiseList))
         {
+            InferenceTrace::record(InferenceTrace::RULE_FIRED, curStatement);
             // Everything matched up, so move forward on adding it to the queue to be
             // processed.
             conclusionVariableQueue.push(ruleSystem.kBase.at(curStatement).conclusion);
@@ -173,11 +374,54 @@ bool ForwardChain::processPremiseList(std::vector<ClauseItem> &premiseList)
 
     for (int premiseIter = 1; (isValid && premiseIter < premiseList.size()); premiseIter++)
     {
-        isValid = instantiatePremiseClause(premiseList.at(premiseIter));
+        const ClauseItem& premise = premiseList.at(premiseIter);
+        if (premise.type == EXPRESSION)
+        {
+            isValid = budget.chargePremise() &&
+                ruleSystem.expressions.evaluate(ruleSystem.expressions.find(premise.name),
+                    [this](const ExpressionPool::Node& leaf) { return isExpressionLeafTrue(leaf); });
+        }
+        else
+        {
+            isValid = budget.chargePremise() && instantiatePremiseClause(premise);
+        }
     }
     return isValid;
 }
 
+/**
+ * Member Function | ForwardChain | isExpressionLeafTrue
+ *
+ * Summary: Decides one test of an OR/NOT premise from the variable list:
+ *          name = value must be there, name != value needs name there with
+ *          another value.
+ *
+ * @param const ExpressionPool::Node& leaf: A LEAF node.
+ *
+ * @return bool: Whether the test holds.
+ */
+bool ForwardChain::isExpressionLeafTrue(const ExpressionPool::Node& leaf)
+{
+    if (!leaf.isNegated)
+    {
+        return instantiatePremiseClause(leaf.clause);
+    }
+
+    bool isKnown = false;
+    for (int varListIter = 1; varListIter < variableList.size(); varListIter++)
+    {
+        if (variableList.at(varListIter).instantiated && leaf.clause.name == variableList.at(varListIter).name)
+        {
+            if (leaf.clause.value == variableList.at(varListIter).value)
+            {
+                return false;
+            }
+            isKnown = true;
+        }
+    }
+    return isKnown;
+}
+
 /**
  * Member Function | ForwardChain | instantiatePremiseClause
  *
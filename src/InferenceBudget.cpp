@@ -0,0 +1,89 @@
+#include <sstream>
+
+#include "InferenceBudget.hpp"
+
+
+/**
+ * Constructor | InferenceBudget | InferenceBudget
+ *
+ * Summary: An unlimited budget; set limits, then start it for each request.
+ */
+InferenceBudget::InferenceBudget()
+    : ruleEvaluations(0), premiseChecks(0), stopReason(NOT_STOPPED), hasDeadline(false)
+{
+}
+
+/**
+ * Member Function | InferenceBudget | start
+ *
+ * Summary: Starts a new request: the counters go back to zero and the
+ *          deadline, if any, is set from now.
+ */
+void InferenceBudget::start()
+{
+    ruleEvaluations = 0;
+    premiseChecks = 0;
+    stopReason.store(NOT_STOPPED, std::memory_order_relaxed);
+    hasDeadline = limits.timeLimitMilliseconds > 0;
+    if (hasDeadline)
+    {
+        deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(limits.timeLimitMilliseconds);
+    }
+}
+
+/**
+ * Member Function | InferenceBudget | checkDeadline
+ *
+ * Summary: Reads the clock and stops the budget if the deadline passed. Safe
+ *          to call from several threads.
+ *
+ * @return bool: False once the budget is stopped, for whatever reason.
+ */
+bool InferenceBudget::checkDeadline()
+{
+    if (hasDeadline && std::chrono::steady_clock::now() >= deadline)
+    {
+        stop(DEADLINE);
+    }
+    return !isStopped();
+}
+
+/**
+ * Member Function | InferenceBudget | describe
+ *
+ * @return string: Why the budget stopped, for the user; empty if it did not.
+ */
+std::string InferenceBudget::describe() const
+{
+    std::stringstream description;
+    switch (getStopReason())
+    {
+    case RULE_LIMIT:
+        description << "the limit of " << limits.maxRuleEvaluations << " rule evaluations was reached";
+        break;
+    case PREMISE_LIMIT:
+        description << "the limit of " << limits.maxPremiseChecks << " premise checks was reached";
+        break;
+    case DEADLINE:
+        description << "the time limit of " << limits.timeLimitMilliseconds << " ms ran out";
+        break;
+    default:
+        break;
+    }
+    return description.str();
+}
+
+/**
+ * Member Function | InferenceBudget | stop
+ *
+ * Summary: Stops the budget. The first reason is kept. The engines stop it
+ *          through the charges; a caller passing on another budget's
+ *          outcome (see Speculation) stops it directly.
+ *
+ * @param StopReason reason: Why it stopped.
+ */
+void InferenceBudget::stop(StopReason reason)
+{
+    int notStopped = NOT_STOPPED;
+    stopReason.compare_exchange_strong(notStopped, reason, std::memory_order_relaxed);
+}
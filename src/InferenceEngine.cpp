@@ -0,0 +1,331 @@
+#include <ostream>
+#include <stdexcept>
+
+#include "InferenceEngine.hpp"
+#include "IterativeBackChain.hpp"
+#include "ForwardChain.hpp"
+#include "SessionCheckpoint.hpp"
+
+
+/**
+ * Static Function | KnowledgeHandle | load
+ *
+ * Summary: Loads a knowledge base and variable list without printing the
+ *          load log or pausing for the user. Malformed KB lines are skipped
+ *          with a single warning on std::cerr.
+ *
+ * @param string knowledgeBaseFile: A file in the knowledgeBase.txt format.
+ * @param string variableListFile: A file in the variablesList.csv format.
+ *
+ * @return shared_ptr<KnowledgeHandle>: The loaded handle.
+ */
+std::shared_ptr<KnowledgeHandle> KnowledgeHandle::load(const std::string& knowledgeBaseFile, const std::string& variableListFile)
+{
+    std::shared_ptr<KnowledgeHandle> handle(new KnowledgeHandle());
+
+    // To offest the vectors by 1, populate index 0 with NULL or Empty elements.
+    handle->ruleSystem.kBase.push_back(Statement());
+    handle->ruleSystem.appendKnowledgeBase(knowledgeBaseFile);
+
+    BackChain loader(&handle->ruleSystem);
+    std::ostream nullLog(nullptr);
+    loader.variableList.push_back(VariableListItem("Empty", false, "", "This is an error string", STRING));
+    loader.populateVariableList(variableListFile, nullLog);
+    if (loader.variableList.size() <= 1)
+    {
+        throw std::runtime_error("Error reading variable list file " + variableListFile + ".");
+    }
+    handle->variableList.swap(loader.variableList);
+
+    return handle;
+}
+
+/**
+ * Member Function | KnowledgeHandle | knowledgeBase
+ *
+ * @return const KnowledgeBase&: The loaded statements and conclusion set.
+ */
+const KnowledgeBase& KnowledgeHandle::knowledgeBase() const
+{
+    return ruleSystem;
+}
+
+/**
+ * Member Function | KnowledgeHandle | variables
+ *
+ * @return const vector<VariableListItem>&: The variable list, none of them
+ *          instantiated. Index 0 is the Empty placeholder.
+ */
+const std::vector<VariableListItem>& KnowledgeHandle::variables() const
+{
+    return variableList;
+}
+
+/**
+ * Constructor | InferenceSession | InferenceSession
+ *
+ * @param shared_ptr<KnowledgeHandle> handleP: The loaded KB to solve against.
+ * @param FactProvider* factProviderP: Where unknown values come from. With
+ *          none, a variable that was not set is simply unknown.
+ * @param bool isIterative: Solve with IterativeBackChain, so deep chains
+ *          cannot overflow the calling thread's stack.
+ */
+InferenceSession::InferenceSession(std::shared_ptr<KnowledgeHandle> handleP, FactProvider* factProviderP, bool isIterative)
+    : handle(handleP)
+{
+    if (isIterative)
+        backChain.reset(new IterativeBackChain(4096, &handle->ruleSystem));
+    else
+        backChain.reset(new BackChain(&handle->ruleSystem));
+
+    backChain->variableList = handle->variableList;
+    backChain->intermediateConclusionList.push_back(VariableListItem("Empty", false, "", "This is an error string", STRING));
+    setFactProvider(factProviderP);
+}
+
+/**
+ * Member Function | InferenceSession | setFact
+ *
+ * Summary: Gives a variable its value. Conclusions already proven from an
+ *          earlier value are retracted (see correctFact).
+ *
+ * @param string name: The variable.
+ * @param string value: Its value, possibly followed by its certainty, e.g.
+ *          y [0.6].
+ *
+ * @return bool: False if the name is not in the variable list or the
+ *          certainty is not in (0, 1].
+ */
+bool InferenceSession::setFact(const std::string& name, const std::string& value)
+{
+    return backChain->changeFact(name, value) >= 0;
+}
+
+/**
+ * Member Function | InferenceSession | solve
+ *
+ * Summary: Solves one goal with the facts set so far, asking the fact
+ *          provider for any other value it needs. Providers that take
+ *          batches get one request for every variable the goal might need.
+ *
+ * @param string goal: A conclusion name.
+ * @param Limits limits: The budget of this request; unlimited by default.
+ *
+ * @return InferenceResult: The outcome, with its proof. When the budget ran
+ *          out, the conclusions proven by then.
+ */
+InferenceResult InferenceSession::solve(const std::string& goal, const InferenceBudget::Limits& limits)
+{
+    backChain->budget.limits = limits;
+    int firstIntermediate = backChain->intermediateConclusionList.size();
+    int promptsBefore = backChain->promptCount;
+    int requestsBefore = backChain->providerRequests;
+    int location = backChain->solveGoal(goal);
+
+    InferenceResult result;
+    result.goal = goal;
+    result.statement = 0;
+    result.questionsAsked = backChain->promptCount - promptsBefore;
+    result.providerRequests = backChain->providerRequests - requestsBefore;
+    result.isCached = backChain->isLastResultCached;
+    result.stopReason = backChain->budget.getStopReason();
+    result.ruleEvaluations = backChain->budget.ruleEvaluations;
+    result.premiseChecks = backChain->budget.premiseChecks;
+
+    if (location > 0)
+    {
+        result.status = InferenceResult::PROVEN;
+        result.value = backChain->ruleSystem.kBase.at(location).conclusion.value;
+        result.statement = location;
+        result.proof = backChain->getProof(location);
+    }
+    else if (result.stopReason != InferenceBudget::NOT_STOPPED)
+    {
+        result.status = InferenceResult::STOPPED;
+    }
+    else
+    {
+        result.status = (location == -1) ? InferenceResult::INCONCLUSIVE : InferenceResult::NOT_A_CONCLUSION;
+    }
+
+    for (int conclusionIter = firstIntermediate; conclusionIter < backChain->intermediateConclusionList.size(); conclusionIter++)
+    {
+        const VariableListItem& conclusion = backChain->intermediateConclusionList.at(conclusionIter);
+        result.intermediateConclusions.push_back(ClauseItem(conclusion.name, conclusion.value, conclusion.type));
+    }
+
+    return result;
+}
+
+/**
+ * Member Function | InferenceSession | solveAll
+ *
+ * Summary: Solves several goals in one pass over the session's working
+ *          memory; a subgoal they share is proven or disproven only once
+ *          (see BackChain::solveGoals).
+ *
+ * @param vector<string> goals: The conclusions to solve, in order. Empty for
+ *          every conclusion in the knowledge base.
+ * @param Limits limits: The budget of each goal.
+ *
+ * @return vector<InferenceResult>: One result per goal, in the same order.
+ */
+std::vector<InferenceResult> InferenceSession::solveAll(const std::vector<std::string>& goals, const InferenceBudget::Limits& limits)
+{
+    std::vector<std::string> allGoals(handle->ruleSystem.conclusionSet.begin(), handle->ruleSystem.conclusionSet.end());
+    const std::vector<std::string>& goalsToSolve = goals.empty() ? allGoals : goals;
+
+    std::vector<InferenceResult> results;
+    for (int goalIter = 0; goalIter < goalsToSolve.size(); goalIter++)
+    {
+        results.push_back(solve(goalsToSolve.at(goalIter), limits));
+    }
+
+    return results;
+}
+
+/**
+ * Member Function | InferenceSession | recommend
+ *
+ * Summary: Forward chains from the session's facts and proven conclusions,
+ *          as the repair step of the console program does.
+ *
+ * @param Limits limits: The budget of forward chaining; unlimited by default.
+ * @param StopReason* stopReason: Receives why forward chaining stopped
+ *          early, or NOT_STOPPED. May be nullptr.
+ *
+ * @return ClauseItem: The final conclusion, named inconclusive if forward
+ *          chaining could not start, or the last one reached if the budget
+ *          ran out.
+ */
+ClauseItem InferenceSession::recommend(const InferenceBudget::Limits& limits, InferenceBudget::StopReason* stopReason)
+{
+    ForwardChain forwardChain(&handle->ruleSystem);
+    forwardChain.copyVariableList(backChain->variableList);
+    forwardChain.addIntermediateConclusions(backChain->intermediateConclusionList);
+    forwardChain.budget.limits = limits;
+
+    std::ostream nullLog(nullptr);
+    ClauseItem conclusion = forwardChain.runForwardChaining(nullLog);
+    if (stopReason != nullptr)
+    {
+        *stopReason = forwardChain.budget.getStopReason();
+    }
+    return conclusion;
+}
+
+/**
+ * Member Function | InferenceSession | rankCandidates
+ *
+ * Summary: Ranks the rules for a goal by how close the session's facts and
+ *          conclusions come to them, typically after solve found the goal
+ *          inconclusive. Nothing is asked of the fact provider.
+ *
+ * @param string goal: A conclusion name, e.g. repair.
+ * @param int count: How many candidates to return at most.
+ *
+ * @return vector<Candidate>: The closest rules, best first, each with its
+ *          premises that are still unknown.
+ */
+std::vector<PartialMatch::Candidate> InferenceSession::rankCandidates(const std::string& goal, int count)
+{
+    return backChain->partialMatch.rank(goal, count, backChain->ruleSystem, backChain->variableList,
+                                        backChain->intermediateConclusionList);
+}
+
+/**
+ * Member Function | InferenceSession | rankByCertainty
+ *
+ * Summary: Ranks the values of a goal by how certain the facts set so far
+ *          make them, from every rule at once. A fact set as y [0.6] is 60%
+ *          sure. Nothing is asked of the fact provider.
+ *
+ * @param string goal: A conclusion name, e.g. repair.
+ * @param int count: How many values to return at most.
+ *
+ * @return vector<Candidate>: The values with a certainty above 0, most
+ *          certain first.
+ */
+std::vector<CertaintyRanking::Candidate> InferenceSession::rankByCertainty(const std::string& goal, int count)
+{
+    return backChain->certaintyRanking.rank(goal, count, backChain->ruleSystem, backChain->variableList);
+}
+
+/**
+ * Member Function | InferenceSession | correctFact
+ *
+ * Summary: Changes a value given earlier. Only the conclusions that depended
+ *          on it are retracted; solve the goal again to re-derive them.
+ *
+ * @param string name: The variable.
+ * @param string value: Its new value.
+ *
+ * @return int: The number of conclusions retracted, or -1 if the name is not
+ *          in the variable list.
+ */
+int InferenceSession::correctFact(const std::string& name, const std::string& value)
+{
+    return backChain->changeFact(name, value);
+}
+
+/**
+ * Member Function | InferenceSession | reset
+ *
+ * Summary: Forgets every fact and conclusion, ready for the next diagnosis.
+ */
+void InferenceSession::reset()
+{
+    backChain->resetSession();
+}
+
+/**
+ * Member Function | InferenceSession | checkpoint
+ *
+ * Summary: Packs the session between solves so it can be parked, on disk or
+ *          elsewhere, and the session object released (see SessionCheckpoint).
+ *
+ * @return string: The checkpoint, binary.
+ */
+std::string InferenceSession::checkpoint() const
+{
+    return SessionCheckpoint::save(*backChain);
+}
+
+/**
+ * Member Function | InferenceSession | restore
+ *
+ * Summary: Continues a parked session, typically in a new session on a
+ *          handle loaded from the same files. Solve the goal again to carry
+ *          on where it was left.
+ *
+ * @param string checkpointP: As returned by checkpoint.
+ *
+ * @return bool: False, with the session reset, if the checkpoint was taken
+ *          with another knowledge base or variable list, or is malformed.
+ */
+bool InferenceSession::restore(const std::string& checkpointP)
+{
+    return SessionCheckpoint::restore(*backChain, checkpointP);
+}
+
+/**
+ * Member Function | InferenceSession | setFactProvider
+ *
+ * @param FactProvider* factProviderP: Where unknown values come from, or
+ *          nullptr for none. Never the console.
+ */
+void InferenceSession::setFactProvider(FactProvider* factProviderP)
+{
+    backChain->factProvider = (factProviderP != nullptr) ? factProviderP : &noFactProvider;
+}
+
+/**
+ * Member Function | InferenceSession | setResultCache
+ *
+ * @param ResultCache* resultCache: A cache shared with other sessions on the
+ *          same handle, or nullptr for none.
+ */
+void InferenceSession::setResultCache(ResultCache* resultCache)
+{
+    backChain->resultCache = resultCache;
+}
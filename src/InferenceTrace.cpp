@@ -0,0 +1,305 @@
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+#include "InferenceTrace.hpp"
+#include "BinaryFormat.hpp"
+
+#define TRACE_LOG_MAGIC "VDTRACE1"
+
+std::atomic<bool> InferenceTrace::enabled(false);
+
+namespace
+{
+    // One thread's ring. Each slot holds the global sequence number of its
+    // event and the event itself packed into a second word:
+    // type (8 bits) | flag (8 bits) | premise (16 bits) | statement (32 bits).
+    // Both words are atomics, so a reader racing the writer sees either the
+    // old or the new value of each, and the sequence tells which.
+    struct TraceRing
+    {
+        TraceRing(unsigned int threadP) : head(0), thread(threadP)
+        {
+            for (int slot = 0; slot < TRACE_RING_SIZE; slot++)
+            {
+                sequences[slot].store(0, std::memory_order_relaxed);
+                packedEvents[slot].store(0, std::memory_order_relaxed);
+            }
+        }
+
+        std::atomic<unsigned long long> head;   // events ever written
+        unsigned int thread;
+        std::atomic<unsigned long long> sequences[TRACE_RING_SIZE];
+        std::atomic<unsigned long long> packedEvents[TRACE_RING_SIZE];
+    };
+
+    std::mutex registryLock;
+    std::vector<std::shared_ptr<TraceRing> > registry;
+    std::atomic<unsigned long long> nextSequence(1);
+    std::atomic<unsigned long long> clearedBefore(0);
+    thread_local TraceRing* currentRing = nullptr;
+    thread_local bool isThreadMuted = false;
+
+    TraceRing& ringForThisThread()
+    {
+        if (currentRing == nullptr)
+        {
+            std::lock_guard<std::mutex> guard(registryLock);
+            registry.push_back(std::make_shared<TraceRing>(registry.size()));
+            currentRing = registry.back().get();
+        }
+        return *currentRing;
+    }
+}
+
+
+/**
+ * Static Function | InferenceTrace | enable
+ *
+ * @param bool isOn: Whether the engines record events from now on.
+ */
+void InferenceTrace::enable(bool isOn)
+{
+    enabled.store(isOn, std::memory_order_relaxed);
+}
+
+/**
+ * Static Function | InferenceTrace | muteThisThread
+ *
+ * Summary: Keeps the calling thread's events out of the trace, for work
+ *          that may be thrown away, such as speculative evaluation.
+ *
+ * @param bool isMuted: Whether this thread's events are dropped.
+ */
+void InferenceTrace::muteThisThread(bool isMuted)
+{
+    isThreadMuted = isMuted;
+}
+
+/**
+ * Static Function | InferenceTrace | append
+ *
+ * Summary: Writes one event into the calling thread's ring, overwriting the
+ *          oldest event once the ring is full. Only the owning thread calls
+ *          this for a given ring, so no lock or read-modify-write on the
+ *          ring is needed.
+ */
+void InferenceTrace::append(EventType type, int statement, int premise, int flag)
+{
+    if (isThreadMuted)
+    {
+        return;
+    }
+
+    TraceRing& ring = ringForThisThread();
+    unsigned long long position = ring.head.load(std::memory_order_relaxed);
+    unsigned int slot = position & (TRACE_RING_SIZE - 1);
+
+    unsigned long long packed = ((unsigned long long)(type & 0xFF) << 56) |
+                                ((unsigned long long)(flag & 0xFF) << 48) |
+                                ((unsigned long long)(premise & 0xFFFF) << 32) |
+                                (unsigned long long)(unsigned int)statement;
+
+    // Zero the sequence first so a reader copying this slot right now
+    // notices the change, as in a seqlock.
+    ring.sequences[slot].store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    ring.packedEvents[slot].store(packed, std::memory_order_relaxed);
+    ring.sequences[slot].store(nextSequence.fetch_add(1, std::memory_order_relaxed), std::memory_order_release);
+    ring.head.store(position + 1, std::memory_order_release);
+}
+
+/**
+ * Static Function | InferenceTrace | clear
+ *
+ * Summary: Hides every event recorded so far from later snapshots, e.g.
+ *          between sessions. The rings themselves are left alone, since only
+ *          their owning threads may write them.
+ */
+void InferenceTrace::clear()
+{
+    clearedBefore.store(nextSequence.load());
+}
+
+/**
+ * Static Function | InferenceTrace | snapshot
+ *
+ * Summary: Copies the events of every thread's ring, oldest first. A slot
+ *          whose sequence changed while it was being copied was overwritten
+ *          and is dropped.
+ *
+ * @return vector<Event>: The events in the order they were recorded.
+ */
+std::vector<InferenceTrace::Event> InferenceTrace::snapshot()
+{
+    std::vector<std::shared_ptr<TraceRing> > rings;
+    {
+        std::lock_guard<std::mutex> guard(registryLock);
+        rings = registry;
+    }
+
+    std::vector<Event> events;
+    unsigned long long firstSequence = clearedBefore.load();
+
+    for (int ringIter = 0; ringIter < rings.size(); ringIter++)
+    {
+        TraceRing& ring = *rings.at(ringIter);
+        unsigned long long head = ring.head.load(std::memory_order_acquire);
+        unsigned long long position = (head > TRACE_RING_SIZE) ? head - TRACE_RING_SIZE : 0;
+
+        for (; position < head; position++)
+        {
+            unsigned int slot = position & (TRACE_RING_SIZE - 1);
+            unsigned long long sequence = ring.sequences[slot].load(std::memory_order_acquire);
+            unsigned long long packed = ring.packedEvents[slot].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (sequence == 0 || sequence < firstSequence || ring.sequences[slot].load(std::memory_order_relaxed) != sequence)
+            {
+                continue;
+            }
+
+            Event event;
+            event.sequence = sequence;
+            event.thread = ring.thread;
+            event.type = (EventType)((packed >> 56) & 0xFF);
+            event.flag = (packed >> 48) & 0xFF;
+            event.premise = (packed >> 32) & 0xFFFF;
+            event.statement = (int)(unsigned int)(packed & 0xFFFFFFFF);
+            events.push_back(event);
+        }
+    }
+
+    std::sort(events.begin(), events.end(), [](const Event& left, const Event& right) { return left.sequence < right.sequence; });
+    return events;
+}
+
+/**
+ * Static Function | InferenceTrace | explain
+ *
+ * Summary: Prints a trace as "why" and "how" explanations: why each question
+ *          was asked (the rule whose premise needed the answer) and
+ *          how each conclusion was reached (the rule that fired and the
+ *          premises it needed).
+ *
+ * @param const vector<Event>& events: From snapshot() or readLog().
+ * @param const KnowledgeBase& knowledgeBase: The KB the trace was taken on.
+ * @param ostream& out: Where the explanation is printed.
+ */
+void InferenceTrace::explain(const std::vector<Event>& events, const KnowledgeBase& knowledgeBase, std::ostream& out)
+{
+    for (int eventIter = 0; eventIter < events.size(); eventIter++)
+    {
+        const Event& event = events.at(eventIter);
+        if (event.statement < 0 || event.statement >= knowledgeBase.kBase.size())
+        {
+            continue;
+        }
+
+        const Statement& statement = knowledgeBase.kBase.at(event.statement);
+        const ClauseItem& premise = statement.premiseList.at(std::min<int>(event.premise, statement.premiseList.size() - 1));
+
+        switch (event.type)
+        {
+        case GOAL_PUSHED:
+            if (event.statement > 0)
+                out << "  goal " << premise.describe() << " (premise " << event.premise << " of rule " << event.statement << ")\n";
+            break;
+        case RULE_TRIED:
+            out << "  trying rule " << event.statement << " for " << statement.conclusion.name << " = " << statement.conclusion.value << "\n";
+            break;
+        case PREMISE_FAILED:
+            if (premise.type == EXPRESSION)
+                out << "  rule " << event.statement << " failed: " << premise.name << " does not hold\n";
+            else
+                out << "  rule " << event.statement << " failed: " << premise.name << " is not " << premise.value << "\n";
+            break;
+        case FACT_ASSERTED:
+            out << "WHY: asked " << premise.name << " because rule " << event.statement << " needs "
+                << premise.name << " = " << premise.value << "; answer " << (event.flag ? "matched" : "did not match") << "\n";
+            break;
+        case RULE_FIRED:
+            out << "HOW: " << statement.conclusion.name << " = " << statement.conclusion.value << " by rule " << event.statement << " since";
+            for (int premiseIter = 1; premiseIter < statement.premiseList.size(); premiseIter++)
+            {
+                out << (premiseIter > 1 ? " and " : " ") << statement.premiseList.at(premiseIter).describe();
+            }
+            out << "\n";
+            break;
+        }
+    }
+}
+
+/**
+ * Static Function | InferenceTrace | writeLog
+ *
+ * Summary: Writes events as a compact binary log: the magic, the KB version,
+ *          the event count, then 20 bytes per event, all little endian.
+ *
+ * @param string fileName: The log file to write.
+ * @param const vector<Event>& events: The events to keep.
+ * @param unsigned long long knowledgeBaseVersion: KnowledgeBase::version.
+ */
+void InferenceTrace::writeLog(const std::string& fileName, const std::vector<Event>& events, unsigned long long knowledgeBaseVersion)
+{
+    std::ofstream logFile(fileName.c_str(), std::ios::out | std::ios::binary);
+    if (!logFile)
+    {
+        throw std::runtime_error("Error writing trace log " + fileName + ".");
+    }
+
+    logFile.write(TRACE_LOG_MAGIC, 8);
+    BinaryFormat::writeWord(logFile, knowledgeBaseVersion, 8);
+    BinaryFormat::writeWord(logFile, events.size(), 8);
+    for (int eventIter = 0; eventIter < events.size(); eventIter++)
+    {
+        const Event& event = events.at(eventIter);
+        BinaryFormat::writeWord(logFile, event.sequence, 8);
+        BinaryFormat::writeWord(logFile, event.thread, 4);
+        BinaryFormat::writeWord(logFile, event.type, 1);
+        BinaryFormat::writeWord(logFile, event.flag, 1);
+        BinaryFormat::writeWord(logFile, event.premise, 2);
+        BinaryFormat::writeWord(logFile, (unsigned int)event.statement, 4);
+    }
+}
+
+/**
+ * Static Function | InferenceTrace | readLog
+ *
+ * @param string fileName: A log written by writeLog.
+ * @param unsigned long long& knowledgeBaseVersion: Receives the KB version
+ *          the trace was taken with.
+ *
+ * @return vector<Event>: The events of the log.
+ */
+std::vector<InferenceTrace::Event> InferenceTrace::readLog(const std::string& fileName, unsigned long long& knowledgeBaseVersion)
+{
+    std::ifstream logFile(fileName.c_str(), std::ios::in | std::ios::binary);
+    char magic[8];
+    if (!logFile || !logFile.read(magic, 8) || std::string(magic, 8) != TRACE_LOG_MAGIC)
+    {
+        throw std::runtime_error("Error reading trace log " + fileName + ".");
+    }
+
+    knowledgeBaseVersion = BinaryFormat::readWord(logFile, 8);
+    unsigned long long eventCount = BinaryFormat::readWord(logFile, 8);
+
+    std::vector<Event> events;
+    for (unsigned long long eventIter = 0; (logFile && eventIter < eventCount); eventIter++)
+    {
+        Event event;
+        event.sequence = BinaryFormat::readWord(logFile, 8);
+        event.thread = BinaryFormat::readWord(logFile, 4);
+        event.type = (EventType)BinaryFormat::readWord(logFile, 1);
+        event.flag = BinaryFormat::readWord(logFile, 1);
+        event.premise = BinaryFormat::readWord(logFile, 2);
+        event.statement = (int)(unsigned int)BinaryFormat::readWord(logFile, 4);
+        if (logFile)
+        {
+            events.push_back(event);
+        }
+    }
+    return events;
+}
@@ -0,0 +1,400 @@
+#include <iostream>
+
+#include "IterativeBackChain.hpp"
+#include "InferenceTrace.hpp"
+
+
+/**
+ * Constructor | IterativeBackChain | IterativeBackChain
+ *
+ * Summary: Reserves the goal stack up front so solving never allocates.
+ *
+ * @param int maxDepthP: The deepest chain of intermediate conclusions that
+ *          will be followed before a goal is treated as unproven.
+ * @param KnowledgeBase* sharedRuleSystem: See BackChain::BackChain.
+ */
+IterativeBackChain::IterativeBackChain(int maxDepthP, KnowledgeBase* sharedRuleSystem)
+    : BackChain(sharedRuleSystem)
+{
+    maxDepth = (maxDepthP > 0) ? maxDepthP : 1;
+    isDepthExceeded = false;
+    goalDepth = 0;
+    goalStack.reserve(maxDepth);
+}
+
+/**
+ * Member Function | IterativeBackChain | findValidConclusionInStatements
+ *
+ * Summary: Same contract as BackChain::findValidConclusionInStatements, i.e.
+ *          returns the location of the first valid statement, -1 if the name
+ *          is a conclusion but nothing could be proven, 0 if it is not a
+ *          conclusion at all. Candidate statements and their premises are
+ *          visited in exactly the order the recursive version visits them.
+ *
+ * @param string conclusionName: The name of a conclusion to match up to.
+ * @param int startingIndex: The first index location to begin searching from.
+ * @param string stringToMatch: The value to match, or DONTCARE.
+ *
+ * @return int location:   Specifies the location of a conclusion.
+ */
+int IterativeBackChain::findValidConclusionInStatements(std::string conclusionName, int startingIndex, std::string stringToMatch)
+{
+    int location = 0;
+
+    // See BackChain::isFailedGoal.
+    if (isFailedGoal(conclusionName, stringToMatch))
+    {
+        return -1;
+    }
+
+    goalStack.clear();
+    goalDepth = 0;
+    isDepthExceeded = false;
+    pushGoal(&conclusionName, &stringToMatch, startingIndex);
+
+    while (!goalStack.empty())
+    {
+        // Out of budget: unwind without proving anything more.
+        if (budget.isStopped())
+        {
+            goalStack.clear();
+            goalDepth = 0;
+            location = -1;
+            break;
+        }
+
+        // Evaluating an OR/NOT premise.
+        if (goalStack.back().node >= 0)
+        {
+            stepNode();
+            continue;
+        }
+
+        GoalFrame& frame = goalStack.back();
+
+        // Searching for the next candidate statement of this goal.
+        if (frame.premise == 0)
+        {
+            // Only statements concluding the goal are visited, see
+            // BackChain::nextStatementConcluding.
+            frame.statement = nextStatementConcluding(*frame.name, frame.statement);
+            while (frame.premise == 0 && frame.statement < ruleSystem.kBase.size())
+            {
+                const ClauseItem& conclusion = ruleSystem.kBase.at(frame.statement).conclusion;
+                frame.isConclusion = true;
+                if ((*frame.value == conclusion.value || *frame.value == "DONTCARE") && budget.chargeRule())
+                {
+                    frame.premise = 1;
+                    InferenceTrace::record(InferenceTrace::RULE_TRIED, frame.statement);
+                    if (ruleProfile != nullptr)
+                    {
+                        ruleProfile->recordTried(frame.statement);
+                    }
+
+                    // See BackChain::processPremiseList.
+                    int contradictedPremise = checkKnownFactsFirst ? findContradictedPremise(ruleSystem.kBase.at(frame.statement)) : 0;
+                    if (contradictedPremise > 0)
+                    {
+                        InferenceTrace::record(InferenceTrace::PREMISE_FAILED, frame.statement, contradictedPremise);
+                        if (ruleProfile != nullptr)
+                        {
+                            ruleProfile->recordPremise(frame.statement, contradictedPremise, false, 0);
+                        }
+                        frame.premise = 0;
+                    }
+                }
+
+                if (frame.premise == 0)
+                {
+                    frame.statement = nextStatementConcluding(*frame.name, frame.statement + 1);
+                }
+                if (budget.isStopped())
+                {
+                    break;
+                }
+            }
+
+            if (budget.isStopped())
+            {
+                continue;
+            }
+
+            // No candidate left, see BackChain for the meaning of -1 and 0.
+            if (frame.premise == 0)
+            {
+                location = frame.isConclusion ? -1 : 0;
+
+                // A goal cut short by the depth limit or the budget might
+                // still hold.
+                if (location == -1 && !isDepthExceeded && !budget.isStopped())
+                {
+                    recordFailedGoal(*frame.name, *frame.value);
+                }
+                goalStack.pop_back();
+                goalDepth--;
+                resolvePremise(location);
+                continue;
+            }
+        }
+
+        const Statement& statement = ruleSystem.kBase.at(frame.statement);
+
+        // Every premise held, the candidate statement proves this goal.
+        if (frame.premise >= statement.premiseList.size())
+        {
+            location = frame.statement;
+            recordProven(location);
+            InferenceTrace::record(InferenceTrace::RULE_FIRED, location);
+            goalStack.pop_back();
+            goalDepth--;
+            resolvePremise(location);
+            continue;
+        }
+
+        if (!budget.chargePremise())
+        {
+            continue;
+        }
+        const ClauseItem& premise = statement.premiseList.at(frame.premise);
+        frame.premisePrompts = promptCount;
+        if (premise.type == EXPRESSION)
+        {
+            // Evaluated on top of this goal, which waits for the result.
+            pushNode(ruleSystem.expressions.find(premise.name));
+            continue;
+        }
+
+        int support = truthMaintenance.findSupport(premise, ruleSystem);
+        if (support > 0)
+        {
+            // Already justified this session, see BackChain::processPremiseList.
+            resolvePremise(support);
+        }
+        else if (goalDepth >= maxDepth)
+        {
+            isDepthExceeded = true;
+            resolvePremise(-1);
+        }
+        else if (isFailedGoal(premise.name, premise.value))
+        {
+            resolvePremise(-1);
+        }
+        else
+        {
+            if (InferenceTrace::isEnabled() && ruleSystem.conclusionSet.count(premise.name) > 0)
+            {
+                InferenceTrace::record(InferenceTrace::GOAL_PUSHED, frame.statement, frame.premise);
+            }
+            pushGoal(&premise.name, &premise.value, 1);
+        }
+    }
+
+    if (isDepthExceeded)
+    {
+        std::cout << "\nWARNING! Goal stack depth limit of " << maxDepth
+                  << " reached; deeper chains were treated as unproven." << std::endl;
+    }
+
+    return location;
+}
+
+/**
+ * Member Function | IterativeBackChain | pushGoal
+ *
+ * Summary: Pushes a new goal onto the stack. The depth is checked by the
+ *          caller. The buffer was reserved in the constructor, so this only
+ *          reallocates when OR/NOT nodes take the stack past maxDepth frames.
+ */
+void IterativeBackChain::pushGoal(const std::string* name, const std::string* value, int startingIndex)
+{
+    GoalFrame frame;
+    frame.name = name;
+    frame.value = value;
+    frame.statement = startingIndex;
+    frame.premise = 0;
+    frame.isConclusion = false;
+    frame.premisePrompts = 0;
+    frame.node = -1;
+    frame.operand = 0;
+    frame.hasResult = false;
+    frame.result = 0;
+    goalStack.push_back(frame);
+    goalDepth++;
+}
+
+/**
+ * Member Function | IterativeBackChain | pushNode
+ *
+ * Summary: Pushes a node of an OR/NOT premise onto the stack, to be
+ *          evaluated by stepNode. Nodes do not count toward maxDepth; they
+ *          are bounded by how deeply the premise nests.
+ *
+ * @param int node: The ExpressionPool node.
+ */
+void IterativeBackChain::pushNode(int node)
+{
+    GoalFrame frame;
+    frame.name = nullptr;
+    frame.value = nullptr;
+    frame.statement = 0;
+    frame.premise = 0;
+    frame.isConclusion = false;
+    frame.premisePrompts = 0;
+    frame.node = node;
+    frame.operand = 0;
+    frame.hasResult = false;
+    frame.result = 0;
+    goalStack.push_back(frame);
+}
+
+/**
+ * Member Function | IterativeBackChain | stepNode
+ *
+ * Summary: Takes the node on top of the stack one step, in the order
+ *          ExpressionPool::evaluate visits it. An AND or OR pushes its next
+ *          operand, or finishes at the first operand that decides it. A LEAF
+ *          solves its name as a goal on top of it, then is decided by
+ *          BackChain::isExpressionLeafTrue.
+ */
+void IterativeBackChain::stepNode()
+{
+    GoalFrame& frame = goalStack.back();
+    const ExpressionPool::Node& expression = ruleSystem.expressions.node(frame.node);
+
+    if (expression.kind == ExpressionPool::LEAF)
+    {
+        if (frame.hasResult)
+        {
+            finishNode(isExpressionLeafTrue(expression, frame.result));
+            return;
+        }
+
+        // See BackChain::isExpressionLeafTrue and isFailedGoal.
+        int support = truthMaintenance.findSupport(expression.clause, ruleSystem);
+        if (support == 0 && isFailedGoal(expression.clause.name, expression.clause.value))
+        {
+            support = -1;
+        }
+        if (support == 0 && goalDepth >= maxDepth)
+        {
+            isDepthExceeded = true;
+            support = -1;
+        }
+        if (support != 0)
+        {
+            finishNode(isExpressionLeafTrue(expression, support));
+            return;
+        }
+
+        frame.operand = 1;
+        frame.hasResult = false;
+        pushGoal(&expression.clause.name, &expression.clause.value, 1);
+        return;
+    }
+
+    if (frame.hasResult)
+    {
+        bool holds = (frame.result > 0);
+        frame.hasResult = false;
+        if (holds != (expression.kind == ExpressionPool::AND))
+        {
+            finishNode(holds);
+            return;
+        }
+    }
+
+    if (frame.operand >= expression.operands.size())
+    {
+        finishNode(expression.kind == ExpressionPool::AND);
+    }
+    else
+    {
+        pushNode(expression.operands.at(frame.operand++));
+    }
+}
+
+/**
+ * Member Function | IterativeBackChain | finishNode
+ *
+ * Summary: Pops the node on top of the stack and hands whether it held to
+ *          the frame below, the node it is an operand of or the goal whose
+ *          premise it is.
+ *
+ * @param bool holds: Whether the node held.
+ */
+void IterativeBackChain::finishNode(bool holds)
+{
+    goalStack.pop_back();
+    resolvePremise(holds ? 1 : -1);
+}
+
+/**
+ * Member Function | IterativeBackChain | resolvePremise
+ *
+ * Summary: Hands the result of a finished sub goal to the premise that asked
+ *          for it. This mirrors the body of BackChain::processPremiseList: a
+ *          failed conclusion fails the statement, a proven one is recorded as
+ *          an intermediate conclusion, and a non conclusion is looked up in
+ *          (or prompted for into) the variable list.
+ *
+ *          When the frame below is an OR/NOT node, the result is left for
+ *          stepNode instead.
+ *
+ * @param int conclusionLocation: The result of the sub goal; for an OR/NOT
+ *          premise or node, positive if it held and -1 if not.
+ */
+void IterativeBackChain::resolvePremise(int conclusionLocation)
+{
+    if (goalStack.empty())
+    {
+        return;
+    }
+
+    GoalFrame& frame = goalStack.back();
+    if (frame.node >= 0)
+    {
+        frame.hasResult = true;
+        frame.result = conclusionLocation;
+        return;
+    }
+
+    const ClauseItem& premise = ruleSystem.kBase.at(frame.statement).premiseList.at(frame.premise);
+    bool isValid = false;
+
+    if (premise.type == EXPRESSION)
+    {
+        isValid = (conclusionLocation > 0);
+    }
+    else if (conclusionLocation > 0)
+    {
+        isValid = true;
+        addToIntermediateConclusionList(premise);
+    }
+    else if (conclusionLocation == 0)
+    {
+        int promptsBefore = promptCount;
+        isValid = instantiatePremiseClause(premise);
+        if (promptCount != promptsBefore)
+        {
+            InferenceTrace::record(InferenceTrace::FACT_ASSERTED, frame.statement, frame.premise, isValid);
+        }
+    }
+
+    if (ruleProfile != nullptr)
+    {
+        ruleProfile->recordPremise(frame.statement, frame.premise, isValid, promptCount - frame.premisePrompts);
+    }
+
+    if (isValid)
+    {
+        frame.premise++;
+    }
+    else
+    {
+        InferenceTrace::record(InferenceTrace::PREMISE_FAILED, frame.statement, frame.premise);
+
+        // Move on to the next candidate statement for this goal.
+        frame.premise = 0;
+        frame.statement++;
+    }
+}
@@ -0,0 +1,417 @@
+#include <iostream>
+#include <algorithm>
+#include <set>
+
+#include "KnowledgeAnalyzer.hpp"
+
+
+/**
+ * Constructor | KnowledgeAnalyzer | KnowledgeAnalyzer
+ *
+ * Summary: Binds the analyzer to a loaded knowledge base and variable list.
+ *          Nothing is computed until analyze() is called.
+ *
+ * @param const KnowledgeBase& knowledgeBaseP: The knowledge base to check.
+ * @param const vector<VariableListItem>& variableListP: The variables that
+ *          may be prompted for, as read from variablesList.csv.
+ */
+KnowledgeAnalyzer::KnowledgeAnalyzer(const KnowledgeBase& knowledgeBaseP, const std::vector<VariableListItem>& variableListP)
+    : knowledgeBase(knowledgeBaseP), variableList(variableListP)
+{
+}
+
+/**
+ * Member Function | KnowledgeAnalyzer | analyze
+ *
+ * Summary: Runs every check in dependency order. Dead rules are found first
+ *          so that a dead rule is never used as the reason another rule is
+ *          shadowed.
+ */
+void KnowledgeAnalyzer::analyze()
+{
+    findings.clear();
+    isFlagged.assign(knowledgeBase.kBase.size(), false);
+
+    buildDependencyGraph();
+    findUnknownAndContradictoryPremises();
+    findDeadRules();
+    findDuplicateAndSubsumedRules();
+    findCycles();
+}
+
+/**
+ * Member Function | KnowledgeAnalyzer | buildDependencyGraph
+ *
+ * Summary: Builds the conclusion index and a sorted premise key for every
+ *          statement. Index 0 is the NULL statement and is skipped, as it is
+ *          everywhere else.
+ */
+void KnowledgeAnalyzer::buildDependencyGraph()
+{
+    conclusionIndex.clear();
+    premiseKeys.assign(knowledgeBase.kBase.size(), PremiseKey());
+
+    for (int statementIter = 1; statementIter < knowledgeBase.kBase.size(); statementIter++)
+    {
+        const Statement& statement = knowledgeBase.kBase.at(statementIter);
+        conclusionIndex[statement.conclusion.name].push_back(statementIter);
+
+        PremiseKey& key = premiseKeys.at(statementIter);
+        for (int premiseIter = 1; premiseIter < statement.premiseList.size(); premiseIter++)
+        {
+            key.push_back(std::make_pair(statement.premiseList.at(premiseIter).name,
+                                         statement.premiseList.at(premiseIter).value));
+        }
+        std::sort(key.begin(), key.end());
+        key.erase(std::unique(key.begin(), key.end()), key.end());
+    }
+}
+
+/**
+ * Member Function | KnowledgeAnalyzer | findUnknownAndContradictoryPremises
+ *
+ * Summary: A premise on a variable that is neither concluded by a rule nor
+ *          listed in the variable list can never be instantiated, and a rule
+ *          that needs one variable to hold two values can never fire.
+ */
+void KnowledgeAnalyzer::findUnknownAndContradictoryPremises()
+{
+    std::set<std::string> knownVariables;
+    for (int varIter = 1; varIter < variableList.size(); varIter++)
+    {
+        knownVariables.insert(variableList.at(varIter).name);
+    }
+
+    for (int statementIter = 1; statementIter < premiseKeys.size(); statementIter++)
+    {
+        const PremiseKey& key = premiseKeys.at(statementIter);
+        for (int premiseIter = 0; premiseIter < key.size(); premiseIter++)
+        {
+            const std::string& name = key.at(premiseIter).first;
+            std::vector<std::string> names = namesTested(key.at(premiseIter));
+            for (int nameIter = 0; nameIter < names.size(); nameIter++)
+            {
+                if (conclusionIndex.count(names.at(nameIter)) == 0 && knownVariables.count(names.at(nameIter)) == 0)
+                {
+                    addFinding(UNKNOWN_VARIABLE, statementIter, 0, "premise variable '" + names.at(nameIter) + "' is not in the variable list");
+                }
+            }
+
+            // The key is sorted by name, so conflicting values are adjacent.
+            if (premiseIter > 0 && key.at(premiseIter - 1).first == name)
+            {
+                addFinding(CONTRADICTORY_RULE, statementIter, 0, "'" + name + "' must equal both '" +
+                           key.at(premiseIter - 1).second + "' and '" + key.at(premiseIter).second + "'");
+            }
+        }
+    }
+}
+
+/**
+ * Member Function | KnowledgeAnalyzer | findDeadRules
+ *
+ * Summary: A premise on a conclusion variable is only satisfiable if some
+ *          live rule concludes exactly that value. Removing one dead rule may
+ *          kill the rules that depended on it, so this iterates to a fixpoint.
+ */
+void KnowledgeAnalyzer::findDeadRules()
+{
+    bool isChanged = true;
+
+    while (isChanged)
+    {
+        isChanged = false;
+
+        std::set<std::pair<std::string, std::string> > liveConclusions;
+        for (int statementIter = 1; statementIter < knowledgeBase.kBase.size(); statementIter++)
+        {
+            if (!isFlagged.at(statementIter))
+            {
+                liveConclusions.insert(std::make_pair(knowledgeBase.kBase.at(statementIter).conclusion.name,
+                                                      knowledgeBase.kBase.at(statementIter).conclusion.value));
+            }
+        }
+
+        for (int statementIter = 1; statementIter < premiseKeys.size(); statementIter++)
+        {
+            const PremiseKey& key = premiseKeys.at(statementIter);
+            for (int premiseIter = 0; (!isFlagged.at(statementIter) && premiseIter < key.size()); premiseIter++)
+            {
+                if (conclusionIndex.count(key.at(premiseIter).first) > 0 && liveConclusions.count(key.at(premiseIter)) == 0)
+                {
+                    addFinding(DEAD_RULE, statementIter, 0, "no live rule concludes " +
+                               key.at(premiseIter).first + " = " + key.at(premiseIter).second);
+                    isChanged = true;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Member Function | KnowledgeAnalyzer | findDuplicateAndSubsumedRules
+ *
+ * Summary: Back chaining takes the first rule that succeeds. A later rule
+ *          with the same conclusion as an earlier live rule, whose premises
+ *          are a superset of the earlier rule's, can therefore never be the
+ *          rule that proves its conclusion. Only earlier rules are considered
+ *          so that dropping the later one cannot change any answer.
+ */
+void KnowledgeAnalyzer::findDuplicateAndSubsumedRules()
+{
+    std::map<std::pair<std::string, std::string>, std::vector<int> > sameConclusion;
+
+    for (int statementIter = 1; statementIter < knowledgeBase.kBase.size(); statementIter++)
+    {
+        const ClauseItem& conclusion = knowledgeBase.kBase.at(statementIter).conclusion;
+        std::vector<int>& earlierRules = sameConclusion[std::make_pair(conclusion.name, conclusion.value)];
+        const PremiseKey& key = premiseKeys.at(statementIter);
+
+        for (int earlierIter = 0; (!isFlagged.at(statementIter) && earlierIter < earlierRules.size()); earlierIter++)
+        {
+            int earlier = earlierRules.at(earlierIter);
+            const PremiseKey& earlierKey = premiseKeys.at(earlier);
+
+            if (earlierKey == key)
+            {
+                addFinding(DUPLICATE_RULE, statementIter, earlier, "same premises and conclusion as an earlier rule");
+            }
+            else if (std::includes(key.begin(), key.end(), earlierKey.begin(), earlierKey.end()))
+            {
+                addFinding(SUBSUMED_RULE, statementIter, earlier, "an earlier rule reaches the same conclusion with fewer premises");
+            }
+        }
+
+        if (!isFlagged.at(statementIter))
+        {
+            earlierRules.push_back(statementIter);
+        }
+    }
+}
+
+/**
+ * Member Function | KnowledgeAnalyzer | findCycles
+ *
+ * Summary: Depth first search over conclusion variables. An edge leads from a
+ *          conclusion to every premise variable that is itself a conclusion.
+ *          Any back edge found is a cycle back chaining would never leave;
+ *          the rule that contributes the back edge is reported.
+ */
+void KnowledgeAnalyzer::findCycles()
+{
+    std::map<std::string, int> visitState;   // 0 = new, 1 = on the path, 2 = done
+    std::vector<std::string> path;
+
+    for (std::map<std::string, std::vector<int> >::const_iterator conclusionIter = conclusionIndex.begin();
+         conclusionIter != conclusionIndex.end(); ++conclusionIter)
+    {
+        if (visitState[conclusionIter->first] == 0)
+        {
+            visitConclusion(conclusionIter->first, visitState, path);
+        }
+    }
+}
+
+/**
+ * Member Function | KnowledgeAnalyzer | visitConclusion
+ *
+ * Summary: One step of the cycle search. Dead rules are skipped since back
+ *          chaining still walks into them; they are reported either way.
+ *
+ * @return bool: true if a cycle was found below this conclusion.
+ */
+bool KnowledgeAnalyzer::visitConclusion(const std::string& conclusionName, std::map<std::string, int>& visitState,
+                                        std::vector<std::string>& path)
+{
+    bool isCycleFound = false;
+    visitState[conclusionName] = 1;
+    path.push_back(conclusionName);
+
+    const std::vector<int>& rules = conclusionIndex[conclusionName];
+    for (int ruleIter = 0; ruleIter < rules.size(); ruleIter++)
+    {
+        const PremiseKey& key = premiseKeys.at(rules.at(ruleIter));
+        std::vector<std::string> premiseNames;
+        for (int premiseIter = 0; premiseIter < key.size(); premiseIter++)
+        {
+            std::vector<std::string> names = namesTested(key.at(premiseIter));
+            premiseNames.insert(premiseNames.end(), names.begin(), names.end());
+        }
+
+        for (int premiseIter = 0; premiseIter < premiseNames.size(); premiseIter++)
+        {
+            const std::string& premiseName = premiseNames.at(premiseIter);
+            if (conclusionIndex.count(premiseName) == 0)
+            {
+                continue;
+            }
+
+            if (visitState[premiseName] == 1)
+            {
+                std::string cycle;
+                std::vector<std::string>::iterator cycleStart = std::find(path.begin(), path.end(), premiseName);
+                for (; cycleStart != path.end(); ++cycleStart)
+                {
+                    cycle += *cycleStart + " -> ";
+                }
+                addFinding(CYCLIC_RULE, rules.at(ruleIter), 0, "conclusion cycle " + cycle + premiseName);
+                isCycleFound = true;
+            }
+            else if (visitState[premiseName] == 0)
+            {
+                isCycleFound = visitConclusion(premiseName, visitState, path) || isCycleFound;
+            }
+        }
+    }
+
+    path.pop_back();
+    visitState[conclusionName] = 2;
+    return isCycleFound;
+}
+
+/**
+ * Member Function | KnowledgeAnalyzer | addFinding
+ *
+ * Summary: Records a finding and marks the statement as prunable.
+ */
+void KnowledgeAnalyzer::addFinding(FindingKind kind, int statement, int relatedStatement, const std::string& detail)
+{
+    Finding finding;
+    finding.kind = kind;
+    finding.statement = statement;
+    finding.relatedStatement = relatedStatement;
+    finding.detail = detail;
+    findings.push_back(finding);
+    isFlagged.at(statement) = true;
+}
+
+/**
+ * Member Function | KnowledgeAnalyzer | displayReport
+ *
+ * Summary: Prints every finding along with the rule in the same IF/THEN form
+ *          displayBase uses.
+ */
+void KnowledgeAnalyzer::displayReport() const
+{
+    std::cout << "\nKnowledge base analysis: " << (knowledgeBase.kBase.size() - 1) << " rule(s), "
+              << conclusionIndex.size() << " conclusion variable(s), " << findings.size() << " finding(s)" << std::endl;
+
+    for (int findingIter = 0; findingIter < findings.size(); findingIter++)
+    {
+        const Finding& finding = findings.at(findingIter);
+        std::cout << "  [" << kindName(finding.kind) << "] rule " << finding.statement << ": " << finding.detail;
+        if (finding.relatedStatement > 0)
+        {
+            std::cout << " (see rule " << finding.relatedStatement << ")";
+        }
+        std::cout << std::endl << "      " << describeStatement(finding.statement) << std::endl;
+    }
+}
+
+/**
+ * Member Function | KnowledgeAnalyzer | pruneKnowledgeBase
+ *
+ * Summary: Drops every flagged rule from the target knowledge base and
+ *          rebuilds its conclusion set. The target must be the knowledge base
+ *          that was analyzed (or an identical copy), since findings refer to
+ *          statements by index.
+ *
+ * @param KnowledgeBase& target: The knowledge base to prune.
+ *
+ * @return int: The number of rules removed.
+ */
+int KnowledgeAnalyzer::pruneKnowledgeBase(KnowledgeBase& target) const
+{
+    std::vector<Statement> keptStatements;
+    int removedCount = 0;
+
+    // Keep the NULL statement at index 0.
+    keptStatements.push_back(target.kBase.at(0));
+    target.conclusionSet.clear();
+
+    for (int statementIter = 1; statementIter < target.kBase.size(); statementIter++)
+    {
+        if (statementIter < isFlagged.size() && isFlagged.at(statementIter))
+        {
+            removedCount++;
+        }
+        else
+        {
+            keptStatements.push_back(target.kBase.at(statementIter));
+            target.conclusionSet.insert(target.kBase.at(statementIter).conclusion.name);
+        }
+    }
+
+    target.kBase.swap(keptStatements);
+    target.updateVersion();
+    return removedCount;
+}
+
+/**
+ * Member Function | KnowledgeAnalyzer | namesTested
+ *
+ * Summary: The names a premise depends on: its own, or for an OR/NOT premise
+ *          the name of every test in it. Whether those can hold is not
+ *          worked out, so such a premise never makes a rule dead.
+ *
+ * @param pair premise: A premise key entry.
+ *
+ * @return vector<string>: The names.
+ */
+std::vector<std::string> KnowledgeAnalyzer::namesTested(const std::pair<std::string, std::string>& premise) const
+{
+    std::vector<std::string> names;
+    if (!premise.second.empty() || knowledgeBase.expressions.find(premise.first) == 0)
+    {
+        names.push_back(premise.first);
+        return names;
+    }
+
+    std::vector<ClauseItem> tests = knowledgeBase.premiseTests(ClauseItem(premise.first, premise.second, EXPRESSION));
+    for (int testIter = 0; testIter < tests.size(); testIter++)
+    {
+        names.push_back(tests.at(testIter).name);
+    }
+    return names;
+}
+
+/**
+ * Member Function | KnowledgeAnalyzer | describeStatement
+ *
+ * Summary: Formats a statement as IF name = value AND ... THEN name = value.
+ */
+std::string KnowledgeAnalyzer::describeStatement(int statement) const
+{
+    const Statement& rule = knowledgeBase.kBase.at(statement);
+    std::string description = "IF ";
+
+    for (int premiseIter = 1; premiseIter < rule.premiseList.size(); premiseIter++)
+    {
+        if (premiseIter > 1)
+        {
+            description += " AND ";
+        }
+        description += rule.premiseList.at(premiseIter).describe();
+    }
+
+    return description + " THEN " + rule.conclusion.name + " = " + rule.conclusion.value;
+}
+
+/**
+ * Member Function | KnowledgeAnalyzer | kindName
+ *
+ * Summary: Short label printed in front of each finding.
+ */
+const char* KnowledgeAnalyzer::kindName(FindingKind kind)
+{
+    switch (kind)
+    {
+    case UNKNOWN_VARIABLE:   return "unknown variable";
+    case CONTRADICTORY_RULE: return "contradictory";
+    case DEAD_RULE:          return "dead";
+    case DUPLICATE_RULE:     return "duplicate";
+    case SUBSUMED_RULE:      return "subsumed";
+    case CYCLIC_RULE:        return "cycle";
+    }
+    return "unknown";
+}
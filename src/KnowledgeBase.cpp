@@ -1,13 +1,21 @@
 #include <iostream>
 #include <fstream>
 #include <stdexcept>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <map>
+#include <utility>
 
 #include "KnowledgeBase.hpp"
+#include "CertaintyRanking.hpp"
 
 
 KnowledgeBase::KnowledgeBase()
 {
-    std::cout << "\nCreating knowledge base instance..." << std::endl;
+    version = 0;
+    resultVersion = 0;
+    hashedCount = 0;
 }
 
 /**
@@ -18,10 +26,18 @@ KnowledgeBase::KnowledgeBase()
  *
  * = is used to separate variable and value
  * ^ is logical AND
+ * | is logical OR
+ * ! is logical NOT, before a test or a group; name != value is short for !name = value
+ * ( ) group, otherwise NOT binds tightest, then AND, then OR
  * : separates clause and conclusion
+ * [c] after the conclusion, 0 < c <= 1, is how certain the conclusion is when the premises hold
  *
  * The above example should be read as follows. If issue is equal to failure to start, and has fuel is false
  * then repair conclusion equals "Insufficient Fuel, Add more fuel." 
+ * An OR needs no duplicate rules, e.g.
+ * issue = Failure to Start ^ (has_fuel = n | fuel_gauge = empty) : repair = Insufficient Fuel, Add more fuel.
+ * A rule that is only usually right says so, e.g.
+ * issue = Overheating Issue ^ has_coolant = y : repair = Defective Water Pump, replace water pump. [0.7]
  *
  * @param string fileName - the name of the file containing the knowledge base. knowledgeBase.txt
  *
@@ -49,8 +65,12 @@ void KnowledgeBase::populateKnowledgeBase(std::string fileName)
                 int indicatorLocation;
                 if (isConclusionGood(lList, inputBuffer, listPremise))
                 {
+                    std::cout << "Conclusion is good; ";
+                    conclusionSet.insert(lList.conclusion.name); // add conclusion to set, maintaining unique list of conclusions
+
                     if (arePremisesGood(lList, listPremise))
                     {
+                        std::cout << "Premise list is good!  " << lList.premiseList.size() - 1 << " premise(s) loaded\n";
                         std::cout << "Conclusion and premise(s) are good => List Updated\n";
                         kBase.push_back(lList);
                         ++total_good;
@@ -73,7 +93,392 @@ void KnowledgeBase::populateKnowledgeBase(std::string fileName)
     else {
         throw std::runtime_error("Error reading Knowledge Base (KB) file. Please validate it uses the correct format. Invoke application with -h or -help for details.");
     }
+    updateVersion();
+    displayLoadSummary(total_good, total_bad);
+}
+
+/**
+ * populateKnowledgeBaseParallel - same result as populateKnowledgeBase, for very large KB files.
+ * The file is read in one go and split at line boundaries into a few chunks per thread. Each 
+ * thread parses its chunks into its own statement buffer; the buffers are then appended in 
+ * chunk order, so statements keep the order of the lines in the file. Only malformed lines 
+ * are printed, with their line number, since printing every line costs more than parsing it.
+ *
+ * @param string fileName - the name of the file containing the knowledge base. knowledgeBase.txt
+ * @param int threadCount - number of parser threads
+ *
+ * @return none
+ *
+ */
+void KnowledgeBase::populateKnowledgeBaseParallel(std::string fileName, int threadCount)
+{
+    std::ifstream inputFile(fileName, std::ios::in | std::ios::binary);
+    if (!inputFile)
+    {
+        throw std::runtime_error("Error reading Knowledge Base (KB) file. Please validate it uses the correct format. Invoke application with -h or -help for details.");
+    }
+
+    std::string fileContents;
+    inputFile.seekg(0, std::ios::end);
+    fileContents.resize(inputFile.tellg());
+    inputFile.seekg(0, std::ios::beg);
+    inputFile.read(&fileContents[0], fileContents.size());
+
+    if (threadCount < 1)
+        threadCount = 1;
+
+    // A few chunks per thread evens out lines of uneven length.
+    int chunkCount = threadCount * 4;
+    std::vector<size_t> chunkStart(1, 0);
+    for (int chunkIter = 1; chunkIter < chunkCount; chunkIter++)
+    {
+        size_t boundary = fileContents.size() * chunkIter / chunkCount;
+        boundary = fileContents.find('\n', std::max(boundary, chunkStart.back()));
+        if (boundary == std::string::npos)
+            break;
+        if (boundary + 1 > chunkStart.back())
+            chunkStart.push_back(boundary + 1);
+    }
+    chunkStart.push_back(fileContents.size());
+    chunkCount = chunkStart.size() - 1;
+
+    struct ChunkResult
+    {
+        std::vector<Statement> statements;
+        std::vector<std::pair<int, std::string> > badLines;  // line number within the chunk, reason
+        std::vector<std::string> rejectedConclusions;
+        int lineCount = 0;
+    };
+    std::vector<ChunkResult> chunkResults(chunkCount);
+    std::atomic<int> nextChunk(0);
+
+    std::vector<std::thread> parsers;
+    for (int threadIter = 0; threadIter < std::min(threadCount, chunkCount); threadIter++)
+    {
+        parsers.push_back(std::thread([&]()
+        {
+            for (int chunk = nextChunk++; chunk < chunkCount; chunk = nextChunk++)
+            {
+                ChunkResult& result = chunkResults.at(chunk);
+                size_t lineStart = chunkStart.at(chunk);
+                while (lineStart < chunkStart.at(chunk + 1))
+                {
+                    size_t lineEnd = fileContents.find('\n', lineStart);
+                    if (lineEnd == std::string::npos || lineEnd > chunkStart.at(chunk + 1))
+                        lineEnd = chunkStart.at(chunk + 1);
+
+                    std::string inputBuffer = fileContents.substr(lineStart, lineEnd - lineStart);
+                    if (inputBuffer.size() > 0)
+                    {
+                        Statement lList;
+                        std::string listPremise;
+                        if (!isConclusionGood(lList, inputBuffer, listPremise))
+                            result.badLines.push_back(std::make_pair(result.lineCount, "Conclusion is formatted incorrectly"));
+                        else if (!arePremisesGood(lList, listPremise))
+                        {
+                            // The serial loader records the conclusion before it checks the premises.
+                            result.badLines.push_back(std::make_pair(result.lineCount, "Premise List is formatted incorrectly"));
+                            result.rejectedConclusions.push_back(lList.conclusion.name);
+                        }
+                        else
+                            result.statements.push_back(lList);
+                    }
+
+                    result.lineCount++;
+                    lineStart = lineEnd + 1;
+                }
+            }
+        }));
+    }
+
+    for (int threadIter = 0; threadIter < parsers.size(); threadIter++)
+    {
+        parsers.at(threadIter).join();
+    }
+
+    // Merge in chunk order.
+    int total_good = 0, total_bad = 0, firstLine = 1;
+    for (int chunkIter = 0; chunkIter < chunkCount; chunkIter++)
+    {
+        ChunkResult& result = chunkResults.at(chunkIter);
+        for (int badIter = 0; badIter < result.badLines.size(); badIter++)
+        {
+            std::cout << "Line " << (firstLine + result.badLines.at(badIter).first) << ": "
+                      << result.badLines.at(badIter).second << ".  List NOT updated\n";
+            ++total_bad;
+        }
+
+        conclusionSet.insert(result.rejectedConclusions.begin(), result.rejectedConclusions.end());
+        for (int statementIter = 0; statementIter < result.statements.size(); statementIter++)
+        {
+            conclusionSet.insert(result.statements.at(statementIter).conclusion.name);
+            kBase.push_back(std::move(result.statements.at(statementIter)));
+            ++total_good;
+        }
+        firstLine += result.lineCount;
+    }
+
+    updateVersion();
+    displayLoadSummary(total_good, total_bad);
+}
+
+/**
+ * appendKnowledgeBase - appends the statements of a KB formatted file without any console
+ * output or pause. Used to page in KB shards while chaining is under way. Malformed lines 
+ * are skipped with a single warning.
+ *
+ * @param string fileName - the name of the file to append
+ *
+ * @return int - the number of statements added
+ */
+int KnowledgeBase::appendKnowledgeBase(std::string fileName)
+{
+    int total_good = 0, total_bad = 0;
+    std::string inputBuffer;
+    std::ifstream inputFile;
+    inputFile.open(fileName);
+
+    if (!inputFile)
+    {
+        throw std::runtime_error("Error reading Knowledge Base (KB) file " + fileName + ".");
+    }
+
+    // Rules for names no loaded rule concludes or tests cannot change any
+    // goal solved so far, so such an append leaves resultVersion alone. A
+    // shard manifest puts every name in conclusionSet up front.
+    bool isExtension = true;
+    std::set<std::string> appendedConclusions;
+
+    while (getline(inputFile, inputBuffer))
+    {
+        if (inputBuffer.size() > 0)
+        {
+            Statement lList;
+            std::string listPremise;
+            if (isConclusionGood(lList, inputBuffer, listPremise) && arePremisesGood(lList, listPremise))
+            {
+                const std::string& name = lList.conclusion.name;
+                if (appendedConclusions.insert(name).second &&
+                    (ruleConclusionSet.count(name) != 0 || premiseNameSet.count(name) != 0))
+                {
+                    isExtension = false;
+                }
+                conclusionSet.insert(name);
+                kBase.push_back(lList);
+                ++total_good;
+            }
+            else
+            {
+                ++total_bad;
+            }
+        }
+    }
+
+    if (total_bad > 0)
+        std::cerr << "\nWARNING! " << total_bad << " malfromed item(s) in " << fileName << " were not loaded.\n";
+
+    foldStatements(hashedCount);
+    if (!isExtension)
+    {
+        resultVersion = version;
+    }
+    return total_good;
+}
+
+/**
+ * updateVersion - recomputes the version from the content of every statement (64 bit FNV-1a). 
+ * Anything derived from the KB and kept across sessions (e.g. the result cache) compares 
+ * versions to know when it is stale, so every change to kBase must be followed by a call.
+ * It also compiles the EXPRESSION premises that are new into the expression pool.
+ *
+ * @return none
+ */
+void KnowledgeBase::updateVersion()
+{
+    hashedCount = 0;
+    premiseNameSet.clear();
+    ruleConclusionSet.clear();
+    foldStatements(1);
+    resultVersion = version;
+}
+
+/**
+ * foldStatements - folds the statements from first on into the running hash of updateVersion, 
+ * which is sequential, so appending hashes only what is new and gives the version a full 
+ * rehash would. Their EXPRESSION premises are compiled and the names they conclude and test
+ * are noted.
+ *
+ * @param unsigned int first - the kBase index to start from, 1 to hash everything
+ *
+ * @return none
+ */
+void KnowledgeBase::foldStatements(unsigned int first)
+{
+    unsigned long long hash = (first <= 1) ? 14695981039346656037ULL : version;
+    for (unsigned int statementIter = (first < 1) ? 1 : first; statementIter < kBase.size(); statementIter++)
+    {
+        const Statement& statement = kBase.at(statementIter);
+        ruleConclusionSet.insert(statement.conclusion.name);
+        std::string text = statement.conclusion.name + "=" + statement.conclusion.value + ":";
+        for (unsigned int premiseIter = 1; premiseIter < statement.premiseList.size(); premiseIter++)
+        {
+            const ClauseItem& premise = statement.premiseList.at(premiseIter);
+            text += premise.name + "=" + premise.value + "^";
+
+            // Parsing runs on several threads in the parallel loader, so the
+            // shared pool is only filled in here.
+            if (premise.type == EXPRESSION)
+            {
+                int node = expressions.compile(premise.name);
+                const std::vector<int>& leaves = expressions.node(node).leaves;
+                for (unsigned int leafIter = 0; leafIter < leaves.size(); leafIter++)
+                {
+                    premiseNameSet.insert(expressions.node(leaves.at(leafIter)).clause.name);
+                }
+            }
+            else
+            {
+                premiseNameSet.insert(premise.name);
+            }
+        }
+        // Certain rules hash as they always have, so existing versions stand.
+        if (statement.certainty != 1)
+        {
+            text += "[" + std::to_string(statement.certainty) + "]";
+        }
+        text += "\n";
+
+        for (unsigned int charIter = 0; charIter < text.size(); charIter++)
+        {
+            hash ^= (unsigned char)text[charIter];
+            hash *= 1099511628211ULL;
+        }
+    }
+    version = hash;
+    hashedCount = kBase.size();
+}
+
+/**
+ * premiseNamesReachableFrom - every name used in a premise of a statement the goal can reach, 
+ * through the statements concluding it and then those concluding their premises in turn. 
+ * These are all the variables solving the goal could ever ask for, plus the conclusions between.
+ *
+ * @param string goal - the conclusion to start from
+ *
+ * @return vector<string> - the names, sorted
+ */
+std::vector<std::string> KnowledgeBase::premiseNamesReachableFrom(const std::string& goal) const
+{
+    std::map<std::string, std::vector<int> > conclusionIndex;
+    for (int statementIter = 1; statementIter < kBase.size(); statementIter++)
+    {
+        conclusionIndex[kBase.at(statementIter).conclusion.name].push_back(statementIter);
+    }
+
+    std::set<std::string> reached;
+    std::vector<std::string> pending(1, goal);
+    while (!pending.empty())
+    {
+        std::string name = pending.back();
+        pending.pop_back();
+
+        const std::vector<int>& statements = conclusionIndex[name];
+        for (int statementIter = 0; statementIter < statements.size(); statementIter++)
+        {
+            const std::vector<ClauseItem>& premiseList = kBase.at(statements.at(statementIter)).premiseList;
+            for (int premiseIter = 1; premiseIter < premiseList.size(); premiseIter++)
+            {
+                std::vector<ClauseItem> tests = premiseTests(premiseList.at(premiseIter));
+                for (int testIter = 0; testIter < tests.size(); testIter++)
+                {
+                    if (reached.insert(tests.at(testIter).name).second)
+                    {
+                        pending.push_back(tests.at(testIter).name);
+                    }
+                }
+            }
+        }
+    }
+
+    return std::vector<std::string>(reached.begin(), reached.end());
+}
+
+/**
+ * premiseTests - the name = value tests a premise is made of: the premise itself, or every 
+ * distinct test in an EXPRESSION premise, negated or not. Whatever walks the KB by name 
+ * (dependencies, inverted indexes, slices) looks at these.
+ *
+ * @param ClauseItem premise - a premise of a statement in kBase
+ *
+ * @return vector<ClauseItem> - the tests, in KB order
+ */
+std::vector<ClauseItem> KnowledgeBase::premiseTests(const ClauseItem& premise) const
+{
+    if (premise.type != EXPRESSION)
+    {
+        return std::vector<ClauseItem>(1, premise);
+    }
+
+    std::vector<ClauseItem> tests;
+    const std::vector<int>& leaves = expressions.node(expressions.find(premise.name)).leaves;
+    for (int leafIter = 0; leafIter < leaves.size(); leafIter++)
+    {
+        tests.push_back(expressions.node(leaves.at(leafIter)).clause);
+    }
+    return tests;
+}
+
+/**
+ * finalConclusion - the conclusion forward chaining ends on: the one conclusion that no premise 
+ * of any statement tests, so nothing is concluded from it.
+ *
+ * @return string - its name, or empty if no conclusion or more than one is final
+ */
+std::string KnowledgeBase::finalConclusion() const
+{
+    std::set<std::string> testedNames;
+    for (int statementIter = 1; statementIter < kBase.size(); statementIter++)
+    {
+        const std::vector<ClauseItem>& premiseList = kBase.at(statementIter).premiseList;
+        for (int premiseIter = 1; premiseIter < premiseList.size(); premiseIter++)
+        {
+            std::vector<ClauseItem> tests = premiseTests(premiseList.at(premiseIter));
+            for (int testIter = 0; testIter < tests.size(); testIter++)
+            {
+                testedNames.insert(tests.at(testIter).name);
+            }
+        }
+    }
+
+    std::string finalName;
+    for (std::set<std::string>::const_iterator conclusion = conclusionSet.begin(); conclusion != conclusionSet.end(); ++conclusion)
+    {
+        if (testedNames.count(*conclusion) == 0)
+        {
+            if (!finalName.empty())
+            {
+                return "";
+            }
+            finalName = *conclusion;
+        }
+    }
+    return finalName;
+}
+
+/**
+ * displayLoadSummary - prints how many statements were loaded and how many were rejected, 
+ * then pauses so the user can read the loader output.
+ *
+ * @param int total_good - statements added to the KB
+ * @param int total_bad - malformed lines skipped
+ *
+ * @return none
+ */
+void KnowledgeBase::displayLoadSummary(int total_good, int total_bad)
+{
     std::cout << "\nKnowledge Base finished Loading.\n" << total_good << " items were loaded into the KnowledgeBase\n";
+    if (expressions.expressionCount() > 0)
+        std::cout << expressions.expressionCount() << " OR/NOT premise(s) compiled into " << expressions.size() << " shared node(s)\n";
     if ( total_bad > 0 )
         std::cerr << "\nWARNING! " << total_bad << " malfromed item(s) were not loaded into the Knowledge Base. " << 
         "\nPlease check output above for items not loaded and inspect data file.\n";
@@ -83,6 +488,7 @@ void KnowledgeBase::populateKnowledgeBase(std::string fileName)
 
 /**
  * isConclusionGood - helper function to check if the conclusion in the premise is valid and trim any white spaces
+ * A trailing [certainty] is taken off the value into the statement's certainty.
  * 
  * @param Statement& lList - a statement containing the premise list and the conclusion it leads to
  * @param std::string iBuffer - the entire statement (premise and conclusions)
@@ -90,7 +496,7 @@ void KnowledgeBase::populateKnowledgeBase(std::string fileName)
  * 
  * @return bool - if the conclusion is valid, true. Otherwise false. 
  */
-bool KnowledgeBase::isConclusionGood(Statement& lList, std::string iBuffer, std::string& listPremise)
+bool KnowledgeBase::isConclusionGood(Statement& lList, std::string iBuffer, std::string& listPremise) const
 {
     ClauseItem nClause;
     std::string listConclusion;
@@ -130,10 +536,7 @@ bool KnowledgeBase::isConclusionGood(Statement& lList, std::string iBuffer, std:
     }
 
     lList.conclusion.type = STRING;
-    conclusionSet.insert(lList.conclusion.name); // add conclusion to set, maintaining unique list of conclusions
-
-    std::cout << "Conclusion is good; ";
-    return true;
+    return CertaintyRanking::splitCertainty(lList.conclusion.value, lList.certainty);
 }
 
 /**
@@ -144,8 +547,14 @@ bool KnowledgeBase::isConclusionGood(Statement& lList, std::string iBuffer, std:
  * 
  * @return bool - if the premise is valid, true. Otherwise false. 
  */
-bool KnowledgeBase::arePremisesGood(Statement& lList, std::string listPremise)
+bool KnowledgeBase::arePremisesGood(Statement& lList, std::string listPremise) const
 {
+    // OR, NOT and grouping go to the full grammar; plain AND lists load as they always have.
+    if (listPremise.find_first_of("|!()") != std::string::npos)
+    {
+        return ExpressionPool::parsePremises(listPremise, lList.premiseList);
+    }
+
     ClauseItem nClause;
     std::string listRight,
         listLeft,
@@ -200,7 +609,6 @@ bool KnowledgeBase::arePremisesGood(Statement& lList, std::string listPremise)
         lList.premiseList.push_back(nClause);
     } while (listPremise.size() != 0);
 
-    std::cout << "Premise list is good!  " << lList.premiseList.size() - 1 << " premise(s) loaded\n";
     return true;
 }
 
@@ -226,7 +634,10 @@ void KnowledgeBase::displayBase()
                 std::cout << " AND ";
 
         }
-        std::cout << " THEN " << kBase.at(pntr).conclusion.name << std::endl;
+        std::cout << " THEN " << kBase.at(pntr).conclusion.name;
+        if (kBase.at(pntr).certainty != 1)
+            std::cout << " (certainty " << kBase.at(pntr).certainty << ")";
+        std::cout << std::endl;
         pntr++;
     }
 }
@@ -0,0 +1,264 @@
+#include <stdexcept>
+
+#include "KnowledgeRegistry.hpp"
+
+// A rule's certainty is kept in an image word as a whole number of millionths.
+#define CERTAINTY_SCALE 1000000
+
+
+/**
+ * Member Function | SymbolPool | intern
+ *
+ * @param string text: Any string.
+ *
+ * @return unsigned int: Its symbol; the same for equal strings.
+ */
+unsigned int SymbolPool::intern(const std::string& text)
+{
+    std::unordered_map<const std::string*, unsigned int, TextHash, TextEqual>::const_iterator known = symbolIds.find(&text);
+    if (known != symbolIds.end())
+    {
+        return known->second;
+    }
+
+    unsigned int symbol = symbols.size();
+    symbols.push_back(std::unique_ptr<std::string>(new std::string(text)));
+    symbolIds.insert(std::make_pair(symbols.back().get(), symbol));
+    return symbol;
+}
+
+/**
+ * Member Function | SymbolPool | text
+ *
+ * @param unsigned int symbol: A symbol from intern.
+ *
+ * @return const string&: Its text.
+ */
+const std::string& SymbolPool::text(unsigned int symbol) const
+{
+    return *symbols.at(symbol);
+}
+
+/**
+ * Member Function | SymbolPool | size
+ *
+ * @return int: The number of distinct strings.
+ */
+int SymbolPool::size() const
+{
+    return symbols.size();
+}
+
+/**
+ * Member Function | SymbolPool | bytes
+ *
+ * @return long: The characters of the distinct strings.
+ */
+long SymbolPool::bytes() const
+{
+    long total = 0;
+    for (int symbolIter = 0; symbolIter < symbols.size(); symbolIter++)
+    {
+        total += symbols.at(symbolIter)->size();
+    }
+    return total;
+}
+
+/**
+ * Member Function | KnowledgeRegistry | add
+ *
+ * Summary: Loads a model's knowledge base and variable list and keeps them
+ *          under its key, replacing any model already there. Safe to call
+ *          from several threads; the files are parsed outside the lock.
+ *
+ * @param string key: The model, e.g. its platform code.
+ * @param string knowledgeBaseFile: A file in the knowledgeBase.txt format.
+ * @param string variableListFile: A file in the variablesList.csv format.
+ */
+void KnowledgeRegistry::add(const std::string& key, const std::string& knowledgeBaseFile, const std::string& variableListFile)
+{
+    std::shared_ptr<KnowledgeHandle> loaded = KnowledgeHandle::load(knowledgeBaseFile, variableListFile);
+
+    std::lock_guard<std::mutex> guard(lock);
+    models[key] = compact(*loaded);
+
+    // An image the model was the last one using is dropped with it.
+    for (int imageIter = images.size() - 1; imageIter >= 0; imageIter--)
+    {
+        if (images.at(imageIter).use_count() == 1)
+            images.erase(images.begin() + imageIter);
+    }
+}
+
+/**
+ * Member Function | KnowledgeRegistry | handle
+ *
+ * Summary: The model's KB for InferenceSession. While any handle to it is
+ *          held, every call returns the same one.
+ *
+ * @param string key: A key given to add.
+ *
+ * @return shared_ptr<KnowledgeHandle>: The model's KB, expanded from its
+ *          image if no session holds it.
+ */
+std::shared_ptr<KnowledgeHandle> KnowledgeRegistry::handle(const std::string& key)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    std::map<std::string, std::shared_ptr<Image> >::const_iterator model = models.find(key);
+    if (model == models.end())
+    {
+        throw std::runtime_error("No knowledge base is registered as " + key + ".");
+    }
+
+    Image& image = *model->second;
+    std::shared_ptr<KnowledgeHandle> expanded = image.expansion.lock();
+    if (!expanded)
+    {
+        expanded = expand(image);
+        image.expansion = expanded;
+    }
+    return expanded;
+}
+
+/**
+ * Member Function | KnowledgeRegistry | keys
+ *
+ * @return vector<string>: The registered models, sorted.
+ */
+std::vector<std::string> KnowledgeRegistry::keys() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    std::vector<std::string> registered;
+    for (std::map<std::string, std::shared_ptr<Image> >::const_iterator model = models.begin(); model != models.end(); ++model)
+    {
+        registered.push_back(model->first);
+    }
+    return registered;
+}
+
+/**
+ * Member Function | KnowledgeRegistry | displayStatistics
+ *
+ * Summary: Prints how many models share how many images and symbols, and
+ *          what the images take.
+ *
+ * @param ostream& out: Where to print.
+ */
+void KnowledgeRegistry::displayStatistics(std::ostream& out) const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    long imageBytes = 0;
+    int expandedCount = 0;
+    for (int imageIter = 0; imageIter < images.size(); imageIter++)
+    {
+        imageBytes += (images.at(imageIter)->statements.size() + images.at(imageIter)->variables.size()) * sizeof(unsigned int);
+        if (!images.at(imageIter)->expansion.expired())
+            expandedCount++;
+    }
+
+    out << "Knowledge registry: " << models.size() << " model(s), " << images.size() << " distinct KB(s), "
+        << expandedCount << " in use; " << symbolPool.size() << " symbol(s) in " << symbolPool.bytes()
+        << " bytes, images " << imageBytes << " bytes." << std::endl;
+}
+
+/**
+ * Member Function | KnowledgeRegistry | compact
+ *
+ * Summary: Interns a loaded model into the pool. If a model with the same
+ *          content is already kept, its image is shared instead.
+ *
+ * @param KnowledgeHandle handleP: The freshly loaded model.
+ *
+ * @return shared_ptr<Image>: The model's image.
+ */
+std::shared_ptr<KnowledgeRegistry::Image> KnowledgeRegistry::compact(const KnowledgeHandle& handleP)
+{
+    std::shared_ptr<Image> image(new Image());
+    image->version = handleP.ruleSystem.version;
+
+    const std::vector<Statement>& kBase = handleP.ruleSystem.kBase;
+    for (int statementIter = 1; statementIter < kBase.size(); statementIter++)
+    {
+        const Statement& statement = kBase.at(statementIter);
+        image->statements.push_back(statement.premiseList.size());
+        image->statements.push_back(symbolPool.intern(statement.conclusion.name));
+        image->statements.push_back(symbolPool.intern(statement.conclusion.value));
+        image->statements.push_back(statement.conclusion.type);
+        image->statements.push_back((unsigned int)(statement.certainty * CERTAINTY_SCALE + 0.5));
+        for (int premiseIter = 0; premiseIter < statement.premiseList.size(); premiseIter++)
+        {
+            image->statements.push_back(symbolPool.intern(statement.premiseList.at(premiseIter).name));
+            image->statements.push_back(symbolPool.intern(statement.premiseList.at(premiseIter).value));
+            image->statements.push_back(statement.premiseList.at(premiseIter).type);
+        }
+    }
+
+    const std::vector<VariableListItem>& variableList = handleP.variableList;
+    for (int varListIter = 1; varListIter < variableList.size(); varListIter++)
+    {
+        image->variables.push_back(symbolPool.intern(variableList.at(varListIter).name));
+        image->variables.push_back(symbolPool.intern(variableList.at(varListIter).description));
+        image->variables.push_back(variableList.at(varListIter).type);
+    }
+
+    for (int imageIter = 0; imageIter < images.size(); imageIter++)
+    {
+        const Image& known = *images.at(imageIter);
+        if (known.version == image->version && known.statements == image->statements && known.variables == image->variables)
+        {
+            return images.at(imageIter);
+        }
+    }
+    images.push_back(image);
+    return image;
+}
+
+/**
+ * Member Function | KnowledgeRegistry | expand
+ *
+ * @param Image image: A model's image.
+ *
+ * @return shared_ptr<KnowledgeHandle>: The model as KnowledgeHandle::load
+ *          returned it.
+ */
+std::shared_ptr<KnowledgeHandle> KnowledgeRegistry::expand(const Image& image) const
+{
+    std::shared_ptr<KnowledgeHandle> expanded(new KnowledgeHandle());
+    KnowledgeBase& ruleSystem = expanded->ruleSystem;
+
+    // To offest the vectors by 1, populate index 0 with NULL or Empty elements.
+    ruleSystem.kBase.push_back(Statement());
+    for (int wordIter = 0; wordIter < image.statements.size(); )
+    {
+        int premiseCount = image.statements.at(wordIter++);
+        ClauseItem conclusion(symbolPool.text(image.statements.at(wordIter)), symbolPool.text(image.statements.at(wordIter + 1)),
+                              image.statements.at(wordIter + 2));
+        double certainty = (double)image.statements.at(wordIter + 3) / CERTAINTY_SCALE;
+        wordIter += 4;
+
+        // The premise list keeps its own NULL entry at index 0.
+        std::vector<ClauseItem> premiseList;
+        premiseList.reserve(premiseCount);
+        for (int premiseIter = 0; premiseIter < premiseCount; premiseIter++, wordIter += 3)
+        {
+            premiseList.push_back(ClauseItem(symbolPool.text(image.statements.at(wordIter)),
+                                             symbolPool.text(image.statements.at(wordIter + 1)), image.statements.at(wordIter + 2)));
+        }
+        Statement statement(conclusion, premiseList);
+        statement.certainty = certainty;
+        ruleSystem.conclusionSet.insert(statement.conclusion.name);
+        ruleSystem.kBase.push_back(statement);
+    }
+    ruleSystem.updateVersion();
+
+    std::vector<VariableListItem>& variableList = expanded->variableList;
+    variableList.push_back(VariableListItem("Empty", false, "", "This is an error string", STRING));
+    for (int wordIter = 0; wordIter < image.variables.size(); wordIter += 3)
+    {
+        variableList.push_back(VariableListItem(symbolPool.text(image.variables.at(wordIter)), false, "",
+                                                symbolPool.text(image.variables.at(wordIter + 1)),
+                                                image.variables.at(wordIter + 2)));
+    }
+
+    return expanded;
+}
@@ -0,0 +1,260 @@
+#include <cstdlib>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <set>
+#include <stdexcept>
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+#include "KnowledgeShards.hpp"
+#include "CertaintyRanking.hpp"
+
+#define SHARD_MANIFEST "manifest.txt"
+#define SHARD_MANIFEST_HEADER "# KB shard manifest v1"
+
+
+/**
+ * Static Function | KnowledgeShards | partition
+ *
+ * Summary: Writes one shard per conclusion variable, holding the statements
+ *          that conclude it in their KB order, and the manifest. Back
+ *          chaining only ever matches statements by conclusion name, so the
+ *          order between shards does not matter.
+ *
+ *          Manifest lines are tab separated: conclusion, shard file, rule
+ *          count, then the conclusion variables its premises depend on. The
+ *          header carries the total rule count.
+ *
+ * @param const KnowledgeBase& knowledgeBase: The fully loaded knowledge base.
+ * @param string directoryP: Where to write. Created if it does not exist.
+ */
+void KnowledgeShards::partition(const KnowledgeBase& knowledgeBase, const std::string& directoryP)
+{
+#ifndef _WIN32
+    mkdir(directoryP.c_str(), 0755);
+#endif
+
+    std::map<std::string, std::vector<int> > statementsByConclusion;
+    for (int statementIter = 1; statementIter < knowledgeBase.kBase.size(); statementIter++)
+    {
+        statementsByConclusion[knowledgeBase.kBase.at(statementIter).conclusion.name].push_back(statementIter);
+    }
+
+    std::ofstream manifestFile((directoryP + "/" + SHARD_MANIFEST).c_str());
+    if (!manifestFile)
+    {
+        throw std::runtime_error("Error writing shard manifest to " + directoryP + ".");
+    }
+    manifestFile << SHARD_MANIFEST_HEADER << "\t" << (knowledgeBase.kBase.size() - 1) << "\n";
+
+    int shardNumber = 0;
+    for (std::map<std::string, std::vector<int> >::const_iterator shardIter = statementsByConclusion.begin();
+         shardIter != statementsByConclusion.end(); ++shardIter, ++shardNumber)
+    {
+        std::ostringstream fileName;
+        fileName << "shard_" << shardNumber << ".txt";
+
+        std::ofstream shardFile((directoryP + "/" + fileName.str()).c_str());
+        if (!shardFile)
+        {
+            throw std::runtime_error("Error writing shard " + fileName.str() + ".");
+        }
+
+        std::set<std::string> dependencies;
+        for (int ruleIter = 0; ruleIter < shardIter->second.size(); ruleIter++)
+        {
+            const Statement& statement = knowledgeBase.kBase.at(shardIter->second.at(ruleIter));
+            shardFile << formatStatement(statement) << "\n";
+
+            for (int premiseIter = 1; premiseIter < statement.premiseList.size(); premiseIter++)
+            {
+                std::vector<ClauseItem> tests = knowledgeBase.premiseTests(statement.premiseList.at(premiseIter));
+                for (int testIter = 0; testIter < tests.size(); testIter++)
+                {
+                    if (statementsByConclusion.count(tests.at(testIter).name) > 0)
+                    {
+                        dependencies.insert(tests.at(testIter).name);
+                    }
+                }
+            }
+        }
+
+        manifestFile << shardIter->first << "\t" << fileName.str() << "\t" << shardIter->second.size();
+        for (std::set<std::string>::const_iterator depIter = dependencies.begin(); depIter != dependencies.end(); ++depIter)
+        {
+            manifestFile << "\t" << *depIter;
+        }
+        manifestFile << "\n";
+    }
+
+    std::cout << (knowledgeBase.kBase.size() - 1) << " rule(s) written to " << shardNumber
+              << " shard(s) in " << directoryP << std::endl;
+}
+
+/**
+ * Static Function | KnowledgeShards | formatStatement
+ *
+ * Summary: Writes a statement back in the knowledge base file format, i.e.
+ *          name = value ^ name = value : name = value. An OR/NOT premise is
+ *          written as its canonical text, which loads back the same, and a
+ *          rule's certainty, if not 1, follows the conclusion.
+ *
+ * @param const Statement& statement: The statement to format.
+ *
+ * @return string: One KB file line, without the newline.
+ */
+std::string KnowledgeShards::formatStatement(const Statement& statement)
+{
+    std::string line;
+    for (int premiseIter = 1; premiseIter < statement.premiseList.size(); premiseIter++)
+    {
+        if (premiseIter > 1)
+        {
+            line += " ^ ";
+        }
+        line += statement.premiseList.at(premiseIter).describe();
+    }
+    return line + " : " + statement.conclusion.name + " = "
+        + CertaintyRanking::withCertainty(statement.conclusion.value, statement.certainty);
+}
+
+/**
+ * Member Function | KnowledgeShards | loadManifest
+ *
+ * Summary: Reads the manifest and fills in the conclusion set, so the user
+ *          can be offered every conclusion without any shard being loaded.
+ *          Room for every statement is reserved up front: shards are paged in
+ *          while the engines hold references into kBase, so kBase must never
+ *          reallocate. Untouched reserved memory does not become resident.
+ *
+ * @param string directoryP: The directory partition() wrote to.
+ * @param KnowledgeBase& knowledgeBase: The (empty but for index 0) KB.
+ */
+void KnowledgeShards::loadManifest(const std::string& directoryP, KnowledgeBase& knowledgeBase)
+{
+    std::ifstream manifestFile((directoryP + "/" + SHARD_MANIFEST).c_str());
+    std::string manifestLine;
+
+    if (!manifestFile || !getline(manifestFile, manifestLine) || manifestLine.find(SHARD_MANIFEST_HEADER) != 0)
+    {
+        throw std::runtime_error("Error reading shard manifest in " + directoryP + ". Run with -partition first.");
+    }
+
+    directory = directoryP;
+    shards.clear();
+    totalRules = atoi(manifestLine.substr(manifestLine.find('\t') + 1).c_str());
+    loadedRules = 0;
+
+    while (getline(manifestFile, manifestLine))
+    {
+        std::istringstream fields(manifestLine);
+        std::string conclusionName, field;
+        ShardEntry entry;
+
+        if (!getline(fields, conclusionName, '\t') || !getline(fields, entry.fileName, '\t') || !getline(fields, field, '\t'))
+        {
+            continue;
+        }
+        entry.ruleCount = atoi(field.c_str());
+        entry.isLoaded = false;
+        while (getline(fields, field, '\t'))
+        {
+            entry.dependencies.push_back(field);
+        }
+
+        shards[conclusionName] = entry;
+        knowledgeBase.conclusionSet.insert(conclusionName);
+    }
+
+    knowledgeBase.kBase.reserve(knowledgeBase.kBase.size() + totalRules);
+    std::cout << "Shard manifest loaded: " << shards.size() << " shard(s), " << totalRules << " rule(s)." << std::endl;
+}
+
+/**
+ * Member Function | KnowledgeShards | ensureGoalLoaded
+ *
+ * Summary: Loads the shard of the goal and of every conclusion it can reach
+ *          through the manifest's dependency lists.
+ *
+ * @param string goal: The conclusion the user wants solved.
+ * @param KnowledgeBase& knowledgeBase: Where shards are appended.
+ */
+void KnowledgeShards::ensureGoalLoaded(const std::string& goal, KnowledgeBase& knowledgeBase)
+{
+    std::vector<std::string> pending(1, goal);
+    std::set<std::string> visited;
+
+    while (!pending.empty())
+    {
+        std::string conclusionName = pending.back();
+        pending.pop_back();
+
+        std::map<std::string, ShardEntry>::const_iterator shard = shards.find(conclusionName);
+        if (shard == shards.end() || !visited.insert(conclusionName).second)
+        {
+            continue;
+        }
+
+        ensureLoaded(conclusionName, knowledgeBase);
+        pending.insert(pending.end(), shard->second.dependencies.begin(), shard->second.dependencies.end());
+    }
+}
+
+/**
+ * Member Function | KnowledgeShards | ensureLoaded
+ *
+ * Summary: Pages in the shard of one conclusion if it is not loaded yet.
+ *          Cheap enough to call on every goal.
+ *
+ * @param string conclusionName: The conclusion being looked for.
+ * @param KnowledgeBase& knowledgeBase: Where the shard is appended.
+ */
+void KnowledgeShards::ensureLoaded(const std::string& conclusionName, KnowledgeBase& knowledgeBase)
+{
+    std::map<std::string, ShardEntry>::iterator shard = shards.find(conclusionName);
+    if (shard == shards.end() || shard->second.isLoaded)
+    {
+        return;
+    }
+
+    shard->second.isLoaded = true;
+    loadedRules += knowledgeBase.appendKnowledgeBase(directory + "/" + shard->second.fileName);
+}
+
+/**
+ * Member Function | KnowledgeShards | displayUsage
+ *
+ * Summary: Prints how much of the partitioned KB is resident.
+ */
+void KnowledgeShards::displayUsage() const
+{
+    int loadedShards = 0;
+    for (std::map<std::string, ShardEntry>::const_iterator shard = shards.begin(); shard != shards.end(); ++shard)
+    {
+        if (shard->second.isLoaded)
+        {
+            loadedShards++;
+        }
+    }
+
+    std::cout << "\nLoaded " << loadedRules << " of " << totalRules << " rule(s) from "
+              << loadedShards << " of " << shards.size() << " shard(s)." << std::endl;
+}
+
+/**
+ * Member Function | KnowledgeShards | shardSizes
+ *
+ * @return vector<pair<string, int> >: The conclusion and rule count of every
+ *          shard in the manifest, in manifest order.
+ */
+std::vector<std::pair<std::string, int> > KnowledgeShards::shardSizes() const
+{
+    std::vector<std::pair<std::string, int> > sizes;
+    for (std::map<std::string, ShardEntry>::const_iterator shard = shards.begin(); shard != shards.end(); ++shard)
+    {
+        sizes.push_back(std::make_pair(shard->first, shard->second.ruleCount));
+    }
+    return sizes;
+}
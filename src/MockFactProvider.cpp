@@ -0,0 +1,152 @@
+#include <chrono>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+
+#include "MockFactProvider.hpp"
+
+
+/**
+ * Constructor | MockFactProvider | MockFactProvider
+ *
+ * @param int latencyMillisecondsP: The simulated cost of one request.
+ */
+MockFactProvider::MockFactProvider(int latencyMillisecondsP)
+    : latencyMilliseconds(latencyMillisecondsP), requestCount(0), factsServed(0)
+{
+}
+
+/**
+ * Member Function | MockFactProvider | setFact
+ *
+ * @param string name: A variable.
+ * @param string value: The value the store holds for it.
+ */
+void MockFactProvider::setFact(const std::string& name, const std::string& value)
+{
+    facts[name] = value;
+}
+
+/**
+ * Member Function | MockFactProvider | loadFacts
+ *
+ * Summary: Reads name = value lines, as in a -facts file, into the store.
+ *
+ * @param string fileName: The facts file.
+ *
+ * @return int: The number of facts read.
+ */
+int MockFactProvider::loadFacts(const std::string& fileName)
+{
+    std::ifstream factsFile(fileName);
+    if (!factsFile)
+    {
+        throw std::runtime_error("Error reading facts file " + fileName + ".");
+    }
+
+    std::string factLine;
+    int factCount = 0;
+    while (getline(factsFile, factLine))
+    {
+        int equalsLocation = factLine.find('=', 0);
+        if (equalsLocation == -1)
+        {
+            continue;
+        }
+
+        std::string name = factLine.substr(0, equalsLocation);
+        std::string value = factLine.substr(equalsLocation + 1);
+        name.erase(0, name.find_first_not_of(' '));
+        name.erase(name.find_last_not_of(' ') + 1);
+        value.erase(0, value.find_first_not_of(' '));
+        value.erase(value.find_last_not_of(" \r") + 1);
+        setFact(name, value);
+        factCount++;
+    }
+
+    return factCount;
+}
+
+/**
+ * Member Function | MockFactProvider | provideFact
+ *
+ * Summary: One round trip for one variable.
+ */
+bool MockFactProvider::provideFact(const VariableListItem& variable, std::string& value)
+{
+    FactValues found = lookup(std::vector<std::string>(1, variable.name));
+    if (found.empty())
+    {
+        return false;
+    }
+
+    value = found.begin()->second;
+    return true;
+}
+
+/**
+ * Member Function | MockFactProvider | requestFacts
+ *
+ * Summary: One round trip for every variable asked for, served on a thread
+ *          of its own while the session carries on.
+ */
+std::future<FactValues> MockFactProvider::requestFacts(const std::vector<VariableListItem>& variables)
+{
+    std::vector<std::string> names;
+    for (int variableIter = 0; variableIter < variables.size(); variableIter++)
+    {
+        names.push_back(variables.at(variableIter).name);
+    }
+
+    return std::async(std::launch::async, &MockFactProvider::lookup, this, names);
+}
+
+/**
+ * Member Function | MockFactProvider | getRequestCount
+ *
+ * @return int: Round trips made so far.
+ */
+int MockFactProvider::getRequestCount() const
+{
+    return requestCount;
+}
+
+/**
+ * Member Function | MockFactProvider | getFactsServed
+ *
+ * @return int: Values returned so far, over all requests.
+ */
+int MockFactProvider::getFactsServed() const
+{
+    return factsServed;
+}
+
+/**
+ * Member Function | MockFactProvider | lookup
+ *
+ * Summary: Serves one request after the simulated latency.
+ *
+ * @param vector<string> names: The variables asked for.
+ *
+ * @return FactValues: Those the store has a value for.
+ */
+FactValues MockFactProvider::lookup(const std::vector<std::string>& names)
+{
+    requestCount++;
+    if (latencyMilliseconds > 0)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(latencyMilliseconds));
+    }
+
+    FactValues found;
+    for (int nameIter = 0; nameIter < names.size(); nameIter++)
+    {
+        FactValues::const_iterator fact = facts.find(names.at(nameIter));
+        if (fact != facts.end())
+        {
+            found.insert(*fact);
+        }
+    }
+    factsServed += found.size();
+    return found;
+}
@@ -0,0 +1,325 @@
+#include <algorithm>
+#include <climits>
+#include <iostream>
+
+#include "ParallelBackChain.hpp"
+#include "InferenceTrace.hpp"
+
+
+/**
+ * Constructor | ParallelBackChain | ParallelBackChain
+ *
+ * @param int threadCount: Number of pool workers.
+ * @param int maxDepthP: The deepest chain of intermediate conclusions that
+ *          will be followed before a goal is treated as unproven. This also
+ *          stops conclusion cycles.
+ * @param KnowledgeBase* sharedRuleSystem: See BackChain::BackChain.
+ */
+ParallelBackChain::ParallelBackChain(int threadCount, int maxDepthP, KnowledgeBase* sharedRuleSystem)
+    : BackChain(sharedRuleSystem), maxDepth(maxDepthP), pool(threadCount)
+{
+}
+
+/**
+ * Member Function | ParallelBackChain | CancelToken::isSet
+ *
+ * @return bool: true if this token or any token it descends from was
+ *               cancelled.
+ */
+bool ParallelBackChain::CancelToken::isSet() const
+{
+    for (const CancelToken* token = this; token != nullptr; token = token->parent)
+    {
+        if (token->isCancelled.load(std::memory_order_relaxed))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Member Function | ParallelBackChain | findValidConclusionInStatements
+ *
+ * Summary: Same contract as BackChain::findValidConclusionInStatements. The
+ *          intermediate conclusions of the winning proof are recorded once
+ *          the proof is complete.
+ *
+ * @param string conclusionName: The name of a conclusion to match up to.
+ * @param int startingIndex: The first index location to begin searching from.
+ * @param string stringToMatch: The value to match, or DONTCARE.
+ *
+ * @return int location:   Specifies the location of a conclusion.
+ */
+int ParallelBackChain::findValidConclusionInStatements(std::string conclusionName, int startingIndex, std::string stringToMatch)
+{
+    CancelToken rootToken;
+    ProvenList proven;
+
+    buildIndexes();
+    int location = proveGoal(conclusionName, stringToMatch, startingIndex, 0, rootToken, proven);
+
+    if (location > 0)
+    {
+        for (int provenIter = 0; provenIter < proven.size(); provenIter++)
+        {
+            addToIntermediateConclusionList(*proven.at(provenIter).first);
+            recordProven(proven.at(provenIter).second);
+        }
+        recordProven(location);
+    }
+
+    return location;
+}
+
+/**
+ * Member Function | ParallelBackChain | buildIndexes
+ *
+ * Summary: Indexes statements by conclusion name, unless the KB is the
+ *          version already indexed, and instantiated variables by name. Both
+ *          are read only while the workers run. As with
+ *          instantiatePremiseClause, the first variable list entry of a name
+ *          is the one that counts.
+ */
+void ParallelBackChain::buildIndexes()
+{
+    if (!isConclusionIndexBuilt || conclusionIndexVersion != ruleSystem.version)
+    {
+        conclusionIndex.clear();
+        for (int statementIter = 1; statementIter < ruleSystem.kBase.size(); statementIter++)
+        {
+            conclusionIndex[ruleSystem.kBase.at(statementIter).conclusion.name].push_back(statementIter);
+        }
+        isConclusionIndexBuilt = true;
+        conclusionIndexVersion = ruleSystem.version;
+    }
+
+    factIndex.clear();
+    for (int varListIter = 1; varListIter < variableList.size(); varListIter++)
+    {
+        const VariableListItem& variable = variableList.at(varListIter);
+        if (factIndex.count(variable.name) == 0)
+        {
+            factIndex[variable.name] = variable.instantiated ? &variable.value : nullptr;
+        }
+    }
+}
+
+/**
+ * Member Function | ParallelBackChain | proveGoal
+ *
+ * Summary: Tries every statement concluding name = value (any value for
+ *          DONTCARE). Candidates are cut into a few chunks per worker; each
+ *          chunk tries its candidates in KB order and gives up as soon as a
+ *          candidate before it has succeeded.
+ *
+ * @param string name, value: The goal.
+ * @param int startingIndex: The first statement that may be used.
+ * @param int depth: Number of goals above this one.
+ * @param CancelToken& token: Set when this goal's result is no longer needed.
+ * @param ProvenList& proven: Receives the intermediate conclusions of the
+ *          winning proof and the statements that proved them.
+ *
+ * @return int: The winning statement, -1 if none held, 0 if name is not a
+ *              conclusion.
+ */
+int ParallelBackChain::proveGoal(const std::string& name, const std::string& value, int startingIndex, int depth,
+                                 const CancelToken& token, ProvenList& proven)
+{
+    std::unordered_map<std::string, std::vector<int> >::const_iterator indexEntry = conclusionIndex.find(name);
+    if (indexEntry == conclusionIndex.end())
+    {
+        return 0;
+    }
+
+    std::vector<int> candidates;
+    for (int candidateIter = 0; candidateIter < indexEntry->second.size(); candidateIter++)
+    {
+        int statement = indexEntry->second.at(candidateIter);
+        if (statement >= startingIndex &&
+            (value == "DONTCARE" || value == ruleSystem.kBase.at(statement).conclusion.value))
+        {
+            candidates.push_back(statement);
+        }
+    }
+
+    if (depth >= maxDepth || candidates.empty())
+    {
+        return -1;
+    }
+
+    // One candidate, nothing to spread out.
+    if (candidates.size() == 1)
+    {
+        ProvenList statementProven;
+        if (!proveStatement(candidates.front(), depth, token, statementProven))
+        {
+            return -1;
+        }
+        proven.insert(proven.end(), statementProven.begin(), statementProven.end());
+        return candidates.front();
+    }
+
+    int chunkCount = std::min<int>(candidates.size(), pool.size() * 4);
+    int chunkSize = (candidates.size() + chunkCount - 1) / chunkCount;
+    chunkCount = (candidates.size() + chunkSize - 1) / chunkSize;
+
+    std::atomic<int> bestStatement(INT_MAX);
+    std::vector<CancelToken> chunkTokens(chunkCount);
+    std::vector<ProvenList> chunkProven(chunkCount);
+
+    {
+        TaskGroup group(pool);
+        for (int chunkIter = 0; chunkIter < chunkCount; chunkIter++)
+        {
+            chunkTokens.at(chunkIter).parent = &token;
+            group.run([&, chunkIter]()
+            {
+                int lastCandidate = std::min<int>((chunkIter + 1) * chunkSize, candidates.size());
+                for (int candidateIter = chunkIter * chunkSize; candidateIter < lastCandidate; candidateIter++)
+                {
+                    int statement = candidates.at(candidateIter);
+                    if (statement > bestStatement.load() || chunkTokens.at(chunkIter).isSet())
+                    {
+                        return;
+                    }
+
+                    ProvenList statementProven;
+                    if (proveStatement(statement, depth, chunkTokens.at(chunkIter), statementProven))
+                    {
+                        int best = bestStatement.load();
+                        while (statement < best && !bestStatement.compare_exchange_weak(best, statement))
+                        {
+                        }
+                        chunkProven.at(chunkIter).swap(statementProven);
+
+                        // Chunks after this one can only find later statements.
+                        for (int laterChunk = chunkIter + 1; laterChunk < chunkCount; laterChunk++)
+                        {
+                            chunkTokens.at(laterChunk).isCancelled = true;
+                        }
+                        return;
+                    }
+                }
+            });
+        }
+        group.wait();
+    }
+
+    if (bestStatement.load() == INT_MAX)
+    {
+        return -1;
+    }
+
+    int winningChunk = (std::find(candidates.begin(), candidates.end(), bestStatement.load()) - candidates.begin()) / chunkSize;
+    proven.insert(proven.end(), chunkProven.at(winningChunk).begin(), chunkProven.at(winningChunk).end());
+    return bestStatement.load();
+}
+
+/**
+ * Member Function | ParallelBackChain | proveStatement
+ *
+ * Summary: Checks the premises of one statement in order. A premise that is
+ *          a conclusion becomes a sub goal; any other premise must match an
+ *          instantiated variable. An OR/NOT premise is decided test by test,
+ *          see proveLeaf.
+ *
+ * @return bool: true if every premise held.
+ */
+bool ParallelBackChain::proveStatement(int statement, int depth, const CancelToken& token,
+                                       ProvenList& proven)
+{
+    // Only the deadline applies here; the rule and premise counters are
+    // not shared between workers.
+    if (!budget.checkDeadline())
+    {
+        return false;
+    }
+
+    const std::vector<ClauseItem>& premiseList = ruleSystem.kBase.at(statement).premiseList;
+    InferenceTrace::record(InferenceTrace::RULE_TRIED, statement);
+
+    for (int premiseIter = 1; premiseIter < premiseList.size(); premiseIter++)
+    {
+        if (token.isSet())
+        {
+            return false;
+        }
+
+        const ClauseItem& premise = premiseList.at(premiseIter);
+        if (premise.type == EXPRESSION)
+        {
+            bool holds = ruleSystem.expressions.evaluate(ruleSystem.expressions.find(premise.name),
+                [&](const ExpressionPool::Node& leaf) { return proveLeaf(leaf, depth, token, proven); });
+            if (!holds)
+            {
+                InferenceTrace::record(InferenceTrace::PREMISE_FAILED, statement, premiseIter);
+                return false;
+            }
+            continue;
+        }
+
+        int location = proveGoal(premise.name, premise.value, 1, depth + 1, token, proven);
+
+        if (location == -1)
+        {
+            InferenceTrace::record(InferenceTrace::PREMISE_FAILED, statement, premiseIter);
+            return false;
+        }
+
+        if (location > 0)
+        {
+            proven.push_back(std::make_pair(&premise, location));
+        }
+        else
+        {
+            std::unordered_map<std::string, const std::string*>::const_iterator fact = factIndex.find(premise.name);
+            if (fact == factIndex.end() || fact->second == nullptr || *fact->second != premise.value)
+            {
+                InferenceTrace::record(InferenceTrace::PREMISE_FAILED, statement, premiseIter);
+                return false;
+            }
+        }
+    }
+
+    InferenceTrace::record(InferenceTrace::RULE_FIRED, statement);
+    return true;
+}
+
+/**
+ * Member Function | ParallelBackChain | proveLeaf
+ *
+ * Summary: Decides one test of an OR/NOT premise, as
+ *          BackChain::isExpressionLeafTrue does, from the instantiated
+ *          variables only.
+ *
+ * @param const ExpressionPool::Node& leaf: A LEAF node.
+ * @param int depth: Number of goals above the statement being proven.
+ * @param CancelToken& token: The statement's token.
+ * @param ProvenList& proven: Receives the conclusions the test proves.
+ *
+ * @return bool: Whether the test holds.
+ */
+bool ParallelBackChain::proveLeaf(const ExpressionPool::Node& leaf, int depth, const CancelToken& token, ProvenList& proven)
+{
+    int location = proveGoal(leaf.clause.name, leaf.clause.value, 1, depth + 1, token, proven);
+    if (location > 0)
+    {
+        if (!leaf.isNegated)
+        {
+            proven.push_back(std::make_pair(&leaf.clause, location));
+        }
+        return !leaf.isNegated;
+    }
+    if (location == -1)
+    {
+        return leaf.isNegated && depth + 1 < maxDepth && !token.isSet() && budget.checkDeadline();
+    }
+
+    std::unordered_map<std::string, const std::string*>::const_iterator fact = factIndex.find(leaf.clause.name);
+    if (fact == factIndex.end() || fact->second == nullptr)
+    {
+        return false;
+    }
+    return (*fact->second == leaf.clause.value) != leaf.isNegated;
+}
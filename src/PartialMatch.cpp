@@ -0,0 +1,299 @@
+#include <algorithm>
+
+#include "PartialMatch.hpp"
+
+
+// Conclusions are inlined at most this deep, which also ends cycles.
+static const int MAX_FLATTEN_DEPTH = 16;
+
+// With the popcnt instruction one instruction per word; otherwise the
+// branch free SWAR count, which beats the compiler's library call.
+static inline int countBits(uint64_t word)
+{
+#if defined(__GNUC__) && defined(__POPCNT__)
+    return __builtin_popcountll(word);
+#else
+    word = word - ((word >> 1) & 0x5555555555555555ULL);
+    word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+    word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (int)((word * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+/**
+ * Member Function | PartialMatch | bitFor
+ *
+ * @param string name: A premise variable or conclusion.
+ * @param string value: The value the premise requires.
+ * @param int type: EXPRESSION for an OR/NOT premise, which is kept whole;
+ *          no answer sets or contradicts its bit.
+ *
+ * @return int: The bit of the premise, given a new one the first time.
+ */
+int PartialMatch::bitFor(const std::string& name, const std::string& value, int type)
+{
+    std::pair<std::map<std::pair<std::string, std::string>, int>::iterator, bool> inserted =
+        bitByAtom.insert(std::make_pair(std::make_pair(name, value), (int)atoms.size()));
+    if (inserted.second)
+    {
+        atoms.push_back(ClauseItem(name, value, type));
+        bitsByName[name].push_back(inserted.first->second);
+    }
+    return inserted.first->second;
+}
+
+/**
+ * Member Function | PartialMatch | flattenPremises
+ *
+ * Summary: Collects the bits of a premise list. A premise on a conclusion
+ *          that exactly one rule proves stands for that rule's premises, so
+ *          a repair is scored by the answers it rests on even while its
+ *          issue is unproven. A conclusion proven by several rules is kept
+ *          as one premise.
+ *
+ * @param vector<ClauseItem> premiseList: The premises to flatten, from index 1.
+ * @param KnowledgeBase knowledgeBase: The KB the rules are from.
+ * @param map rulesByConclusion: "name = value" -> rules concluding it.
+ * @param int depth: How many conclusions were inlined to get here.
+ * @param vector<int>& bits: Receives the bits, possibly repeated.
+ */
+void PartialMatch::flattenPremises(const std::vector<ClauseItem>& premiseList, const KnowledgeBase& knowledgeBase,
+                                   const std::map<std::pair<std::string, std::string>, std::vector<int> >& rulesByConclusion,
+                                   int depth, std::vector<int>& bits)
+{
+    for (int premiseIter = 1; premiseIter < premiseList.size(); premiseIter++)
+    {
+        const ClauseItem& premise = premiseList.at(premiseIter);
+        std::map<std::pair<std::string, std::string>, std::vector<int> >::const_iterator concluding =
+            rulesByConclusion.find(std::make_pair(premise.name, premise.value));
+
+        if (concluding != rulesByConclusion.end() && concluding->second.size() == 1 && depth < MAX_FLATTEN_DEPTH)
+        {
+            flattenPremises(knowledgeBase.kBase.at(concluding->second.front()).premiseList, knowledgeBase,
+                            rulesByConclusion, depth + 1, bits);
+        }
+        else
+        {
+            bits.push_back(bitFor(premise.name, premise.value, premise.type));
+        }
+    }
+}
+
+/**
+ * Member Function | PartialMatch | build
+ *
+ * Summary: Indexes the rules concluding the goal as sparse premise bitsets.
+ *
+ * @param string goal: The conclusion whose rules are ranked.
+ * @param KnowledgeBase knowledgeBase: The loaded KB.
+ */
+void PartialMatch::build(const std::string& goal, const KnowledgeBase& knowledgeBase)
+{
+    atoms.clear();
+    bitByAtom.clear();
+    bitsByName.clear();
+    rules.clear();
+    ruleStart.clear();
+    rulePremiseCount.clear();
+    maskWords.clear();
+
+    std::map<std::pair<std::string, std::string>, std::vector<int> > rulesByConclusion;
+    for (int statementIter = 1; statementIter < knowledgeBase.kBase.size(); statementIter++)
+    {
+        const ClauseItem& conclusion = knowledgeBase.kBase.at(statementIter).conclusion;
+        rulesByConclusion[std::make_pair(conclusion.name, conclusion.value)].push_back(statementIter);
+    }
+
+    std::vector<int> bits;
+    for (int statementIter = 1; statementIter < knowledgeBase.kBase.size(); statementIter++)
+    {
+        const Statement& statement = knowledgeBase.kBase.at(statementIter);
+        if (statement.conclusion.name != goal)
+            continue;
+
+        bits.clear();
+        flattenPremises(statement.premiseList, knowledgeBase, rulesByConclusion, 0, bits);
+        std::sort(bits.begin(), bits.end());
+        bits.erase(std::unique(bits.begin(), bits.end()), bits.end());
+
+        rules.push_back(statementIter);
+        ruleStart.push_back(maskWords.size());
+        rulePremiseCount.push_back(bits.size());
+        for (int bitIter = 0; bitIter < bits.size(); bitIter++)
+        {
+            int word = bits.at(bitIter) / 64;
+            if (maskWords.size() == ruleStart.back() || maskWords.back().word != word)
+            {
+                MaskWord maskWord = { word, 0 };
+                maskWords.push_back(maskWord);
+            }
+            maskWords.back().mask |= (uint64_t)1 << (bits.at(bitIter) % 64);
+        }
+    }
+    ruleStart.push_back(maskWords.size());
+
+    satisfiedBits.assign((atoms.size() + 63) / 64, 0);
+    contradictedBits.assign(satisfiedBits.size(), 0);
+    builtGoal = goal;
+    builtVersion = knowledgeBase.version;
+}
+
+/**
+ * Member Function | PartialMatch | markKnown
+ *
+ * Summary: Sets the bit of the premise a known value satisfies and the bits
+ *          of the premises it contradicts, those on other values of it.
+ *
+ * @param string name: A variable or conclusion with a known value.
+ * @param string value: Its value.
+ */
+void PartialMatch::markKnown(const std::string& name, const std::string& value)
+{
+    std::map<std::string, std::vector<int> >::const_iterator named = bitsByName.find(name);
+    if (named == bitsByName.end())
+        return;
+
+    for (int bitIter = 0; bitIter < named->second.size(); bitIter++)
+    {
+        int bit = named->second.at(bitIter);
+        std::vector<uint64_t>& target = (atoms.at(bit).value == value) ? satisfiedBits : contradictedBits;
+        target.at(bit / 64) |= (uint64_t)1 << (bit % 64);
+    }
+}
+
+/**
+ * Member Function | PartialMatch | rank
+ *
+ * Summary: Scores every rule for the goal against the facts and proven
+ *          conclusions of a session in one pass and returns the closest.
+ *          Rules with fewer contradicted premises come first, then those
+ *          with more of their premises satisfied, then shorter rules.
+ *
+ * @param string goal: The conclusion, e.g. repair.
+ * @param int count: How many candidates to return at most.
+ * @param KnowledgeBase knowledgeBase: The session's KB.
+ * @param vector<VariableListItem> variableList: The session's facts.
+ * @param vector<VariableListItem> intermediateConclusionList: The
+ *          conclusions the session proved.
+ *
+ * @return vector<Candidate>: The candidates, best first.
+ */
+std::vector<PartialMatch::Candidate> PartialMatch::rank(const std::string& goal, int count, const KnowledgeBase& knowledgeBase,
+                                                        const std::vector<VariableListItem>& variableList,
+                                                        const std::vector<VariableListItem>& intermediateConclusionList)
+{
+    if (goal != builtGoal || knowledgeBase.version != builtVersion)
+        build(goal, knowledgeBase);
+
+    std::fill(satisfiedBits.begin(), satisfiedBits.end(), 0);
+    std::fill(contradictedBits.begin(), contradictedBits.end(), 0);
+    // An empty answer (the user just pressed Enter, or input ran out) says
+    // nothing about the variable, so its premises stay unknown.
+    for (int variableIter = 1; variableIter < variableList.size(); variableIter++)
+    {
+        if (variableList.at(variableIter).instantiated && !variableList.at(variableIter).value.empty())
+            markKnown(variableList.at(variableIter).name, variableList.at(variableIter).value);
+    }
+    for (int conclusionIter = 1; conclusionIter < intermediateConclusionList.size(); conclusionIter++)
+    {
+        markKnown(intermediateConclusionList.at(conclusionIter).name, intermediateConclusionList.at(conclusionIter).value);
+    }
+
+    // Scores are plain integers so the pass over every rule and the top
+    // count selection never allocate.
+    scores.resize(rules.size());
+    for (int ruleIter = 0; ruleIter < rules.size(); ruleIter++)
+    {
+        RuleScore& score = scores[ruleIter];
+        score.rule = ruleIter;
+        score.satisfied = 0;
+        score.contradicted = 0;
+        score.premiseCount = rulePremiseCount[ruleIter];
+        for (int wordIter = ruleStart[ruleIter]; wordIter < ruleStart[ruleIter + 1]; wordIter++)
+        {
+            const MaskWord& maskWord = maskWords[wordIter];
+            score.satisfied += countBits(satisfiedBits[maskWord.word] & maskWord.mask);
+            score.contradicted += countBits(contradictedBits[maskWord.word] & maskWord.mask);
+        }
+    }
+
+    int returned = std::min(std::max(count, 0), (int)scores.size());
+    std::partial_sort(scores.begin(), scores.begin() + returned, scores.end(),
+        [](const RuleScore& left, const RuleScore& right)
+        {
+            if (left.contradicted != right.contradicted)
+                return left.contradicted < right.contradicted;
+            // Compares satisfied / premiseCount without dividing.
+            long leftShare = (long)left.satisfied * right.premiseCount;
+            long rightShare = (long)right.satisfied * left.premiseCount;
+            if (leftShare != rightShare)
+                return leftShare > rightShare;
+            if (left.premiseCount != right.premiseCount)
+                return left.premiseCount < right.premiseCount;
+            return left.rule < right.rule;
+        });
+
+    // Only the returned rules need their unknown premises spelled out.
+    std::vector<Candidate> candidates(returned);
+    for (int candidateIter = 0; candidateIter < returned; candidateIter++)
+    {
+        const RuleScore& score = scores.at(candidateIter);
+        Candidate& candidate = candidates.at(candidateIter);
+        candidate.statement = rules.at(score.rule);
+        candidate.satisfied = score.satisfied;
+        candidate.contradicted = score.contradicted;
+        candidate.premiseCount = score.premiseCount;
+        for (int wordIter = ruleStart.at(score.rule); wordIter < ruleStart.at(score.rule + 1); wordIter++)
+        {
+            const MaskWord& maskWord = maskWords.at(wordIter);
+            uint64_t unknown = maskWord.mask & ~satisfiedBits.at(maskWord.word) & ~contradictedBits.at(maskWord.word);
+            for (; unknown != 0; unknown &= unknown - 1)
+            {
+                int bit = maskWord.word * 64 + countBits((unknown & (~unknown + 1)) - 1);
+                candidate.confirmingPremises.push_back(atoms.at(bit));
+            }
+        }
+    }
+
+    return candidates;
+}
+
+/**
+ * Static Function | PartialMatch | display
+ *
+ * Summary: Prints the candidates, each with the questions, and the answers
+ *          to them, that would confirm it.
+ *
+ * @param vector<Candidate> candidates: As returned by rank.
+ * @param KnowledgeBase knowledgeBase: The KB they were ranked against.
+ * @param vector<VariableListItem> variableList: Where the questions are.
+ * @param ostream& out: Where to print.
+ */
+void PartialMatch::display(const std::vector<Candidate>& candidates, const KnowledgeBase& knowledgeBase,
+                           const std::vector<VariableListItem>& variableList, std::ostream& out)
+{
+    for (int candidateIter = 0; candidateIter < candidates.size(); candidateIter++)
+    {
+        const Candidate& candidate = candidates.at(candidateIter);
+        out << "  " << (candidateIter + 1) << ". " << knowledgeBase.kBase.at(candidate.statement).conclusion.value
+            << "  (" << candidate.satisfied << " of " << candidate.premiseCount << " premises hold";
+        if (candidate.contradicted > 0)
+            out << ", " << candidate.contradicted << " contradicted";
+        out << ")" << std::endl;
+
+        for (int premiseIter = 0; premiseIter < candidate.confirmingPremises.size(); premiseIter++)
+        {
+            const ClauseItem& premise = candidate.confirmingPremises.at(premiseIter);
+            std::string question = premise.name;
+            for (int variableIter = 1; variableIter < variableList.size(); variableIter++)
+            {
+                if (variableList.at(variableIter).name == premise.name)
+                    question = variableList.at(variableIter).description;
+            }
+            if (premise.type == EXPRESSION)
+                out << "       " << premise.name << std::endl;
+            else
+                out << "       " << question << " -> " << premise.value << std::endl;
+        }
+    }
+}
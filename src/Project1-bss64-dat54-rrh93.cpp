@@ -1,13 +1,32 @@
 #pragma warning(disable : 4996)
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <fstream> 
 #include <string.h>
+#include <cstdio>
 #include <cstdlib> 
+#include <memory>
+#include <sstream>
+#include <vector>
+#include <thread>
 
 #include "ClauseItem.hpp"
 #include "Statement.hpp"
 #include "BackChain.hpp"
+#include "IterativeBackChain.hpp"
+#include "ParallelBackChain.hpp"
+#include "BytecodeBackChain.hpp"
+#include "DecisionTable.hpp"
+#include "KnowledgeShards.hpp"
+#include "ResultCache.hpp"
+#include "ShardCluster.hpp"
+#include "InferenceTrace.hpp"
+#include "RuleProfile.hpp"
+#include "SessionCheckpoint.hpp"
+#include "SessionLog.hpp"
+#include "SessionReplay.hpp"
 #include "ForwardChain.hpp"
 #include "VariableListItem.hpp"
 
@@ -41,6 +60,508 @@ void repair(ForwardChain& forwardChain)
 }
 
 
+/**
+ * recommendRepair - forward chains from the facts and conclusions the back chain left behind.
+ * Only the rules that can lead to the KB's final conclusion (the repair) are fired, unless the
+ * KB is loaded as shards: the shards of that conclusion may not be paged in yet.
+ *
+ * @param BackChain& backChain - a BackChain instance that has solved its goal
+ *
+ * @return none
+ */
+void recommendRepair(BackChain& backChain)
+{
+    ForwardChain forwardChain;
+    forwardChain.copyKnowledgeBase(backChain.ruleSystem);
+    forwardChain.copyVariableList(backChain.variableList);
+    forwardChain.addIntermediateConclusions(backChain.intermediateConclusionList);
+    forwardChain.budget.limits = backChain.budget.limits;
+    forwardChain.threadPool = backChain.forwardPool;
+    forwardChain.ruleStrata = &backChain.ruleStrata;
+    std::string finalConclusion = backChain.shardDirectory.empty() ? backChain.ruleSystem.finalConclusion() : "";
+    if (!finalConclusion.empty())
+    {
+        forwardChain.relevanceSlice = &backChain.relevanceSlices.sliceFor(finalConclusion, backChain.ruleSystem);
+    }
+
+    repair(forwardChain);
+}
+
+
+/**
+ * splitGoals - turns the argument of -goal into a list of goals.
+ *
+ * @param string goalList - comma separated conclusion names, or all
+ *
+ * @return vector<string> - the names; empty for all, meaning every conclusion in the KB
+ */
+std::vector<std::string> splitGoals(const std::string& goalList)
+{
+    std::vector<std::string> goals;
+    if (goalList == "all")
+        return goals;
+
+    std::stringstream goalStream(goalList);
+    std::string goal;
+    while (getline(goalStream, goal, ','))
+    {
+        if (!goal.empty())
+            goals.push_back(goal);
+    }
+    return goals;
+}
+
+
+/**
+ * answerFromTable - answers a batch case's goal from a decision table, with no chaining.
+ *
+ * @param BackChain& backChain - a BackChain instance holding the case's answers
+ * @param DecisionTable decisionTable - a table for the loaded KB
+ * @param int caseNumber - the case being answered
+ * @param ostream& out - where to print the answer
+ *
+ * @return bool - false, with nothing printed, if the case lacks an answer the table needs
+ */
+bool answerFromTable(const BackChain& backChain, const DecisionTable& decisionTable, int caseNumber, std::ostream& out)
+{
+    FactValues answers;
+    for (int varListIter = 1; varListIter < backChain.variableList.size(); varListIter++)
+    {
+        const VariableListItem& variable = backChain.variableList.at(varListIter);
+        if (variable.instantiated)
+            answers.insert(std::make_pair(variable.name, variable.value));
+    }
+
+    std::string missing;
+    int location = decisionTable.lookup(answers, missing);
+    if (location == DecisionTable::MISSING_ANSWER)
+        return false;
+
+    out << "Case " << caseNumber << ": ";
+    if (location > 0)
+        out << decisionTable.goal << " = " << backChain.ruleSystem.kBase.at(location).conclusion.value << "  rule: " << location;
+    else
+        out << decisionTable.goal << " is inconclusive";
+    out << "  (table)" << std::endl;
+    return true;
+}
+
+
+/**
+ * solveCase - solves the goals for one batch case whose answers are loaded, and prints the results.
+ * The same pass as BackChain::solveGoals, one goal at a time so each result can say whether 
+ * it came from the cache. With -rank, each result is followed by the goal's values ranked by 
+ * certainty.
+ *
+ * @param BackChain& backChain - a BackChain instance holding the case's answers
+ * @param int caseNumber - the case being solved
+ * @param vector<string> goals - the conclusions to solve
+ * @param DecisionTable* decisionTable - answers its goal without chaining when it can, may be nullptr
+ * @param ostream& out - where to print the results
+ *
+ * @return none
+ */
+void solveCase(BackChain& backChain, int caseNumber, const std::vector<std::string>& goals,
+               const DecisionTable* decisionTable, std::ostream& out)
+{
+    for (int goalIter = 0; goalIter < goals.size(); goalIter++)
+    {
+        const std::string& goal = goals.at(goalIter);
+        if (decisionTable != nullptr && goal == decisionTable->goal && answerFromTable(backChain, *decisionTable, caseNumber, out))
+            continue;
+
+        int location = backChain.solveGoal(goal);
+        out << "Case " << caseNumber << ": ";
+        if (location > 0)
+        {
+            out << goal << " = " << backChain.ruleSystem.kBase.at(location).conclusion.value << "  proof:";
+            std::vector<int> proof = backChain.getProof(location);
+            for (int proofIter = 0; proofIter < proof.size(); proofIter++)
+                out << " " << proof.at(proofIter);
+        }
+        else if (backChain.budget.isStopped())
+        {
+            out << goal << " was not reached: stopped because " << backChain.budget.describe();
+        }
+        else
+        {
+            out << goal << " is inconclusive";
+        }
+        out << (backChain.isLastResultCached ? "  (cached)" : "") << std::endl;
+
+        if (location == -1 && !backChain.budget.isStopped() && backChain.candidateCount > 0)
+        {
+            PartialMatch::display(backChain.partialMatch.rank(goal, backChain.candidateCount, backChain.ruleSystem,
+                                                              backChain.variableList, backChain.intermediateConclusionList),
+                                  backChain.ruleSystem, backChain.variableList, out);
+        }
+        if (location != 0 && backChain.rankCount > 0)
+        {
+            backChain.displayRanking(goal, out);
+        }
+    }
+}
+
+
+/**
+ * runBatch - solves the goals for every case in a batch file without any prompting for them: 
+ * a fact a case does not give stays unknown. Cases are paragraphs of name = value lines 
+ * separated by blank lines. The loaded KB and variable list are reused; only the answers 
+ * are reset between cases. The goals of a case are solved in one pass, so subgoals they 
+ * share are only solved once.
+ *
+ * @param BackChain& backChain - a loaded BackChain instance
+ * @param string batchFileName - the file holding the cases
+ * @param vector<string> goals - the conclusions to solve for every case, empty for all of them
+ * @param DecisionTable* decisionTable - answers its goal without chaining when the case has 
+ *          every answer it needs, may be nullptr
+ *
+ * @return EXIT_SUCCESS 0, or EXIT_FAILURE if the batch file cannot be read
+ */
+int runBatch(BackChain& backChain, const std::string& batchFileName, const std::vector<std::string>& goals,
+             const DecisionTable* decisionTable)
+{
+    std::ifstream batchFile(batchFileName);
+    if (!batchFile)
+    {
+        std::cout << "Error reading batch file " << batchFileName << "." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::string> allGoals(backChain.ruleSystem.conclusionSet.begin(), backChain.ruleSystem.conclusionSet.end());
+    const std::vector<std::string>& batchGoals = goals.empty() ? allGoals : goals;
+
+    NoFactProvider noFactProvider;
+    backChain.factProvider = &noFactProvider;
+
+    int caseNumber = 0;
+    while (batchFile.peek() != EOF)
+    {
+        backChain.resetSession();
+        if (backChain.loadFacts(batchFile) == 0)
+            continue;
+
+        solveCase(backChain, ++caseNumber, batchGoals, decisionTable, std::cout);
+    }
+    backChain.factProvider = nullptr;
+
+    if (backChain.resultCache != nullptr)
+        backChain.resultCache->displayStatistics();
+
+    return EXIT_SUCCESS;
+}
+
+
+/**
+ * runShardedBatch - solves a batch file as runBatch does, over a cluster of shard worker
+ * processes. Each of laneCount threads works through the cases with a ShardSession of its 
+ * own, so that many cases are in flight across the workers at once; the results are 
+ * printed in case order.
+ *
+ * @param BackChain& backChain - a BackChain instance with the shard manifest and variable list loaded
+ * @param ShardCluster& cluster - the started cluster
+ * @param string batchFileName - the file holding the cases
+ * @param vector<string> goals - the conclusions to solve for every case, empty for all of them
+ * @param int laneCount - how many cases to have in flight
+ *
+ * @return EXIT_SUCCESS 0, or EXIT_FAILURE if the batch file cannot be read or a worker fails
+ */
+int runShardedBatch(BackChain& backChain, ShardCluster& cluster, const std::string& batchFileName,
+                    const std::vector<std::string>& goals, int laneCount)
+{
+    std::ifstream batchFile(batchFileName);
+    if (!batchFile)
+    {
+        std::cout << "Error reading batch file " << batchFileName << "." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::string> allGoals(backChain.ruleSystem.conclusionSet.begin(), backChain.ruleSystem.conclusionSet.end());
+    const std::vector<std::string>& batchGoals = goals.empty() ? allGoals : goals;
+
+    // Every case's answers, read up front with a scratch session.
+    BackChain reader(&backChain.ruleSystem);
+    reader.variableList = backChain.variableList;
+    std::vector<std::vector<VariableListItem> > cases;
+    while (batchFile.peek() != EOF)
+    {
+        reader.resetSession();
+        if (reader.loadFacts(batchFile) > 0)
+            cases.push_back(reader.variableList);
+    }
+
+    std::vector<std::string> results(cases.size());
+    std::atomic<int> nextCase(0);
+    std::atomic<bool> isFailed(false);
+    std::vector<std::thread> lanes;
+    for (int laneIter = 0; laneIter < std::max(laneCount, 1); laneIter++)
+    {
+        lanes.push_back(std::thread([&]()
+        {
+            KnowledgeBase proofBase;
+            ShardSession session(cluster, &proofBase, backChain.variableList);
+            try
+            {
+                for (int caseIter = nextCase++; caseIter < cases.size() && !isFailed; caseIter = nextCase++)
+                {
+                    session.resetSession();
+                    session.variableList = cases.at(caseIter);
+
+                    std::ostringstream out;
+                    solveCase(session, caseIter + 1, batchGoals, nullptr, out);
+                    results.at(caseIter) = out.str();
+                }
+            }
+            catch (const std::runtime_error&)
+            {
+                isFailed = true;
+            }
+        }));
+    }
+    for (int laneIter = 0; laneIter < lanes.size(); laneIter++)
+    {
+        lanes.at(laneIter).join();
+    }
+
+    for (int caseIter = 0; caseIter < results.size(); caseIter++)
+    {
+        std::cout << results.at(caseIter);
+    }
+    cluster.displayUsage(std::cout);
+
+    if (isFailed)
+    {
+        std::cout << "A shard worker stopped; the batch is incomplete." << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+
+/**
+ * runReplay - replays the sessions captured in a session log through the chosen engine and 
+ * reports the throughput, the latencies and any results that differ from the capture.
+ *
+ * @param BackChain& backChain - the loaded BackChain instance; each lane gets an engine of 
+ *          the same kind over its KB
+ * @param string replayFileName - a log written with -capture
+ * @param int laneCount - how many sessions to replay at once
+ * @param double pace - 0 for full speed, else the speed up over the recorded pacing
+ * @param int threadCount - worker threads for each -parallel engine
+ *
+ * @return EXIT_SUCCESS 0, or EXIT_FAILURE if any result differs
+ */
+int runReplay(BackChain& backChain, const std::string& replayFileName, int laneCount, double pace, int threadCount)
+{
+    std::vector<SessionLog::Session> sessions = SessionLog::read(replayFileName);
+
+    // Lanes share the KB read only, so every shard the sessions need is
+    // loaded up front.
+    if (!backChain.shardDirectory.empty())
+    {
+        for (int sessionIter = 0; sessionIter < sessions.size(); sessionIter++)
+        {
+            const std::vector<SessionLog::Event>& events = sessions.at(sessionIter).events;
+            for (int eventIter = 0; eventIter < events.size(); eventIter++)
+            {
+                if (events.at(eventIter).type == SessionLog::GOAL_SOLVED)
+                    backChain.knowledgeShards.ensureGoalLoaded(events.at(eventIter).name, backChain.ruleSystem);
+            }
+        }
+    }
+
+    const IterativeBackChain* iterativeChain = dynamic_cast<const IterativeBackChain*>(&backChain);
+    const ParallelBackChain* parallelChain = dynamic_cast<const ParallelBackChain*>(&backChain);
+    BytecodeBackChain* bytecodeChain = dynamic_cast<BytecodeBackChain*>(&backChain);
+    const RuleBytecode* program = (bytecodeChain != nullptr) ? &bytecodeChain->compile() : nullptr;
+    SessionReplay::SessionFactory makeSession = [&]()
+    {
+        std::unique_ptr<BackChain> engine;
+        if (parallelChain != nullptr)
+            engine.reset(new ParallelBackChain(threadCount, parallelChain->maxDepth, &backChain.ruleSystem));
+        else if (iterativeChain != nullptr)
+            engine.reset(new IterativeBackChain(iterativeChain->maxDepth, &backChain.ruleSystem));
+        else if (bytecodeChain != nullptr)
+            engine.reset(new BytecodeBackChain(&backChain.ruleSystem, program));
+        else
+            engine.reset(new BackChain(&backChain.ruleSystem));
+
+        engine->variableList = backChain.variableList;
+        engine->intermediateConclusionList.push_back(VariableListItem("Empty", false, "", "This is an error string", STRING));
+        engine->budget.limits = backChain.budget.limits;
+        engine->resultCache = backChain.resultCache;
+        return engine;
+    };
+
+    SessionReplay replay(sessions);
+    replay.run(makeSession, backChain.ruleSystem.version, laneCount, pace);
+    replay.displayReport(std::cout);
+
+    if (backChain.resultCache != nullptr)
+        backChain.resultCache->displayStatistics();
+
+    return replay.differences.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+/**
+ * suspendSession - parks a suspended session in its checkpoint file.
+ *
+ * @param BackChain& backChain - a BackChain instance the user suspended
+ * @param string checkpointFile - where to park it, may be empty
+ *
+ * @return none
+ */
+void suspendSession(const BackChain& backChain, const std::string& checkpointFile)
+{
+    if (checkpointFile.empty())
+    {
+        std::cout << "\nNo -checkpoint file was given, so the session cannot be suspended." << std::endl;
+        return;
+    }
+
+    SessionCheckpoint::saveFile(backChain, checkpointFile);
+    std::cout << "\nSession suspended to " << checkpointFile << "; run again with -checkpoint "
+              << checkpointFile << " to resume." << std::endl;
+}
+
+
+/**
+ * runSession - one interactive session: optionally display the KB, diagnose with backward 
+ * chaining, then recommend a repair with forward chaining. With a checkpoint file, a session 
+ * suspended there earlier is resumed, and answering suspend to any question parks the session 
+ * there again.
+ *
+ * @param BackChain& backChain - a loaded BackChain instance
+ * @param string factsFile - facts to instantiate before chaining, may be empty
+ * @param string checkpointFile - where the session is suspended to, may be empty
+ *
+ * @return none
+ */
+void runSession(BackChain& backChain, const std::string& factsFile, const std::string& checkpointFile)
+{
+    bool isResumed = !checkpointFile.empty() && SessionCheckpoint::restoreFile(backChain, checkpointFile);
+    if (isResumed)
+        std::cout << "Resumed the session suspended to " << checkpointFile << " while solving " << backChain.lastGoal << "." << std::endl;
+
+    if (!factsFile.empty())
+        backChain.loadFacts(factsFile);
+
+    std::string displayKb;
+    std::cout << "Do you want to display the knowledge base (y/n)? ";
+    std::cin >> displayKb;
+
+    if ((displayKb == "Y") || (displayKb == "y"))
+        backChain.ruleSystem.displayBase();
+
+    // Solving the goal again on the restored answers only asks what was
+    // still unanswered when the session was suspended.
+    if (isResumed)
+        backChain.solveAndDisplay(backChain.lastGoal);
+    else
+        diagnose(backChain);
+
+    if (backChain.isSuspended)
+    {
+        suspendSession(backChain, checkpointFile);
+        return;
+    }
+    recommendRepair(backChain);
+
+    // Corrected answers only retract and re-derive the conclusions that
+    // depended on them; the rest of the session stands.
+    std::string correctAnswer;
+    std::cout << std::endl << "Do you want to correct an answer (y/n)? ";
+    while (std::cin >> correctAnswer && (correctAnswer == "Y" || correctAnswer == "y"))
+    {
+        std::string name;
+        std::string value;
+        std::cout << "Variable to correct: ";
+        std::cin >> name;
+        std::cout << "New value for " << name << ": ";
+        std::cin >> value;
+
+        int retractedCount = backChain.changeFact(name, value);
+        if (retractedCount < 0)
+        {
+            std::cout << name << " is not in the variable list, or the certainty given is not in (0, 1]." << std::endl;
+        }
+        else
+        {
+            std::cout << retractedCount << " conclusion(s) depended on " << name << " and were retracted." << std::endl;
+            backChain.solveAndDisplay(backChain.lastGoal);
+            if (backChain.isSuspended)
+            {
+                suspendSession(backChain, checkpointFile);
+                return;
+            }
+            recommendRepair(backChain);
+        }
+        std::cout << std::endl << "Do you want to correct an answer (y/n)? ";
+    }
+
+    // The diagnosis is finished; the next run starts a new one.
+    if (isResumed)
+        std::remove(checkpointFile.c_str());
+}
+
+
+/**
+ * printHelp - prints the instructions and the command line options.
+ *
+ * @return none
+ */
+void printHelp()
+{
+    std::cout << "To use this program, please read the instructions below and re-launch." << std::endl;
+    std::cout << "Additional details for building and execution are also available in the README.md file." << std::endl;
+    std::cout << std::endl;
+
+    std::cout << "1. variablesList.csv and knowledgeBase.txt files will be processed to create an instance of the knowledge base" << std::endl;
+    std::cout << "2. user will be prompted for a conclusion to solve." << std::endl;
+    std::cout << "     - Valid choices for the provided KB file are: issue, repair." << std::endl;
+    std::cout << std::endl;
+
+    std::cout << "Options:" << std::endl;
+    std::cout << "  -h, -help    show this help" << std::endl;
+    std::cout << "  -kb FILE     read the knowledge base from FILE (default knowledgeBase.txt)" << std::endl;
+    std::cout << "  -variables FILE  read the variable list from FILE (default variablesList.csv)" << std::endl;
+    std::cout << "  -analyze     check the KB for dead, duplicate, subsumed and cyclic rules, then exit" << std::endl;
+    std::cout << "  -prune       check the KB at load time and drop the rules the check flags" << std::endl;
+    std::cout << "  -iterative   back chain with an explicit goal stack instead of recursion" << std::endl;
+    std::cout << "  -bytecode    back chain by running the KB compiled to bytecode, recompiled whenever the KB changes" << std::endl;
+    std::cout << "  -maxdepth N  deepest chain of intermediate conclusions -iterative and -parallel follow (default 4096)" << std::endl;
+    std::cout << "  -facts FILE  instantiate variables from FILE (lines of name = value) before chaining" << std::endl;
+    std::cout << "  -parallel    try alternative rules in parallel; all facts must be known up front (see -facts)" << std::endl;
+    std::cout << "  -threads N   worker threads for -parallel, -parallelfc and -parallelload (default: all cores)" << std::endl;
+    std::cout << "  -parallelfc  forward chain the rules a dependency level at a time on -threads workers" << std::endl;
+    std::cout << "  -parallelload  parse the KB file in parallel chunks and load the variable list alongside it" << std::endl;
+    std::cout << "  -partition DIR split the KB into one shard per conclusion plus a manifest in DIR, then exit" << std::endl;
+    std::cout << "  -shards DIR  read only the shard manifest in DIR and load shards for the goals asked for" << std::endl;
+    std::cout << "  -batch FILE  solve -goal for every case in FILE (blank line separated name = value facts)" << std::endl;
+    std::cout << "  -workers N   with -shards and -batch, share the shards between N worker processes and solve -threads cases at a time across them" << std::endl;
+    std::cout << "  -goal NAMES  the conclusions -batch solves, comma separated, or all (default: repair)" << std::endl;
+    std::cout << "  -buildtable FILE  answer every combination of y/n answers to the first -goal ahead of time, check the engines agree, write the table to FILE and exit" << std::endl;
+    std::cout << "  -table FILE  answer the table's goal in -batch from the table in FILE" << std::endl;
+    std::cout << "  -candidates K  when a goal is inconclusive, list the K rules for it that come closest" << std::endl;
+    std::cout << "  -rank K      after each goal, list its K most certain values; answers may carry a certainty, e.g. y[0.6]" << std::endl;
+    std::cout << "  -maxrules N  stop each goal after N rule evaluations and keep what was proven by then" << std::endl;
+    std::cout << "  -maxpremises N  stop each goal after N premise checks" << std::endl;
+    std::cout << "  -timelimit MS  stop each goal after MS milliseconds" << std::endl;
+    std::cout << "  -cache N     keep the last N results, keyed by the facts relevant to the goal, across sessions" << std::endl;
+    std::cout << "  -trace       record inference events and print why/how explanations at the end" << std::endl;
+    std::cout << "  -tracelog FILE  record inference events and write them to FILE as a binary log" << std::endl;
+    std::cout << "  -explainlog FILE  print the why/how explanation of a binary trace log, then exit" << std::endl;
+    std::cout << "  -speculate   while a question is on screen, work out where each answer leads on background threads" << std::endl;
+    std::cout << "  -checkpoint FILE  resume the session suspended to FILE, if any; answer suspend to any question to park the session there" << std::endl;
+    std::cout << "  -capture FILE  append every session's answers, in the order given, and results to the session log FILE" << std::endl;
+    std::cout << "  -replay FILE  replay the sessions captured in FILE through the chosen engine, report throughput, latencies and differing results, then exit" << std::endl;
+    std::cout << "  -pace X      replay at X times the recorded pacing (default 0: full speed)" << std::endl;
+    std::cout << "  -concurrency N  sessions -replay runs at once (default 1)" << std::endl;
+    std::cout << "  -profile FILE  reorder rules and premises by the statistics in FILE, check known answers first, and add this run's statistics to FILE" << std::endl;
+}
+
+
 /**
  * main - main function which serves as the entry point into the application.
  * User will be greeted with a welcome message. 
@@ -61,39 +582,350 @@ int main(int argc, char* argv[])
     std::cout << "Authors: David Torrente (dat54@txstate.edu), Randall Henderson (rrh93@txstate.edu), Borislav Sabotinov (bss64@txstate.edu)." << std::endl;
     std::cout << std::endl;
 
-    if (argc == 2 && (strcmp(argv[1], "-h") || strcmp(argv[1], "-help"))) 
+    bool isAnalyzeOnly = false;
+    bool isPruneOnLoad = false;
+    bool isIterative = false;
+    bool isBytecode = false;
+    bool isParallel = false;
+    bool isParallelLoad = false;
+    bool isParallelForward = false;
+    int maxDepth = 4096;
+    int threadCount = std::thread::hardware_concurrency();
+    std::string knowledgeBaseFile = "knowledgeBase.txt";
+    std::string variableListFile = "variablesList.csv";
+    std::string factsFile;
+    std::string partitionDirectory;
+    std::string shardDirectory;
+    std::string batchFile;
+    std::vector<std::string> batchGoals(1, "repair");
+    int cacheCapacity = 0;
+    bool isTracing = false;
+    std::string traceLogFile;
+    std::string explainLogFile;
+    std::string profileFile;
+    std::string checkpointFile;
+    bool isSpeculative = false;
+    InferenceBudget::Limits budgetLimits;
+    int candidateCount = 0;
+    int rankCount = 0;
+    std::string buildTableFile;
+    std::string tableFile;
+    int workerCount = 0;
+    std::string captureFile;
+    std::string replayFile;
+    double replayPace = 0;
+    int replayConcurrency = 1;
+
+    for (int argIter = 1; argIter < argc; argIter++)
     {
-        std::cout << "To use this program, please read the instructions below and re-launch." << std::endl;
-        std::cout << "Additional details for building and execution are also available in the README.md file." << std::endl;
-        std::cout << std::endl;
+        if (strcmp(argv[argIter], "-h") == 0 || strcmp(argv[argIter], "-help") == 0)
+        {
+            printHelp();
+            return EXIT_SUCCESS;
+        }
+        else if (strcmp(argv[argIter], "-kb") == 0 && argIter + 1 < argc)
+        {
+            knowledgeBaseFile = argv[++argIter];
+        }
+        else if (strcmp(argv[argIter], "-variables") == 0 && argIter + 1 < argc)
+        {
+            variableListFile = argv[++argIter];
+        }
+        else if (strcmp(argv[argIter], "-analyze") == 0)
+        {
+            isAnalyzeOnly = true;
+        }
+        else if (strcmp(argv[argIter], "-prune") == 0)
+        {
+            isPruneOnLoad = true;
+        }
+        else if (strcmp(argv[argIter], "-iterative") == 0)
+        {
+            isIterative = true;
+        }
+        else if (strcmp(argv[argIter], "-bytecode") == 0)
+        {
+            isBytecode = true;
+        }
+        else if (strcmp(argv[argIter], "-maxdepth") == 0 && argIter + 1 < argc)
+        {
+            maxDepth = atoi(argv[++argIter]);
+        }
+        else if (strcmp(argv[argIter], "-facts") == 0 && argIter + 1 < argc)
+        {
+            factsFile = argv[++argIter];
+        }
+        else if (strcmp(argv[argIter], "-parallel") == 0)
+        {
+            isParallel = true;
+        }
+        else if (strcmp(argv[argIter], "-parallelfc") == 0)
+        {
+            isParallelForward = true;
+        }
+        else if (strcmp(argv[argIter], "-parallelload") == 0)
+        {
+            isParallelLoad = true;
+        }
+        else if (strcmp(argv[argIter], "-partition") == 0 && argIter + 1 < argc)
+        {
+            partitionDirectory = argv[++argIter];
+        }
+        else if (strcmp(argv[argIter], "-shards") == 0 && argIter + 1 < argc)
+        {
+            shardDirectory = argv[++argIter];
+        }
+        else if (strcmp(argv[argIter], "-batch") == 0 && argIter + 1 < argc)
+        {
+            batchFile = argv[++argIter];
+        }
+        else if (strcmp(argv[argIter], "-workers") == 0 && argIter + 1 < argc)
+        {
+            workerCount = atoi(argv[++argIter]);
+        }
+        else if (strcmp(argv[argIter], "-goal") == 0 && argIter + 1 < argc)
+        {
+            batchGoals = splitGoals(argv[++argIter]);
+        }
+        else if (strcmp(argv[argIter], "-cache") == 0 && argIter + 1 < argc)
+        {
+            cacheCapacity = atoi(argv[++argIter]);
+        }
+        else if (strcmp(argv[argIter], "-trace") == 0)
+        {
+            isTracing = true;
+        }
+        else if (strcmp(argv[argIter], "-tracelog") == 0 && argIter + 1 < argc)
+        {
+            isTracing = true;
+            traceLogFile = argv[++argIter];
+        }
+        else if (strcmp(argv[argIter], "-explainlog") == 0 && argIter + 1 < argc)
+        {
+            explainLogFile = argv[++argIter];
+        }
+        else if (strcmp(argv[argIter], "-profile") == 0 && argIter + 1 < argc)
+        {
+            profileFile = argv[++argIter];
+        }
+        else if (strcmp(argv[argIter], "-buildtable") == 0 && argIter + 1 < argc)
+        {
+            buildTableFile = argv[++argIter];
+        }
+        else if (strcmp(argv[argIter], "-table") == 0 && argIter + 1 < argc)
+        {
+            tableFile = argv[++argIter];
+        }
+        else if (strcmp(argv[argIter], "-candidates") == 0 && argIter + 1 < argc)
+        {
+            candidateCount = atoi(argv[++argIter]);
+        }
+        else if (strcmp(argv[argIter], "-rank") == 0 && argIter + 1 < argc)
+        {
+            rankCount = atoi(argv[++argIter]);
+        }
+        else if (strcmp(argv[argIter], "-maxrules") == 0 && argIter + 1 < argc)
+        {
+            budgetLimits.maxRuleEvaluations = atol(argv[++argIter]);
+        }
+        else if (strcmp(argv[argIter], "-maxpremises") == 0 && argIter + 1 < argc)
+        {
+            budgetLimits.maxPremiseChecks = atol(argv[++argIter]);
+        }
+        else if (strcmp(argv[argIter], "-timelimit") == 0 && argIter + 1 < argc)
+        {
+            budgetLimits.timeLimitMilliseconds = atol(argv[++argIter]);
+        }
+        else if (strcmp(argv[argIter], "-speculate") == 0)
+        {
+            isSpeculative = true;
+        }
+        else if (strcmp(argv[argIter], "-checkpoint") == 0 && argIter + 1 < argc)
+        {
+            checkpointFile = argv[++argIter];
+        }
+        else if (strcmp(argv[argIter], "-capture") == 0 && argIter + 1 < argc)
+        {
+            captureFile = argv[++argIter];
+        }
+        else if (strcmp(argv[argIter], "-replay") == 0 && argIter + 1 < argc)
+        {
+            replayFile = argv[++argIter];
+        }
+        else if (strcmp(argv[argIter], "-pace") == 0 && argIter + 1 < argc)
+        {
+            replayPace = atof(argv[++argIter]);
+        }
+        else if (strcmp(argv[argIter], "-concurrency") == 0 && argIter + 1 < argc)
+        {
+            replayConcurrency = atoi(argv[++argIter]);
+        }
+        else if (strcmp(argv[argIter], "-threads") == 0 && argIter + 1 < argc)
+        {
+            threadCount = atoi(argv[++argIter]);
+        }
+        else
+        {
+            std::cout << "Unknown option: " << argv[argIter] << std::endl << std::endl;
+            printHelp();
+            return EXIT_FAILURE;
+        }
+    }
 
-        std::cout << "1. variablesList.csv and knowledgeBase.txt files will be processed to create an instance of the knowledge base" << std::endl;
-        std::cout << "2. user will be prompted for a conclusion to solve." << std::endl;
-        std::cout << "     - Valid choices for the provided KB file are: issue, repair." << std::endl;
+    if (workerCount > 0 && (shardDirectory.empty() || batchFile.empty()))
+    {
+        std::cout << "-workers needs -shards and -batch." << std::endl << std::endl;
+        printHelp();
+        return EXIT_FAILURE;
+    }
 
-        return EXIT_SUCCESS;
+    std::unique_ptr<BackChain> backChainPtr;
+    if (isParallel)
+        backChainPtr.reset(new ParallelBackChain(threadCount, maxDepth));
+    else if (isIterative)
+        backChainPtr.reset(new IterativeBackChain(maxDepth));
+    else if (isBytecode)
+        backChainPtr.reset(new BytecodeBackChain());
+    else
+        backChainPtr.reset(new BackChain());
+
+    BackChain& backChain = *backChainPtr;
+    backChain.knowledgeBaseFile = knowledgeBaseFile;
+    backChain.variableListFile = variableListFile;
+    backChain.analyzeOnLoad = isAnalyzeOnly;
+    backChain.pruneOnLoad = isPruneOnLoad;
+    backChain.loadThreads = isParallelLoad ? threadCount : 1;
+    backChain.shardDirectory = shardDirectory;
+    backChain.isSpeculative = isSpeculative;
+    backChain.budget.limits = budgetLimits;
+    backChain.candidateCount = candidateCount;
+    backChain.rankCount = rankCount;
+
+    std::unique_ptr<ThreadPool> forwardPool;
+    if (isParallelForward)
+    {
+        forwardPool.reset(new ThreadPool(threadCount));
+        backChain.forwardPool = forwardPool.get();
     }
 
+    RuleProfile ruleProfile;
+    if (!profileFile.empty())
+    {
+        if (!ruleProfile.load(profileFile))
+            std::cout << "No rule profile in " << profileFile << " yet; this run will start one." << std::endl;
+        backChain.ruleProfile = &ruleProfile;
+        backChain.checkKnownFactsFirst = true;
+    }
 
-    BackChain backChain;
     backChain.populateLists();
 
-    std::string displayKb;
-    std::cout << "Do you want to display the knowledge base (y/n)? ";
-    std::cin >> displayKb;
+    if (isAnalyzeOnly)
+        return EXIT_SUCCESS;
 
-    if ((displayKb == "Y") || (displayKb == "y"))
-        backChain.ruleSystem.displayBase();
+    BytecodeBackChain* bytecodeChain = dynamic_cast<BytecodeBackChain*>(&backChain);
+    if (bytecodeChain != nullptr && shardDirectory.empty())
+    {
+        std::chrono::steady_clock::time_point compileStart = std::chrono::steady_clock::now();
+        const RuleBytecode& program = bytecodeChain->compile();
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - compileStart).count();
+        std::cout << "Compiled " << backChain.ruleSystem.kBase.size() - 1 << " rule(s) to " << program.code.size()
+                  << " instructions over " << program.registerNames.size() << " register(s) in " << milliseconds << " ms." << std::endl;
+        if (!program.isAcyclic)
+            std::cout << "The KB has a conclusion cycle, so it is chained without the bytecode." << std::endl;
+    }
 
-    diagnose(backChain);
+    if (!partitionDirectory.empty())
+    {
+        KnowledgeShards::partition(backChain.ruleSystem, partitionDirectory);
+        return EXIT_SUCCESS;
+    }
 
-    ForwardChain forwardChain;
-    forwardChain.copyKnowledgeBase(backChain.ruleSystem);
-    forwardChain.copyVariableList(backChain.variableList);
-    forwardChain.addIntermediateConclusions(backChain.intermediateConclusionList);
+    if (!buildTableFile.empty())
+    {
+        const std::string& goal = batchGoals.empty() ? std::string("repair") : batchGoals.front();
+        ThreadPool tablePool(threadCount);
+        DecisionTable decisionTable;
+        if (!decisionTable.build(goal, backChain.ruleSystem, backChain.variableList, tablePool, 1 << 20))
+        {
+            std::cout << "There are more than " << (1 << 20) << " ways to answer " << goal << "; no table was written." << std::endl;
+            return EXIT_FAILURE;
+        }
+        decisionTable.displaySummary(std::cout);
+        decisionTable.save(buildTableFile);
+        return decisionTable.mismatches.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
 
-    repair(forwardChain);
+    DecisionTable decisionTable;
+    if (!tableFile.empty())
+    {
+        decisionTable.load(tableFile);
+        if (decisionTable.version != backChain.ruleSystem.version)
+        {
+            std::cout << "The decision table in " << tableFile << " was built from a different knowledge base." << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
 
-    return EXIT_SUCCESS;
-}
+    std::unique_ptr<ResultCache> resultCache;
+    if (cacheCapacity > 0)
+    {
+        resultCache.reset(new ResultCache(cacheCapacity));
+        backChain.resultCache = resultCache.get();
+    }
+
+    if (!explainLogFile.empty())
+    {
+        unsigned long long traceVersion = 0;
+        std::vector<InferenceTrace::Event> events = InferenceTrace::readLog(explainLogFile, traceVersion);
+        if (traceVersion != backChain.ruleSystem.version)
+            std::cout << "WARNING! The trace was taken with a different knowledge base; rule numbers may not match." << std::endl;
+        InferenceTrace::explain(events, backChain.ruleSystem, std::cout);
+        return EXIT_SUCCESS;
+    }
+
+    InferenceTrace::enable(isTracing);
 
+    std::unique_ptr<SessionLog> sessionLog;
+    if (!captureFile.empty())
+    {
+        sessionLog.reset(new SessionLog(captureFile));
+        backChain.sessionLog = sessionLog.get();
+    }
+
+    int status = EXIT_SUCCESS;
+    if (!replayFile.empty())
+    {
+        status = runReplay(backChain, replayFile, replayConcurrency, replayPace, threadCount);
+    }
+    else if (workerCount > 0)
+    {
+        ShardCluster cluster;
+        cluster.start(shardDirectory, workerCount, backChain.variableList);
+        status = runShardedBatch(backChain, cluster, batchFile, batchGoals, threadCount);
+    }
+    else if (!batchFile.empty())
+        status = runBatch(backChain, batchFile, batchGoals, tableFile.empty() ? nullptr : &decisionTable);
+    else
+        runSession(backChain, factsFile, checkpointFile);
+    backChain.finishCapture();
+
+    if (!profileFile.empty())
+        ruleProfile.save(profileFile, backChain.ruleSystem);
+
+    if (isTracing)
+    {
+        std::vector<InferenceTrace::Event> events = InferenceTrace::snapshot();
+        if (traceLogFile.empty())
+        {
+            std::cout << std::endl << "Inference trace (" << events.size() << " events):" << std::endl;
+            InferenceTrace::explain(events, backChain.ruleSystem, std::cout);
+        }
+        else
+        {
+            InferenceTrace::writeLog(traceLogFile, events, backChain.ruleSystem.version);
+            std::cout << std::endl << events.size() << " trace event(s) written to " << traceLogFile << std::endl;
+        }
+    }
+
+    return status;
+}
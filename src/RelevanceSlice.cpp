@@ -0,0 +1,89 @@
+#include <algorithm>
+
+#include "RelevanceSlice.hpp"
+
+
+/**
+ * Constructor | RelevanceSlice | RelevanceSlice
+ *
+ * Summary: Slices the knowledge base for a goal by reverse reachability.
+ *
+ * @param string goalP: The conclusion to be solved.
+ * @param KnowledgeBase knowledgeBase: The loaded KB.
+ */
+RelevanceSlice::RelevanceSlice(const std::string& goalP, const KnowledgeBase& knowledgeBase)
+    : goal(goalP), version(knowledgeBase.version), isInSlice(knowledgeBase.kBase.size(), false)
+{
+    premiseNames = knowledgeBase.premiseNamesReachableFrom(goal);
+
+    for (int statementIter = 1; statementIter < knowledgeBase.kBase.size(); statementIter++)
+    {
+        const std::string& name = knowledgeBase.kBase.at(statementIter).conclusion.name;
+        if (name == goal || std::binary_search(premiseNames.begin(), premiseNames.end(), name))
+        {
+            statements.push_back(statementIter);
+            rulesByConclusion[name].push_back(statementIter);
+            isInSlice.at(statementIter) = true;
+        }
+    }
+}
+
+/**
+ * Member Function | RelevanceSlice | rulesConcluding
+ *
+ * @param string name: The goal or a name in premiseNames.
+ *
+ * @return const vector<int>&: kBase indexes of the rules concluding it, in
+ *          KB order. Empty if no rule does.
+ */
+const std::vector<int>& RelevanceSlice::rulesConcluding(const std::string& name) const
+{
+    static const std::vector<int> none;
+
+    std::map<std::string, std::vector<int> >::const_iterator rules = rulesByConclusion.find(name);
+    return (rules != rulesByConclusion.end()) ? rules->second : none;
+}
+
+/**
+ * Member Function | RelevanceSlice | contains
+ *
+ * @param int statement: A kBase index.
+ *
+ * @return bool: True if the rule can contribute to the goal.
+ */
+bool RelevanceSlice::contains(int statement) const
+{
+    return statement > 0 && statement < isInSlice.size() && isInSlice[statement];
+}
+
+/**
+ * Member Function | RelevanceSlices | sliceFor
+ *
+ * @param string goal: The conclusion to be solved.
+ * @param KnowledgeBase knowledgeBase: The KB the session chains over.
+ *
+ * @return const RelevanceSlice&: The goal's slice of the KB as it is now.
+ *          Valid until a slice is asked for after the KB changed.
+ */
+const RelevanceSlice& RelevanceSlices::sliceFor(const std::string& goal, const KnowledgeBase& knowledgeBase)
+{
+    if (knowledgeBase.resultVersion != version)
+    {
+        slices.clear();
+        version = knowledgeBase.resultVersion;
+    }
+
+    // Appends that leave resultVersion alone only add rules no slice reaches,
+    // except for a goal that had no rules of its own when it was sliced.
+    std::map<std::string, RelevanceSlice>::iterator slice = slices.find(goal);
+    if (slice != slices.end() && slice->second.statements.empty() && slice->second.version != knowledgeBase.version)
+    {
+        slices.erase(slice);
+        slice = slices.end();
+    }
+    if (slice == slices.end())
+    {
+        slice = slices.insert(std::make_pair(goal, RelevanceSlice(goal, knowledgeBase))).first;
+    }
+    return slice->second;
+}
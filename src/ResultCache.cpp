@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <iostream>
+
+#include "ResultCache.hpp"
+
+
+/**
+ * Constructor | ResultCache | ResultCache
+ *
+ * @param int capacityP: The most results kept. The least recently used one
+ *          is dropped to make room.
+ */
+ResultCache::ResultCache(int capacityP)
+    : capacity(capacityP > 0 ? capacityP : 1), version(0), hitCount(0), missCount(0)
+{
+}
+
+/**
+ * Member Function | ResultCache | makeKey
+ *
+ * Summary: Builds the canonical key of a session: the goal, then every
+ *          instantiated variable the goal can reach as name=value, sorted
+ *          by name. Two sessions with the same key get the same answer.
+ *
+ * @param string goal: The conclusion being solved.
+ * @param const KnowledgeBase& knowledgeBase: The KB the goal is solved in.
+ * @param const vector<VariableListItem>& variableList: The session's facts.
+ *
+ * @return string: The key.
+ */
+std::string ResultCache::makeKey(const std::string& goal, const KnowledgeBase& knowledgeBase,
+                                 const std::vector<VariableListItem>& variableList)
+{
+    std::vector<std::string> relevant;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        checkVersion(knowledgeBase.resultVersion);
+        relevant = relevantVariables(goal, knowledgeBase);
+    }
+
+    // As in instantiatePremiseClause, the first entry of a name is the one used.
+    std::map<std::string, const VariableListItem*> facts;
+    for (int varListIter = 1; varListIter < variableList.size(); varListIter++)
+    {
+        const VariableListItem& variable = variableList.at(varListIter);
+        if (facts.count(variable.name) == 0 &&
+            std::binary_search(relevant.begin(), relevant.end(), variable.name))
+        {
+            facts[variable.name] = &variable;
+        }
+    }
+
+    std::string key = goal + "\n";
+    for (std::map<std::string, const VariableListItem*>::const_iterator factIter = facts.begin(); factIter != facts.end(); ++factIter)
+    {
+        if (factIter->second->instantiated)
+        {
+            key += factIter->first + "=" + factIter->second->value + "\n";
+        }
+    }
+    return key;
+}
+
+/**
+ * Member Function | ResultCache | lookup
+ *
+ * @param unsigned long long knowledgeBaseVersion: resultVersion of the caller's KB.
+ * @param string key: From makeKey.
+ * @param Result& result: Receives the cached result on a hit.
+ *
+ * @return bool: true on a hit.
+ */
+bool ResultCache::lookup(unsigned long long knowledgeBaseVersion, const std::string& key, Result& result)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    checkVersion(knowledgeBaseVersion);
+
+    std::unordered_map<std::string, EntryList::iterator>::iterator entry = index.find(key);
+    if (entry == index.end())
+    {
+        missCount++;
+        return false;
+    }
+
+    // Move to the front of the LRU list.
+    entries.splice(entries.begin(), entries, entry->second);
+    result = entry->second->second;
+    hitCount++;
+    return true;
+}
+
+/**
+ * Member Function | ResultCache | store
+ *
+ * @param unsigned long long knowledgeBaseVersion: resultVersion of the KB
+ *          the result was computed with.
+ * @param string key: From makeKey.
+ * @param const Result& result: The result to keep.
+ */
+void ResultCache::store(unsigned long long knowledgeBaseVersion, const std::string& key, const Result& result)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    checkVersion(knowledgeBaseVersion);
+
+    std::unordered_map<std::string, EntryList::iterator>::iterator entry = index.find(key);
+    if (entry != index.end())
+    {
+        entry->second->second = result;
+        entries.splice(entries.begin(), entries, entry->second);
+        return;
+    }
+
+    entries.push_front(std::make_pair(key, result));
+    index[key] = entries.begin();
+
+    if (entries.size() > capacity)
+    {
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+}
+
+/**
+ * Member Function | ResultCache | displayStatistics
+ *
+ * Summary: Prints hits, misses and the number of entries held.
+ */
+void ResultCache::displayStatistics() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    std::cout << "Result cache: " << hitCount << " hit(s), " << missCount << " miss(es), "
+              << entries.size() << " of " << capacity << " entries used." << std::endl;
+}
+
+/**
+ * Member Function | ResultCache | checkVersion
+ *
+ * Summary: Drops every entry if the knowledge base changed. Caller holds the
+ *          lock.
+ */
+void ResultCache::checkVersion(unsigned long long knowledgeBaseVersion)
+{
+    if (knowledgeBaseVersion != version)
+    {
+        entries.clear();
+        index.clear();
+        relevantByGoal.clear();
+        version = knowledgeBaseVersion;
+    }
+}
+
+/**
+ * Member Function | ResultCache | relevantVariables
+ *
+ * Summary: Every variable named in a premise of a statement the goal can
+ *          reach, sorted. Computed once per goal and KB version. Caller holds
+ *          the lock.
+ */
+const std::vector<std::string>& ResultCache::relevantVariables(const std::string& goal, const KnowledgeBase& knowledgeBase)
+{
+    std::map<std::string, std::vector<std::string> >::const_iterator known = relevantByGoal.find(goal);
+    if (known != relevantByGoal.end())
+    {
+        return known->second;
+    }
+
+    std::vector<std::string>& relevant = relevantByGoal[goal];
+    relevant = knowledgeBase.premiseNamesReachableFrom(goal);
+    return relevant;
+}
@@ -0,0 +1,278 @@
+#include "RuleBytecode.hpp"
+#include "RuleStrata.hpp"
+
+namespace
+{
+    // The rules of a goal asked with DONTCARE are keyed by the name alone.
+    std::string conclusionKey(const std::string& name, const std::string& value)
+    {
+        return (value == "DONTCARE") ? name : name + '\x1f' + value;
+    }
+}
+
+
+/**
+ * Member Function | RuleBytecode | build
+ *
+ * Summary: Compiles the knowledge base. The goal procedures come first, in
+ *          the order their names are first concluded; the procedure of each
+ *          name = value a premise proves is added when first used, and its
+ *          code follows the code of the ones before it.
+ *
+ * @param KnowledgeBase knowledgeBase: The loaded KB.
+ */
+void RuleBytecode::build(const KnowledgeBase& knowledgeBase)
+{
+    code.clear();
+    procedures.clear();
+    registerNames.clear();
+    rulesByConclusion.clear();
+    procedureIds.clear();
+    registerIds.clear();
+    valueIds.clear();
+
+    RuleStrata ruleStrata;
+    ruleStrata.build(knowledgeBase);
+    isAcyclic = ruleStrata.isAcyclic;
+    version = knowledgeBase.version;
+
+    for (int statementIter = 1; statementIter < knowledgeBase.kBase.size(); statementIter++)
+    {
+        const ClauseItem& conclusion = knowledgeBase.kBase.at(statementIter).conclusion;
+        rulesByConclusion[conclusion.name].push_back(statementIter);
+        rulesByConclusion[conclusionKey(conclusion.name, conclusion.value)].push_back(statementIter);
+    }
+    for (int statementIter = 1; statementIter < knowledgeBase.kBase.size(); statementIter++)
+    {
+        addProcedure(ClauseItem(knowledgeBase.kBase.at(statementIter).conclusion.name, "DONTCARE", STRING));
+    }
+
+    for (int procedureIter = 0; procedureIter < procedures.size(); procedureIter++)
+    {
+        emitProcedure(procedureIter, knowledgeBase);
+    }
+    isBuilt = true;
+}
+
+/**
+ * Member Function | RuleBytecode | findProcedure
+ *
+ * @param string name: A conclusion name.
+ * @param string value: A value, or DONTCARE for the goal procedure.
+ *
+ * @return int: The procedure, or -1 if nothing was compiled for it.
+ */
+int RuleBytecode::findProcedure(const std::string& name, const std::string& value) const
+{
+    std::unordered_map<std::string, int>::const_iterator found = procedureIds.find(conclusionKey(name, value));
+    return (found != procedureIds.end()) ? found->second : -1;
+}
+
+/**
+ * Member Function | RuleBytecode | findValue
+ *
+ * @param string value: The value of a variable.
+ *
+ * @return int: Its number, or 0 if no premise tests it.
+ */
+int RuleBytecode::findValue(const std::string& value) const
+{
+    std::unordered_map<std::string, int>::const_iterator found = valueIds.find(value);
+    return (found != valueIds.end()) ? found->second : 0;
+}
+
+/**
+ * Member Function | RuleBytecode | addProcedure
+ *
+ * @param ClauseItem conclusion: What the procedure proves, as the premise
+ *          that first asked for it.
+ *
+ * @return int: The procedure; its code is emitted by build.
+ */
+int RuleBytecode::addProcedure(const ClauseItem& conclusion)
+{
+    std::string key = conclusionKey(conclusion.name, conclusion.value);
+    std::unordered_map<std::string, int>::const_iterator found = procedureIds.find(key);
+    if (found != procedureIds.end())
+    {
+        return found->second;
+    }
+
+    Procedure procedure;
+    procedure.conclusion = conclusion;
+    procedure.start = -1;
+    procedures.push_back(procedure);
+    procedureIds[key] = procedures.size() - 1;
+    return procedures.size() - 1;
+}
+
+/**
+ * Member Function | RuleBytecode | addRegister
+ *
+ * @param string name: A variable tested by a premise.
+ *
+ * @return int: Its register.
+ */
+int RuleBytecode::addRegister(const std::string& name)
+{
+    std::unordered_map<std::string, int>::const_iterator found = registerIds.find(name);
+    if (found != registerIds.end())
+    {
+        return found->second;
+    }
+
+    registerNames.push_back(name);
+    registerIds[name] = registerNames.size() - 1;
+    return registerNames.size() - 1;
+}
+
+/**
+ * Member Function | RuleBytecode | addValue
+ *
+ * @param string value: A value tested by a premise.
+ *
+ * @return int: Its number, from 1.
+ */
+int RuleBytecode::addValue(const std::string& value)
+{
+    std::unordered_map<std::string, int>::const_iterator found = valueIds.find(value);
+    if (found != valueIds.end())
+    {
+        return found->second;
+    }
+
+    int id = valueIds.size() + 1;
+    valueIds[value] = id;
+    return id;
+}
+
+/**
+ * Member Function | RuleBytecode | emitProcedure
+ *
+ * Summary: Emits the rules concluding a procedure's name = value, in KB
+ *          order. A premise that fails jumps to the next rule; the last
+ *          rule fails into FAILED.
+ *
+ * @param int procedure: The procedure.
+ * @param KnowledgeBase knowledgeBase: The KB being compiled.
+ */
+void RuleBytecode::emitProcedure(int procedure, const KnowledgeBase& knowledgeBase)
+{
+    procedures.at(procedure).start = code.size();
+
+    const ClauseItem& conclusion = procedures.at(procedure).conclusion;
+    std::unordered_map<std::string, std::vector<int> >::const_iterator rules =
+        rulesByConclusion.find(conclusionKey(conclusion.name, conclusion.value));
+    for (int ruleIter = 0; rules != rulesByConclusion.end() && ruleIter < rules->second.size(); ruleIter++)
+    {
+        int statement = rules->second.at(ruleIter);
+        const std::vector<ClauseItem>& premiseList = knowledgeBase.kBase.at(statement).premiseList;
+
+        std::vector<int> failures;
+        for (int premiseIter = 1; premiseIter < premiseList.size(); premiseIter++)
+        {
+            const ClauseItem& premise = premiseList.at(premiseIter);
+            if (premise.type == EXPRESSION)
+                emitNode(knowledgeBase.expressions.find(premise.name), false, failures, knowledgeBase);
+            else
+                emitTest(premise, false, false, failures);
+        }
+
+        Instruction proven = { PROVEN, 0, statement, 0, -1 };
+        code.push_back(proven);
+        patch(failures, code.size());
+    }
+
+    Instruction failed = { FAILED, 0, procedure, 0, -1 };
+    code.push_back(failed);
+}
+
+/**
+ * Member Function | RuleBytecode | emitNode
+ *
+ * Summary: Emits an ExpressionPool node as tests that jump out as soon as
+ *          the node is known to be jumpIf, and fall through when it is not.
+ *          An AND is false, and an OR true, at the first operand that is.
+ *          Node 0, which a malformed premise compiles to, is a test of a
+ *          variable with no name, so it never holds, as in BackChain.
+ *
+ * @param int node: The node.
+ * @param bool jumpIf: The outcome that jumps.
+ * @param vector<int>& exits: Receives the jumps out, to be patched.
+ * @param KnowledgeBase knowledgeBase: The KB being compiled.
+ */
+void RuleBytecode::emitNode(int node, bool jumpIf, std::vector<int>& exits, const KnowledgeBase& knowledgeBase)
+{
+    const ExpressionPool::Node& expression = knowledgeBase.expressions.node(node);
+    if (expression.kind == ExpressionPool::LEAF)
+    {
+        emitTest(expression.clause, expression.isNegated, jumpIf, exits);
+        return;
+    }
+
+    bool decidingOutcome = (expression.kind == ExpressionPool::OR);
+    if (jumpIf == decidingOutcome)
+    {
+        for (int operandIter = 0; operandIter < expression.operands.size(); operandIter++)
+        {
+            emitNode(expression.operands.at(operandIter), jumpIf, exits, knowledgeBase);
+        }
+        return;
+    }
+
+    // Jumps out only if no operand decides the group, so the group is the
+    // outcome of its last operand.
+    std::vector<int> decided;
+    for (int operandIter = 0; operandIter + 1 < expression.operands.size(); operandIter++)
+    {
+        emitNode(expression.operands.at(operandIter), decidingOutcome, decided, knowledgeBase);
+    }
+    emitNode(expression.operands.back(), jumpIf, exits, knowledgeBase);
+    patch(decided, code.size());
+}
+
+/**
+ * Member Function | RuleBytecode | emitTest
+ *
+ * Summary: Emits one test. A name some rule concludes is proven, anything
+ *          else is a variable read from its register, as BackChain decides
+ *          between findValidConclusionInStatements and
+ *          instantiatePremiseClause.
+ *
+ * @param ClauseItem test: The name and value tested.
+ * @param bool isNegated: Whether the test is negated.
+ * @param bool jumpIf: The outcome that jumps.
+ * @param vector<int>& exits: Receives the jump, to be patched.
+ */
+void RuleBytecode::emitTest(const ClauseItem& test, bool isNegated, bool jumpIf, std::vector<int>& exits)
+{
+    Instruction instruction = { TEST, jumpIf, 0, 0, -1 };
+    if (rulesByConclusion.count(test.name) > 0)
+    {
+        instruction.opcode = isNegated ? PROVE_NOT : PROVE;
+        instruction.operand = addProcedure(test);
+    }
+    else
+    {
+        instruction.opcode = isNegated ? TEST_NOT : TEST;
+        instruction.operand = addRegister(test.name);
+        instruction.value = addValue(test.value);
+    }
+
+    exits.push_back(code.size());
+    code.push_back(instruction);
+}
+
+/**
+ * Member Function | RuleBytecode | patch
+ *
+ * @param vector<int> exits: Jumps emitted before their target was known.
+ * @param int target: Where they go.
+ */
+void RuleBytecode::patch(const std::vector<int>& exits, int target)
+{
+    for (int exitIter = 0; exitIter < exits.size(); exitIter++)
+    {
+        code.at(exits.at(exitIter)).target = target;
+    }
+}
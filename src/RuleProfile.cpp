@@ -0,0 +1,376 @@
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#include "RuleProfile.hpp"
+
+#define RULE_PROFILE_HEADER "# rule profile v1"
+
+// Premises evaluated fewer times than this are too noisy to reorder by.
+#define RULE_PROFILE_MIN_EVALUATIONS 20
+
+
+/**
+ * Member Function | RuleProfile | load
+ *
+ * Summary: Reads a stats file written by save. Lines are tab separated:
+ *          R, tries, successes, rule key for a rule, then one
+ *          P, evaluations, failures, prompts, premise, rule key line per
+ *          premise.
+ *
+ * @param string fileName: The stats file.
+ *
+ * @return bool: False if there is no stats file yet.
+ */
+bool RuleProfile::load(const std::string& fileName)
+{
+    std::ifstream profileFile(fileName.c_str());
+    std::string profileLine;
+
+    if (!profileFile)
+    {
+        return false;
+    }
+    if (!getline(profileFile, profileLine) || profileLine.find(RULE_PROFILE_HEADER) != 0)
+    {
+        throw std::runtime_error("Error reading rule profile " + fileName + ".");
+    }
+
+    profile.clear();
+    while (getline(profileFile, profileLine))
+    {
+        std::vector<std::string> fields;
+        int fieldStart = 0;
+        int tabLocation = 0;
+        while ((tabLocation = profileLine.find('\t', fieldStart)) != -1)
+        {
+            fields.push_back(profileLine.substr(fieldStart, tabLocation - fieldStart));
+            fieldStart = tabLocation + 1;
+        }
+        fields.push_back(profileLine.substr(fieldStart));
+
+        if (fields.size() == 4 && fields.at(0) == "R")
+        {
+            RuleStats& rule = profile[fields.at(3)];
+            rule.tries = atol(fields.at(1).c_str());
+            rule.successes = atol(fields.at(2).c_str());
+        }
+        else if (fields.size() == 6 && fields.at(0) == "P")
+        {
+            PremiseStats& premise = profile[fields.at(5)].premises[fields.at(4)];
+            premise.evaluations = atol(fields.at(1).c_str());
+            premise.failures = atol(fields.at(2).c_str());
+            premise.prompts = atol(fields.at(3).c_str());
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Member Function | RuleProfile | save
+ *
+ * Summary: Adds the counters of this run to the profile and writes it out.
+ *
+ * @param string fileName: The stats file.
+ * @param const KnowledgeBase& knowledgeBase: The KB the counters index.
+ */
+void RuleProfile::save(const std::string& fileName, const KnowledgeBase& knowledgeBase)
+{
+    for (int statementIter = 1; statementIter < sessionStats.size() && statementIter < knowledgeBase.kBase.size(); statementIter++)
+    {
+        const SessionStats& session = sessionStats.at(statementIter);
+        if (session.tries == 0)
+        {
+            continue;
+        }
+
+        const Statement& statement = knowledgeBase.kBase.at(statementIter);
+        RuleStats& rule = profile[ruleKey(statement)];
+        rule.tries += session.tries;
+        rule.successes += session.successes;
+        for (int premiseIter = 1; premiseIter < session.premises.size() && premiseIter < statement.premiseList.size(); premiseIter++)
+        {
+            const ClauseItem& clause = statement.premiseList.at(premiseIter);
+            PremiseStats& premise = rule.premises[clause.name + " = " + clause.value];
+            premise.evaluations += session.premises.at(premiseIter).evaluations;
+            premise.failures += session.premises.at(premiseIter).failures;
+            premise.prompts += session.premises.at(premiseIter).prompts;
+        }
+    }
+    sessionStats.clear();
+
+    std::ofstream profileFile(fileName.c_str());
+    if (!profileFile)
+    {
+        throw std::runtime_error("Error writing rule profile " + fileName + ".");
+    }
+
+    profileFile << RULE_PROFILE_HEADER << "\n";
+    for (std::map<std::string, RuleStats>::const_iterator ruleIter = profile.begin(); ruleIter != profile.end(); ++ruleIter)
+    {
+        profileFile << "R\t" << ruleIter->second.tries << "\t" << ruleIter->second.successes << "\t" << ruleIter->first << "\n";
+        for (std::map<std::string, PremiseStats>::const_iterator premiseIter = ruleIter->second.premises.begin();
+             premiseIter != ruleIter->second.premises.end(); ++premiseIter)
+        {
+            profileFile << "P\t" << premiseIter->second.evaluations << "\t" << premiseIter->second.failures << "\t"
+                        << premiseIter->second.prompts << "\t" << premiseIter->first << "\t" << ruleIter->first << "\n";
+        }
+    }
+}
+
+/**
+ * Member Function | RuleProfile | reorder
+ *
+ * Summary: Sorts the premises on variables of every statement by the
+ *          questions they ask per failure, lowest first, and the statements
+ *          that prove the same conclusion name and value by success rate,
+ *          highest first. Both sorts are stable. A statement keeps its
+ *          premise order unless all of those premises have enough
+ *          statistics, and rules never tried rank as
+ *          even odds, so an empty profile leaves the KB as it is. Only
+ *          statements with the same conclusion swap places, so whichever of
+ *          them fires proves the same thing.
+ *
+ * @param KnowledgeBase& knowledgeBase: The KB to reorder. Its version is not
+ *          updated here.
+ *
+ * @return int: The number of statements that changed.
+ */
+int RuleProfile::reorder(KnowledgeBase& knowledgeBase) const
+{
+    int changedCount = 0;
+    std::map<std::string, std::vector<int> > statementsByConclusion;
+    std::map<std::string, int> premiseUses;
+
+    // An answer settles that premise in every statement that has it, so the
+    // questions it costs are shared between them.
+    for (int statementIter = 1; statementIter < knowledgeBase.kBase.size(); statementIter++)
+    {
+        const std::vector<ClauseItem>& premiseList = knowledgeBase.kBase.at(statementIter).premiseList;
+        for (int premiseIter = 1; premiseIter < premiseList.size(); premiseIter++)
+        {
+            premiseUses[premiseList.at(premiseIter).name]++;
+        }
+    }
+
+    for (int statementIter = 1; statementIter < knowledgeBase.kBase.size(); statementIter++)
+    {
+        Statement& statement = knowledgeBase.kBase.at(statementIter);
+        std::string key = ruleKey(statement);
+
+        // Only premises on variables swap places. A conclusion premise stays
+        // where it is: its proof settles it for every later statement too.
+        // So does an OR/NOT premise, which may test conclusions.
+        std::vector<int> factSlots;
+        std::vector<std::pair<double, int> > factOrder;
+        bool isProfiled = true;
+        for (int premiseIter = 1; (isProfiled && premiseIter < statement.premiseList.size()); premiseIter++)
+        {
+            const ClauseItem& premise = statement.premiseList.at(premiseIter);
+            if (premise.type != EXPRESSION && knowledgeBase.conclusionSet.count(premise.name) == 0)
+            {
+                double score = premiseScore(key, premise);
+                isProfiled = (score >= 0);
+                factSlots.push_back(premiseIter);
+                factOrder.push_back(std::make_pair(score / premiseUses[premise.name], premiseIter));
+            }
+        }
+
+        // Without statistics for every such premise, the KB order is the best guess.
+        if (isProfiled)
+        {
+            std::stable_sort(factOrder.begin(), factOrder.end());
+
+            std::vector<ClauseItem> premiseList = statement.premiseList;
+            bool isChanged = false;
+            for (int slotIter = 0; slotIter < factSlots.size(); slotIter++)
+            {
+                premiseList.at(factSlots.at(slotIter)) = statement.premiseList.at(factOrder.at(slotIter).second);
+                isChanged = isChanged || (factOrder.at(slotIter).second != factSlots.at(slotIter));
+            }
+            if (isChanged)
+            {
+                statement.premiseList = premiseList;
+                changedCount++;
+            }
+        }
+
+        statementsByConclusion[statement.conclusion.name + " = " + statement.conclusion.value].push_back(statementIter);
+    }
+
+    for (std::map<std::string, std::vector<int> >::const_iterator groupIter = statementsByConclusion.begin();
+         groupIter != statementsByConclusion.end(); ++groupIter)
+    {
+        const std::vector<int>& positions = groupIter->second;
+        if (positions.size() < 2)
+        {
+            continue;
+        }
+
+        std::vector<std::pair<double, int> > ruleOrder;
+        for (int positionIter = 0; positionIter < positions.size(); positionIter++)
+        {
+            ruleOrder.push_back(std::make_pair(-successRate(knowledgeBase.kBase.at(positions.at(positionIter))), positionIter));
+        }
+        std::stable_sort(ruleOrder.begin(), ruleOrder.end());
+
+        std::vector<Statement> statements;
+        for (int orderIter = 0; orderIter < ruleOrder.size(); orderIter++)
+        {
+            statements.push_back(knowledgeBase.kBase.at(positions.at(ruleOrder.at(orderIter).second)));
+        }
+        for (int orderIter = 0; orderIter < ruleOrder.size(); orderIter++)
+        {
+            if (ruleOrder.at(orderIter).second != orderIter)
+            {
+                knowledgeBase.kBase.at(positions.at(orderIter)) = statements.at(orderIter);
+                changedCount++;
+            }
+        }
+    }
+
+    return changedCount;
+}
+
+/**
+ * Member Function | RuleProfile | recordTried
+ *
+ * @param int statement: kBase index of a statement whose premises are about
+ *          to be evaluated.
+ */
+void RuleProfile::recordTried(int statement)
+{
+    sessionStatsFor(statement).tries++;
+}
+
+/**
+ * Member Function | RuleProfile | recordFired
+ *
+ * @param int statement: kBase index of a statement whose premises all held.
+ */
+void RuleProfile::recordFired(int statement)
+{
+    sessionStatsFor(statement).successes++;
+}
+
+/**
+ * Member Function | RuleProfile | recordPremise
+ *
+ * @param int statement: kBase index of the statement.
+ * @param int premise: Index of the premise in its premise list.
+ * @param bool isValid: Whether the premise held.
+ * @param int prompts: Questions asked while evaluating it, including those
+ *          of the sub goal when the premise is a conclusion.
+ */
+void RuleProfile::recordPremise(int statement, int premise, bool isValid, int prompts)
+{
+    SessionStats& session = sessionStatsFor(statement);
+    if (session.premises.size() <= premise)
+    {
+        PremiseStats empty = { 0, 0, 0 };
+        session.premises.resize(premise + 1, empty);
+    }
+    session.premises.at(premise).evaluations++;
+    session.premises.at(premise).prompts += prompts;
+    if (!isValid)
+    {
+        session.premises.at(premise).failures++;
+    }
+}
+
+/**
+ * Static Function | RuleProfile | ruleKey
+ *
+ * Summary: Identifies a rule independent of its line and premise order:
+ *          the conclusion, then the premises sorted, as name = value.
+ *
+ * @param const Statement& statement: The rule.
+ *
+ * @return string: The key.
+ */
+std::string RuleProfile::ruleKey(const Statement& statement)
+{
+    std::vector<std::string> premises;
+    for (int premiseIter = 1; premiseIter < statement.premiseList.size(); premiseIter++)
+    {
+        premises.push_back(statement.premiseList.at(premiseIter).name + " = " + statement.premiseList.at(premiseIter).value);
+    }
+    std::sort(premises.begin(), premises.end());
+
+    std::string key = statement.conclusion.name + " = " + statement.conclusion.value + " <-";
+    for (int premiseIter = 0; premiseIter < premises.size(); premiseIter++)
+    {
+        key += (premiseIter > 0 ? " ^ " : " ") + premises.at(premiseIter);
+    }
+    return key;
+}
+
+/**
+ * Member Function | RuleProfile | sessionStatsFor
+ *
+ * @param int statement: kBase index.
+ *
+ * @return SessionStats&: This run's counters for the statement.
+ */
+RuleProfile::SessionStats& RuleProfile::sessionStatsFor(int statement)
+{
+    if (sessionStats.size() <= statement)
+    {
+        SessionStats empty;
+        empty.tries = 0;
+        empty.successes = 0;
+        sessionStats.resize(statement + 1, empty);
+    }
+    return sessionStats.at(statement);
+}
+
+/**
+ * Member Function | RuleProfile | successRate
+ *
+ * Summary: Successes over tries with one imagined success and one imagined
+ *          failure added, so a rule never tried scores one half.
+ */
+double RuleProfile::successRate(const Statement& statement) const
+{
+    std::map<std::string, RuleStats>::const_iterator ruleIter = profile.find(ruleKey(statement));
+    if (ruleIter == profile.end())
+    {
+        return 0.5;
+    }
+    return (ruleIter->second.successes + 1.0) / (ruleIter->second.tries + 2.0);
+}
+
+/**
+ * Member Function | RuleProfile | premiseScore
+ *
+ * Summary: Expected questions asked per failure of a premise. Evaluating
+ *          premises in increasing score order asks the fewest questions on
+ *          average before a statement that is going to fail does. Both the
+ *          question count and the failure rate are smoothed as in
+ *          successRate.
+ *
+ * @return double: The score, or -1 if the premise was not evaluated often
+ *          enough to judge.
+ */
+double RuleProfile::premiseScore(const std::string& key, const ClauseItem& premise) const
+{
+    std::map<std::string, RuleStats>::const_iterator ruleIter = profile.find(key);
+    if (ruleIter == profile.end())
+    {
+        return -1.0;
+    }
+
+    std::map<std::string, PremiseStats>::const_iterator premiseIter = ruleIter->second.premises.find(premise.name + " = " + premise.value);
+    if (premiseIter == ruleIter->second.premises.end() || premiseIter->second.evaluations < RULE_PROFILE_MIN_EVALUATIONS)
+    {
+        return -1.0;
+    }
+
+    const PremiseStats& stats = premiseIter->second;
+    double questions = (stats.prompts + 0.5) / (stats.evaluations + 1.0);
+    double failureRate = (stats.failures + 1.0) / (stats.evaluations + 2.0);
+    return questions / failureRate;
+}
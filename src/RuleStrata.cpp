@@ -0,0 +1,102 @@
+#include <algorithm>
+
+#include "RuleStrata.hpp"
+
+
+/**
+ * Member Function | RuleStrata | build
+ *
+ * Summary: Levels every rule of the knowledge base. Called once the KB is
+ *          loaded, and again whenever its version changes.
+ *
+ * @param KnowledgeBase knowledgeBase: The loaded KB.
+ */
+void RuleStrata::build(const KnowledgeBase& knowledgeBase)
+{
+    levels.clear();
+    rulesByConclusion.clear();
+    conclusionLevel.clear();
+    isAcyclic = true;
+    version = knowledgeBase.version;
+
+    for (int statementIter = 1; statementIter < knowledgeBase.kBase.size(); statementIter++)
+    {
+        rulesByConclusion[knowledgeBase.kBase.at(statementIter).conclusion.name].push_back(statementIter);
+    }
+
+    std::vector<int> ruleLevel(knowledgeBase.kBase.size(), 0);
+    for (int statementIter = 1; isAcyclic && statementIter < knowledgeBase.kBase.size(); statementIter++)
+    {
+        const std::vector<ClauseItem>& premiseList = knowledgeBase.kBase.at(statementIter).premiseList;
+        for (int premiseIter = 1; isAcyclic && premiseIter < premiseList.size(); premiseIter++)
+        {
+            std::vector<ClauseItem> tests = knowledgeBase.premiseTests(premiseList.at(premiseIter));
+            for (int testIter = 0; isAcyclic && testIter < tests.size(); testIter++)
+            {
+                if (rulesByConclusion.count(tests.at(testIter).name) > 0)
+                {
+                    int premiseLevel = levelOfConclusion(tests.at(testIter).name, knowledgeBase);
+                    ruleLevel.at(statementIter) = std::max(ruleLevel.at(statementIter), premiseLevel + 1);
+                }
+            }
+        }
+    }
+
+    if (!isAcyclic)
+    {
+        levels.clear();
+        return;
+    }
+
+    for (int statementIter = 1; statementIter < knowledgeBase.kBase.size(); statementIter++)
+    {
+        if (ruleLevel.at(statementIter) >= levels.size())
+            levels.resize(ruleLevel.at(statementIter) + 1);
+        levels.at(ruleLevel.at(statementIter)).push_back(statementIter);
+    }
+}
+
+/**
+ * Member Function | RuleStrata | levelOfConclusion
+ *
+ * Summary: The level of the highest rule concluding a name, worked out
+ *          depth first and remembered. Reaching a name that is still being
+ *          visited means a cycle, which clears isAcyclic.
+ *
+ * @param string name: A conclusion name.
+ * @param KnowledgeBase knowledgeBase: The loaded KB.
+ *
+ * @return int: The level, meaningless once isAcyclic is false.
+ */
+int RuleStrata::levelOfConclusion(const std::string& name, const KnowledgeBase& knowledgeBase)
+{
+    std::map<std::string, int>::const_iterator known = conclusionLevel.find(name);
+    if (known != conclusionLevel.end())
+    {
+        if (known->second == -1)
+            isAcyclic = false;
+        return known->second;
+    }
+
+    conclusionLevel[name] = -1;
+    int level = 0;
+    const std::vector<int>& rules = rulesByConclusion[name];
+    for (int ruleIter = 0; isAcyclic && ruleIter < rules.size(); ruleIter++)
+    {
+        int ruleLevel = 0;
+        const std::vector<ClauseItem>& premiseList = knowledgeBase.kBase.at(rules.at(ruleIter)).premiseList;
+        for (int premiseIter = 1; isAcyclic && premiseIter < premiseList.size(); premiseIter++)
+        {
+            std::vector<ClauseItem> tests = knowledgeBase.premiseTests(premiseList.at(premiseIter));
+            for (int testIter = 0; isAcyclic && testIter < tests.size(); testIter++)
+            {
+                if (rulesByConclusion.count(tests.at(testIter).name) > 0)
+                    ruleLevel = std::max(ruleLevel, levelOfConclusion(tests.at(testIter).name, knowledgeBase) + 1);
+            }
+        }
+        level = std::max(level, ruleLevel);
+    }
+
+    conclusionLevel[name] = level;
+    return level;
+}
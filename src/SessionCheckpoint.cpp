@@ -0,0 +1,253 @@
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "SessionCheckpoint.hpp"
+#include "BinaryFormat.hpp"
+#include "CertaintyRanking.hpp"
+
+#define CHECKPOINT_MAGIC "VDCP"
+
+namespace
+{
+    // 2 bit answer codes, four variables to a byte.
+    enum AnswerCode
+    {
+        ANSWER_UNKNOWN = 0,
+        ANSWER_NO = 1,
+        ANSWER_YES = 2,
+        ANSWER_OTHER = 3    // the value follows the codes
+    };
+}
+
+
+/**
+ * Static Function | SessionCheckpoint | save
+ *
+ * Summary: Packs the session: the magic, the KB version (8 bytes little
+ *          endian), the variable count, the answer codes, the values that
+ *          are neither a certain y nor a certain n (with their certainty,
+ *          see CertaintyRanking::withCertainty), the proven statements, the intermediate
+ *          conclusions and the goal. Counts and indexes are varints.
+ *
+ * @param const BackChain& backChain: An idle session.
+ *
+ * @return string: The checkpoint, binary.
+ */
+std::string SessionCheckpoint::save(const BackChain& backChain)
+{
+    std::string checkpoint(CHECKPOINT_MAGIC);
+    BinaryFormat::putWord(checkpoint, backChain.ruleSystem.version, 8);
+
+    const std::vector<VariableListItem>& variableList = backChain.variableList;
+    int variableCount = variableList.size() - 1;
+    BinaryFormat::putVarint(checkpoint, variableCount);
+
+    std::string answers((variableCount + 3) / 4, '\0');
+    std::vector<int> otherAnswers;
+    for (int varListIter = 1; varListIter < variableList.size(); varListIter++)
+    {
+        const VariableListItem& variable = variableList.at(varListIter);
+        int code = ANSWER_UNKNOWN;
+        if (variable.instantiated)
+        {
+            if (variable.certainty != 1)
+                code = ANSWER_OTHER;
+            else if (variable.value == "n")
+                code = ANSWER_NO;
+            else if (variable.value == "y")
+                code = ANSWER_YES;
+            else
+                code = ANSWER_OTHER;
+        }
+        if (code == ANSWER_OTHER)
+        {
+            otherAnswers.push_back(varListIter);
+        }
+        answers[(varListIter - 1) / 4] |= (char)(code << (2 * ((varListIter - 1) % 4)));
+    }
+    checkpoint.append(answers);
+    for (int otherIter = 0; otherIter < otherAnswers.size(); otherIter++)
+    {
+        const VariableListItem& variable = variableList.at(otherAnswers.at(otherIter));
+        BinaryFormat::putString(checkpoint, CertaintyRanking::withCertainty(variable.value, variable.certainty));
+    }
+
+    const std::vector<int>& provenStatements = backChain.provenStatements;
+    BinaryFormat::putVarint(checkpoint, provenStatements.size());
+    for (int provenIter = 0; provenIter < provenStatements.size(); provenIter++)
+    {
+        BinaryFormat::putVarint(checkpoint, provenStatements.at(provenIter));
+    }
+
+    // Each intermediate conclusion is the conclusion of a proven statement;
+    // the statement stands for it, or 0 and the clause spelled out if none
+    // matches.
+    const std::vector<VariableListItem>& intermediateConclusionList = backChain.intermediateConclusionList;
+    BinaryFormat::putVarint(checkpoint, intermediateConclusionList.size() - 1);
+    for (int conclusionIter = 1; conclusionIter < intermediateConclusionList.size(); conclusionIter++)
+    {
+        const VariableListItem& conclusion = intermediateConclusionList.at(conclusionIter);
+        int statement = 0;
+        for (int provenIter = 0; (statement == 0 && provenIter < provenStatements.size()); provenIter++)
+        {
+            const ClauseItem& proven = backChain.ruleSystem.kBase.at(provenStatements.at(provenIter)).conclusion;
+            if (proven.name == conclusion.name && proven.value == conclusion.value)
+            {
+                statement = provenStatements.at(provenIter);
+            }
+        }
+        BinaryFormat::putVarint(checkpoint, statement);
+        if (statement == 0)
+        {
+            BinaryFormat::putString(checkpoint, conclusion.name);
+            BinaryFormat::putString(checkpoint, conclusion.value);
+        }
+    }
+
+    BinaryFormat::putString(checkpoint, backChain.lastGoal);
+    BinaryFormat::putVarint(checkpoint, backChain.promptCount);
+    return checkpoint;
+}
+
+/**
+ * Static Function | SessionCheckpoint | restore
+ *
+ * Summary: Replaces the session's state with a checkpoint. The session is
+ *          left reset if the checkpoint is malformed or was taken with
+ *          another KB or variable list.
+ *
+ * @param BackChain& backChain: A loaded session, typically fresh.
+ * @param string checkpoint: As returned by save.
+ *
+ * @return bool: False if the checkpoint could not be used.
+ */
+bool SessionCheckpoint::restore(BackChain& backChain, const std::string& checkpoint)
+{
+    backChain.resetSession();
+
+    BinaryFormat::Reader reader(checkpoint);
+    size_t start;
+    unsigned long long version;
+    if (!reader.getBytes(4, start) || checkpoint.compare(start, 4, CHECKPOINT_MAGIC) != 0 || !reader.getWord(8, version))
+    {
+        return false;
+    }
+
+    std::vector<VariableListItem>& variableList = backChain.variableList;
+    unsigned long long variableCount;
+    if (version != backChain.ruleSystem.version || !reader.getVarint(variableCount) ||
+        variableCount != variableList.size() - 1 || !reader.getBytes((variableCount + 3) / 4, start))
+    {
+        return false;
+    }
+
+    for (int varListIter = 1; varListIter < variableList.size(); varListIter++)
+    {
+        int code = (checkpoint[start + (varListIter - 1) / 4] >> (2 * ((varListIter - 1) % 4))) & 3;
+        VariableListItem& variable = variableList.at(varListIter);
+        variable.instantiated = (code != ANSWER_UNKNOWN);
+        variable.value = (code == ANSWER_NO) ? "n" : (code == ANSWER_YES) ? "y" : "";
+    }
+    for (int varListIter = 1; varListIter < variableList.size(); varListIter++)
+    {
+        VariableListItem& variable = variableList.at(varListIter);
+        if (variable.instantiated && variable.value.empty())
+        {
+            reader.getString(variable.value);
+            CertaintyRanking::splitCertainty(variable.value, variable.certainty);
+        }
+    }
+
+    unsigned long long provenCount;
+    reader.getVarint(provenCount);
+    for (unsigned long long provenIter = 0; (reader.isGood && provenIter < provenCount); provenIter++)
+    {
+        unsigned long long statement;
+        if (reader.getVarint(statement) && statement > 0 && statement < backChain.ruleSystem.kBase.size())
+        {
+            backChain.provenStatements.push_back(statement);
+            backChain.truthMaintenance.justify(statement);
+        }
+        else
+        {
+            reader.isGood = false;
+        }
+    }
+
+    unsigned long long conclusionCount;
+    reader.getVarint(conclusionCount);
+    for (unsigned long long conclusionIter = 0; (reader.isGood && conclusionIter < conclusionCount); conclusionIter++)
+    {
+        unsigned long long statement;
+        ClauseItem conclusion;
+        if (!reader.getVarint(statement) || statement >= backChain.ruleSystem.kBase.size())
+        {
+            reader.isGood = false;
+        }
+        else if (statement > 0)
+        {
+            conclusion = backChain.ruleSystem.kBase.at(statement).conclusion;
+        }
+        else if (reader.getString(conclusion.name) && reader.getString(conclusion.value))
+        {
+            conclusion.type = STRING;
+        }
+
+        if (reader.isGood)
+        {
+            backChain.intermediateConclusionList.push_back(
+                VariableListItem(conclusion.name, true, conclusion.value, conclusion.name + "(y/n)", conclusion.type));
+        }
+    }
+
+    unsigned long long promptCount = 0;
+    reader.getString(backChain.lastGoal);
+    reader.getVarint(promptCount);
+    if (!reader.isGood)
+    {
+        backChain.resetSession();
+        backChain.lastGoal.clear();
+        return false;
+    }
+
+    backChain.promptCount = promptCount;
+    return true;
+}
+
+/**
+ * Static Function | SessionCheckpoint | saveFile
+ *
+ * @param const BackChain& backChain: An idle session.
+ * @param string fileName: Where to park it.
+ */
+void SessionCheckpoint::saveFile(const BackChain& backChain, const std::string& fileName)
+{
+    std::string checkpoint = save(backChain);
+    std::ofstream checkpointFile(fileName.c_str(), std::ios::out | std::ios::binary);
+    if (!checkpointFile || !checkpointFile.write(checkpoint.data(), checkpoint.size()))
+    {
+        throw std::runtime_error("Error writing session checkpoint " + fileName + ".");
+    }
+}
+
+/**
+ * Static Function | SessionCheckpoint | restoreFile
+ *
+ * @param BackChain& backChain: A loaded session.
+ * @param string fileName: A checkpoint written by saveFile.
+ *
+ * @return bool: False if there is no such file or it could not be used.
+ */
+bool SessionCheckpoint::restoreFile(BackChain& backChain, const std::string& fileName)
+{
+    std::ifstream checkpointFile(fileName.c_str(), std::ios::in | std::ios::binary);
+    if (!checkpointFile)
+    {
+        return false;
+    }
+
+    std::stringstream checkpoint;
+    checkpoint << checkpointFile.rdbuf();
+    return restore(backChain, checkpoint.str());
+}
@@ -0,0 +1,135 @@
+#include <sstream>
+#include <stdexcept>
+
+#include "SessionLog.hpp"
+#include "BinaryFormat.hpp"
+
+#define SESSION_LOG_MAGIC "VDSLOG01"
+
+namespace
+{
+    void writeText(std::ostream& out, const std::string& text)
+    {
+        BinaryFormat::writeWord(out, text.size(), 2);
+        out.write(text.data(), text.size());
+    }
+
+    std::string readText(std::istream& in)
+    {
+        std::string text(BinaryFormat::readWord(in, 2), ' ');
+        in.read(&text[0], text.size());
+        return text;
+    }
+}
+
+
+/**
+ * Constructor | SessionLog | SessionLog
+ *
+ * @param string fileNameP: The log to append to; created, with its magic,
+ *          if it does not exist yet.
+ */
+SessionLog::SessionLog(const std::string& fileNameP) : fileName(fileNameP)
+{
+    std::ifstream existing(fileName.c_str(), std::ios::in | std::ios::binary);
+    bool isNew = !existing || existing.peek() == EOF;
+    existing.close();
+
+    logFile.open(fileName.c_str(), std::ios::out | std::ios::app | std::ios::binary);
+    if (!logFile)
+    {
+        throw std::runtime_error("Error writing session log " + fileName + ".");
+    }
+    if (isNew)
+    {
+        logFile.write(SESSION_LOG_MAGIC, 8);
+        logFile.flush();
+    }
+}
+
+/**
+ * Member Function | SessionLog | append
+ *
+ * Summary: Adds a session at the end of the log: its size, the KB version,
+ *          the start time and the event count, then per event its type, time
+ *          into the session, location, name and value, all little endian.
+ *          Safe to call from several threads.
+ *
+ * @param Session session: A finished session.
+ */
+void SessionLog::append(const Session& session)
+{
+    std::ostringstream record;
+    BinaryFormat::writeWord(record, session.version, 8);
+    BinaryFormat::writeWord(record, session.startMicroseconds, 8);
+    BinaryFormat::writeWord(record, session.events.size(), 4);
+    for (int eventIter = 0; eventIter < session.events.size(); eventIter++)
+    {
+        const Event& event = session.events.at(eventIter);
+        BinaryFormat::writeWord(record, event.type, 1);
+        BinaryFormat::writeWord(record, event.offsetMicroseconds, 8);
+        BinaryFormat::writeWord(record, (unsigned int)event.location, 4);
+        writeText(record, event.name);
+        writeText(record, event.value);
+    }
+
+    std::string body = record.str();
+    std::ostringstream sized;
+    BinaryFormat::writeWord(sized, body.size(), 4);
+    sized << body;
+
+    // One flush of the whole record, so appends never interleave.
+    std::lock_guard<std::mutex> guard(lock);
+    std::string bytes = sized.str();
+    logFile.write(bytes.data(), bytes.size());
+    logFile.flush();
+}
+
+/**
+ * Static Function | SessionLog | read
+ *
+ * @param string fileName: A log written by append.
+ *
+ * @return vector<Session>: Its sessions, in the order they were appended.
+ */
+std::vector<SessionLog::Session> SessionLog::read(const std::string& fileName)
+{
+    std::ifstream logFile(fileName.c_str(), std::ios::in | std::ios::binary);
+    char magic[8];
+    if (!logFile || !logFile.read(magic, 8) || std::string(magic, 8) != SESSION_LOG_MAGIC)
+    {
+        throw std::runtime_error("Error reading session log " + fileName + ".");
+    }
+
+    std::vector<Session> sessions;
+    while (logFile.peek() != EOF)
+    {
+        std::string bytes(BinaryFormat::readWord(logFile, 4), ' ');
+        if (!logFile.read(&bytes[0], bytes.size()))
+        {
+            break;
+        }
+
+        std::istringstream record(bytes);
+        Session session;
+        session.version = BinaryFormat::readWord(record, 8);
+        session.startMicroseconds = BinaryFormat::readWord(record, 8);
+        unsigned int eventCount = BinaryFormat::readWord(record, 4);
+        for (unsigned int eventIter = 0; (record && eventIter < eventCount); eventIter++)
+        {
+            Event event;
+            event.type = (EventType)BinaryFormat::readWord(record, 1);
+            event.offsetMicroseconds = BinaryFormat::readWord(record, 8);
+            event.location = (int)(unsigned int)BinaryFormat::readWord(record, 4);
+            event.name = readText(record);
+            event.value = readText(record);
+            session.events.push_back(event);
+        }
+
+        if (record)
+        {
+            sessions.push_back(session);
+        }
+    }
+    return sessions;
+}
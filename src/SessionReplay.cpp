@@ -0,0 +1,300 @@
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <map>
+#include <thread>
+#include <utility>
+
+#include "SessionReplay.hpp"
+#include "ParallelBackChain.hpp"
+
+#define MAX_DIFFERENCES_SHOWN 20
+
+namespace
+{
+    long long microsecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Answers questions from a captured session, each one no earlier than it
+    // was answered in the capture when pacing, and keeps count of the time
+    // spent waiting for that.
+    class CapturedAnswers : public FactProvider
+    {
+    public:
+        CapturedAnswers(const SessionLog::Session& session, double paceP)
+            : pace(paceP), start(std::chrono::steady_clock::now())
+        {
+            for (int eventIter = 0; eventIter < session.events.size(); eventIter++)
+            {
+                const SessionLog::Event& event = session.events.at(eventIter);
+                if (event.type == SessionLog::FACT_ASKED)
+                    answers[event.name].push_back(std::make_pair(event.value, event.offsetMicroseconds));
+            }
+        }
+
+        bool provideFact(const VariableListItem& variable, std::string& value)
+        {
+            std::map<std::string, std::deque<std::pair<std::string, long long> > >::iterator answer = answers.find(variable.name);
+            if (answer == answers.end() || answer->second.empty())
+            {
+                return false;
+            }
+
+            waitUntil(answer->second.front().second);
+            value = answer->second.front().first;
+            answer->second.pop_front();
+            return true;
+        }
+
+        void waitUntil(long long offsetMicroseconds)
+        {
+            if (pace <= 0)
+            {
+                return;
+            }
+
+            std::chrono::steady_clock::time_point due = start + std::chrono::microseconds((long long)(offsetMicroseconds / pace));
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            if (due > now)
+            {
+                std::this_thread::sleep_until(due);
+                waitedMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>(due - now).count();
+            }
+        }
+
+        // The answers to each variable, in the order they were given.
+        std::map<std::string, std::deque<std::pair<std::string, long long> > > answers;
+        long long waitedMicroseconds = 0;
+
+    private:
+        double pace;
+        std::chrono::steady_clock::time_point start;
+    };
+}
+
+
+/**
+ * Constructor | SessionReplay | SessionReplay
+ *
+ * @param vector<Session> sessionsP: The sessions to replay, from
+ *          SessionLog::read. They must outlive the replay.
+ */
+SessionReplay::SessionReplay(const std::vector<SessionLog::Session>& sessionsP) : sessions(sessionsP)
+{
+}
+
+/**
+ * Member Function | SessionReplay | run
+ *
+ * Summary: Replays every session, spread over the lanes, and gathers the
+ *          timings and the results that differ.
+ *
+ * @param SessionFactory makeSession: Makes each lane's engine; called on the
+ *          lane's thread.
+ * @param unsigned long long version: KnowledgeBase::version of the loaded
+ *          KB. Sessions captured on another KB are only compared on values,
+ *          since rule numbers may not match.
+ * @param int laneCountP: How many sessions to replay at once.
+ * @param double paceP: 0 for full speed, 1 for the recorded pacing, 2 for
+ *          twice as fast, and so on.
+ */
+void SessionReplay::run(const SessionFactory& makeSession, unsigned long long version, int laneCountP, double paceP)
+{
+    pace = paceP;
+    laneCount = std::max(laneCountP, 1);
+    isVersionMismatch = false;
+    firstStartMicroseconds = sessions.empty() ? 0 : sessions.front().startMicroseconds;
+    for (int sessionIter = 0; sessionIter < sessions.size(); sessionIter++)
+    {
+        firstStartMicroseconds = std::min(firstStartMicroseconds, sessions.at(sessionIter).startMicroseconds);
+        isVersionMismatch = isVersionMismatch || sessions.at(sessionIter).version != version;
+    }
+
+    std::vector<Lane> lanes(laneCount);
+    std::atomic<int> nextSession(0);
+    std::vector<std::thread> threads;
+    replayStart = std::chrono::steady_clock::now();
+    for (int laneIter = 0; laneIter < laneCount; laneIter++)
+    {
+        threads.push_back(std::thread([&, laneIter]()
+        {
+            std::unique_ptr<BackChain> engine = makeSession();
+            for (int sessionIter = nextSession++; sessionIter < sessions.size(); sessionIter = nextSession++)
+            {
+                replaySession(*engine, sessionIter, sessions.at(sessionIter).version == version, lanes.at(laneIter));
+            }
+        }));
+    }
+    for (int laneIter = 0; laneIter < threads.size(); laneIter++)
+    {
+        threads.at(laneIter).join();
+    }
+    wallMicroseconds = microsecondsSince(replayStart);
+
+    goalMicroseconds.clear();
+    sessionMicroseconds.clear();
+    differences.clear();
+    for (int laneIter = 0; laneIter < lanes.size(); laneIter++)
+    {
+        const Lane& lane = lanes.at(laneIter);
+        goalMicroseconds.insert(goalMicroseconds.end(), lane.goalMicroseconds.begin(), lane.goalMicroseconds.end());
+        sessionMicroseconds.insert(sessionMicroseconds.end(), lane.sessionMicroseconds.begin(), lane.sessionMicroseconds.end());
+        differences.insert(differences.end(), lane.differences.begin(), lane.differences.end());
+    }
+    std::stable_sort(differences.begin(), differences.end(),
+        [](const Difference& left, const Difference& right) { return left.session < right.session; });
+}
+
+/**
+ * Member Function | SessionReplay | replaySession
+ *
+ * Summary: Replays one session on a lane's engine. The -parallel engine
+ *          cannot ask questions, so it is given every captured answer up
+ *          front.
+ *
+ * @param BackChain& engine: The lane's engine.
+ * @param int sessionIndex: The session, in log order.
+ * @param bool isComparingLocations: Whether rule numbers must match too.
+ * @param Lane& lane: Where the timings and differences go.
+ */
+void SessionReplay::replaySession(BackChain& engine, int sessionIndex, bool isComparingLocations, Lane& lane) const
+{
+    const SessionLog::Session& session = sessions.at(sessionIndex);
+    if (pace > 0)
+    {
+        std::this_thread::sleep_until(replayStart + std::chrono::microseconds(
+            (long long)((session.startMicroseconds - firstStartMicroseconds) / pace)));
+    }
+
+    engine.resetSession();
+    CapturedAnswers capturedAnswers(session, pace);
+    engine.factProvider = &capturedAnswers;
+    std::chrono::steady_clock::time_point sessionStart = std::chrono::steady_clock::now();
+
+    if (dynamic_cast<ParallelBackChain*>(&engine) != nullptr)
+    {
+        std::map<std::string, std::deque<std::pair<std::string, long long> > >::const_iterator answer;
+        for (answer = capturedAnswers.answers.begin(); answer != capturedAnswers.answers.end(); ++answer)
+        {
+            engine.changeFact(answer->first, answer->second.front().first);
+        }
+    }
+
+    for (int eventIter = 0; eventIter < session.events.size(); eventIter++)
+    {
+        const SessionLog::Event& event = session.events.at(eventIter);
+        if (event.type == SessionLog::FACT_GIVEN)
+        {
+            capturedAnswers.waitUntil(event.offsetMicroseconds);
+            engine.changeFact(event.name, event.value);
+        }
+        else if (event.type == SessionLog::GOAL_SOLVED)
+        {
+            std::chrono::steady_clock::time_point goalStart = std::chrono::steady_clock::now();
+            long long waitedBefore = capturedAnswers.waitedMicroseconds;
+            int location = engine.solveGoal(event.name);
+            lane.goalMicroseconds.push_back(microsecondsSince(goalStart) - (capturedAnswers.waitedMicroseconds - waitedBefore));
+
+            std::string value = (location > 0) ? engine.ruleSystem.kBase.at(location).conclusion.value : "";
+            if ((location > 0) != (event.location > 0) || value != event.value || (isComparingLocations && location != event.location))
+            {
+                Difference difference;
+                difference.session = sessionIndex + 1;
+                difference.goal = event.name;
+                difference.captured = describe(event.location, event.value);
+                difference.replayed = describe(location, value);
+                lane.differences.push_back(difference);
+            }
+        }
+    }
+
+    lane.sessionMicroseconds.push_back(microsecondsSince(sessionStart));
+    engine.factProvider = nullptr;
+}
+
+/**
+ * Member Function | SessionReplay | displayReport
+ *
+ * Summary: Prints the throughput, the latency percentiles of goals (time in
+ *          the engine only, without waiting for paced answers) and of whole
+ *          sessions, and the results that differ from the capture.
+ *
+ * @param ostream& out: Where to print.
+ */
+void SessionReplay::displayReport(std::ostream& out) const
+{
+    double seconds = std::max(wallMicroseconds, 1LL) / 1e6;
+    out << "Replayed " << sessions.size() << " session(s) with " << goalMicroseconds.size() << " goal(s) on "
+        << laneCount << " lane(s) ";
+    if (pace > 0)
+        out << "at " << pace << "x the recorded pace";
+    else
+        out << "at full speed";
+    out << " in " << seconds << " s: " << sessions.size() / seconds << " sessions/s, "
+        << goalMicroseconds.size() / seconds << " goals/s." << std::endl;
+
+    displayPercentiles("Goal latency (microseconds, in the engine)", goalMicroseconds, out);
+    displayPercentiles("Session latency (microseconds)", sessionMicroseconds, out);
+
+    if (isVersionMismatch)
+        out << "WARNING! Some sessions were captured with a different knowledge base; only their values are compared." << std::endl;
+
+    if (differences.empty())
+    {
+        out << "Every result matches the capture." << std::endl;
+        return;
+    }
+
+    out << differences.size() << " result(s) differ from the capture:" << std::endl;
+    for (int differenceIter = 0; differenceIter < differences.size() && differenceIter < MAX_DIFFERENCES_SHOWN; differenceIter++)
+    {
+        const Difference& difference = differences.at(differenceIter);
+        out << "  session " << difference.session << ", " << difference.goal << ": captured " << difference.captured
+            << ", replayed " << difference.replayed << std::endl;
+    }
+    if (differences.size() > MAX_DIFFERENCES_SHOWN)
+        out << "  ... and " << differences.size() - MAX_DIFFERENCES_SHOWN << " more" << std::endl;
+}
+
+/**
+ * Static Function | SessionReplay | describe
+ *
+ * @param int location: As returned by solveGoal.
+ * @param string value: The value proven, if any.
+ *
+ * @return string: The result in words.
+ */
+std::string SessionReplay::describe(int location, const std::string& value)
+{
+    if (location > 0)
+        return value + " (rule " + std::to_string(location) + ")";
+    return (location == -1) ? "inconclusive" : "not a conclusion";
+}
+
+/**
+ * Static Function | SessionReplay | displayPercentiles
+ *
+ * @param string label: What was measured.
+ * @param vector<long long> samples: The measurements.
+ * @param ostream& out: Where to print.
+ */
+void SessionReplay::displayPercentiles(const std::string& label, std::vector<long long> samples, std::ostream& out)
+{
+    if (samples.empty())
+    {
+        return;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    const double percentiles[] = { 0.5, 0.9, 0.99 };
+    out << label << ":";
+    for (int percentileIter = 0; percentileIter < 3; percentileIter++)
+    {
+        // Nearest rank.
+        int rank = std::max(1, (int)(percentiles[percentileIter] * samples.size() + 0.999999));
+        out << " p" << (int)(percentiles[percentileIter] * 100) << " " << samples.at(rank - 1);
+    }
+    out << " max " << samples.back() << std::endl;
+}
@@ -0,0 +1,780 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+#ifndef _WIN32
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "ShardCluster.hpp"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace
+{
+    std::vector<std::string> splitFields(const std::string& message)
+    {
+        std::vector<std::string> fields;
+        size_t start = 0;
+        size_t tab = message.find('\t');
+        while (tab != std::string::npos)
+        {
+            fields.push_back(message.substr(start, tab - start));
+            start = tab + 1;
+            tab = message.find('\t', start);
+        }
+        fields.push_back(message.substr(start));
+        return fields;
+    }
+
+    // Writes a whole message; false once the other end is gone.
+    bool writeMessage(int socket, const std::string& message)
+    {
+#ifndef _WIN32
+        size_t written = 0;
+        while (written < message.size())
+        {
+            ssize_t count = ::send(socket, message.data() + written, message.size() - written, MSG_NOSIGNAL);
+            if (count < 0 && errno == EINTR)
+                continue;
+            if (count <= 0)
+                return false;
+            written += count;
+        }
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // Appends what arrived to buffer; false at end of stream.
+    bool readSome(int socket, std::string& buffer)
+    {
+#ifndef _WIN32
+        char chunk[65536];
+        ssize_t count;
+        do
+        {
+            count = ::read(socket, chunk, sizeof(chunk));
+        } while (count < 0 && errno == EINTR);
+        if (count <= 0)
+            return false;
+        buffer.append(chunk, count);
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // Takes the next whole line off the front of buffer.
+    bool takeLine(std::string& buffer, std::string& line)
+    {
+        size_t newline = buffer.find('\n');
+        if (newline == std::string::npos)
+            return false;
+        line = buffer.substr(0, newline);
+        buffer.erase(0, newline + 1);
+        return true;
+    }
+
+    // Everything a worker process shares between its sessions.
+    struct WorkerProcess
+    {
+        int socket;
+        std::mutex writeLock;
+        KnowledgeBase knowledgeBase;
+        std::set<std::string> ownedConclusions;
+        std::vector<int> globalStatement;           // by kBase index of this worker
+
+        void send(int session, const std::string& message)
+        {
+            std::lock_guard<std::mutex> guard(writeLock);
+            writeMessage(socket, std::to_string(session) + "\t" + message + "\n");
+        }
+    };
+
+    // The messages for one session in a worker; an empty message means the
+    // coordinator is gone.
+    struct WorkerMailbox
+    {
+        std::mutex lock;
+        std::condition_variable arrived;
+        std::deque<std::string> messages;
+
+        void put(const std::string& message)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            messages.push_back(message);
+            arrived.notify_one();
+        }
+
+        std::string take()
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            arrived.wait(guard, [this]() { return !messages.empty(); });
+            std::string message = messages.front();
+            messages.pop_front();
+            return message;
+        }
+    };
+
+    /**
+     * WorkerSession - One coordinator session's working memory in a worker.
+     * Proves the worker's own conclusions as BackChain does, and asks the
+     * coordinator for answers and for the conclusions of other workers.
+     */
+    class WorkerSession : public BackChain
+    {
+    public:
+        WorkerSession(WorkerProcess& processP, int sessionP, const std::vector<VariableListItem>& variableListP)
+            : BackChain(&processP.knowledgeBase), process(processP), session(sessionP), coordinatorFacts(*this)
+        {
+            variableList = variableListP;
+            intermediateConclusionList.push_back(VariableListItem("Empty", false, "", "This is an error string", STRING));
+            factProvider = &coordinatorFacts;
+        }
+
+        void serve()
+        {
+            try
+            {
+                for (std::string message = mailbox.take(); !message.empty(); message = mailbox.take())
+                {
+                    handle(splitFields(message));
+                }
+            }
+            catch (const std::runtime_error&)
+            {
+                // The coordinator went away mid request.
+            }
+        }
+
+        WorkerMailbox mailbox;
+
+    protected:
+        int findValidConclusionInStatements(std::string conclusionName, int startingIndex, std::string stringToMatch) override
+        {
+            if (ruleSystem.conclusionSet.count(conclusionName) == 0 || process.ownedConclusions.count(conclusionName) > 0)
+            {
+                return BackChain::findValidConclusionInStatements(conclusionName, startingIndex, stringToMatch);
+            }
+
+            // Another worker's conclusion.
+            std::string goal = conclusionName + " = " + stringToMatch;
+            if (remoteProven.count(goal) > 0)
+                return 1;
+            if (isFailedGoal(conclusionName, stringToMatch))
+                return -1;
+
+            process.send(session, "PROVE\t" + conclusionName + "\t" + stringToMatch + "\t" + takeProven());
+            std::vector<std::string> reply = waitForReply();
+            int location = atoi(reply.at(1).c_str());
+            if (location > 0)
+                remoteProven.insert(goal);
+            else if (location == -1)
+                recordFailedGoal(conclusionName, stringToMatch);
+            return location;
+        }
+
+    private:
+        // Answers from the coordinator's working memory.
+        class CoordinatorFacts : public FactProvider
+        {
+        public:
+            explicit CoordinatorFacts(WorkerSession& sessionP) : workerSession(sessionP) {}
+
+            bool provideFact(const VariableListItem& variable, std::string& value)
+            {
+                workerSession.process.send(workerSession.session, "ASK\t" + variable.name);
+                std::vector<std::string> reply = workerSession.waitForReply();
+                value = reply.at(2);
+                return reply.at(1) == "1";
+            }
+
+        private:
+            WorkerSession& workerSession;
+        };
+
+        void handle(const std::vector<std::string>& fields)
+        {
+            if (fields.at(0) == "PROVE")
+            {
+                prove(fields.at(1), fields.at(2));
+            }
+            else if (fields.at(0) == "RESET")
+            {
+                resetSession();
+                remoteProven.clear();
+                shippedCount = 0;
+            }
+        }
+
+        // Requests from the coordinator can arrive while this session waits
+        // for its own reply, when another worker needs one of its
+        // conclusions; they are served on the way.
+        std::vector<std::string> waitForReply()
+        {
+            while (true)
+            {
+                std::string message = mailbox.take();
+                if (message.empty())
+                    throw std::runtime_error("The coordinator closed the connection.");
+
+                std::vector<std::string> fields = splitFields(message);
+                if (fields.at(0) == "RESULT" || fields.at(0) == "VALUE")
+                    return fields;
+                handle(fields);
+            }
+        }
+
+        void prove(const std::string& conclusionName, const std::string& stringToMatch)
+        {
+            const RelevanceSlice* callerSlice = goalSlice;
+            goalSlice = &relevanceSlices.sliceFor(conclusionName, ruleSystem);
+            int location = BackChain::findValidConclusionInStatements(conclusionName, 1, stringToMatch);
+            goalSlice = callerSlice;
+
+            int globalLocation = (location > 0) ? process.globalStatement.at(location) : location;
+            process.send(session, "RESULT\t" + std::to_string(globalLocation) + "\t" + takeProven());
+        }
+
+        // The statements proven since the last message, for the coordinator:
+        // their count, then number, conclusion and premises of each.
+        std::string takeProven()
+        {
+            std::string fields = std::to_string(provenStatements.size() - shippedCount);
+            for (; shippedCount < provenStatements.size(); shippedCount++)
+            {
+                const Statement& statement = ruleSystem.kBase.at(provenStatements.at(shippedCount));
+                fields += "\t" + std::to_string(process.globalStatement.at(provenStatements.at(shippedCount)));
+                fields += "\t" + statement.conclusion.name + "\t" + statement.conclusion.value + "\t" + std::to_string(statement.conclusion.type);
+                fields += "\t" + std::to_string(statement.premiseList.size() - 1);
+                for (int premiseIter = 1; premiseIter < statement.premiseList.size(); premiseIter++)
+                {
+                    const ClauseItem& premise = statement.premiseList.at(premiseIter);
+                    fields += "\t" + premise.name + "\t" + premise.value + "\t" + std::to_string(premise.type);
+                }
+            }
+            return fields;
+        }
+
+        WorkerProcess& process;
+        int session;
+        CoordinatorFacts coordinatorFacts;
+        std::set<std::string> remoteProven;     // other workers' conclusions, as name = value
+        int shippedCount = 0;
+    };
+
+    /**
+     * serveShards - the body of a worker process: loads its shards, then
+     * serves each session on a thread of its own until the coordinator
+     * closes the socket.
+     */
+    int serveShards(int socket, const std::string& directory, const std::set<std::string>& ownedConclusions,
+                    const std::vector<VariableListItem>& variableList)
+    {
+        WorkerProcess process;
+        process.socket = socket;
+        process.ownedConclusions = ownedConclusions;
+
+        KnowledgeShards shards;
+        process.knowledgeBase.kBase.push_back(Statement());
+        shards.loadManifest(directory, process.knowledgeBase);
+        process.globalStatement.push_back(0);
+
+        std::vector<std::pair<std::string, int> > sizes = shards.shardSizes();
+        int firstStatement = 1;
+        for (int shardIter = 0; shardIter < sizes.size(); shardIter++)
+        {
+            if (ownedConclusions.count(sizes.at(shardIter).first) > 0)
+            {
+                shards.ensureLoaded(sizes.at(shardIter).first, process.knowledgeBase);
+                for (int statement = firstStatement; process.globalStatement.size() < process.knowledgeBase.kBase.size(); statement++)
+                {
+                    process.globalStatement.push_back(statement);
+                }
+            }
+            firstStatement += sizes.at(shardIter).second;
+        }
+
+        std::map<int, std::unique_ptr<WorkerSession> > sessions;
+        std::vector<std::thread> sessionThreads;
+        std::string buffer;
+        std::string line;
+        while (readSome(socket, buffer))
+        {
+            while (takeLine(buffer, line))
+            {
+                size_t tab = line.find('\t');
+                int session = atoi(line.substr(0, tab).c_str());
+                std::unique_ptr<WorkerSession>& workerSession = sessions[session];
+                if (!workerSession)
+                {
+                    workerSession.reset(new WorkerSession(process, session, variableList));
+                    sessionThreads.push_back(std::thread(&WorkerSession::serve, workerSession.get()));
+                }
+                workerSession->mailbox.put(line.substr(tab + 1));
+            }
+        }
+
+        for (std::map<int, std::unique_ptr<WorkerSession> >::iterator session = sessions.begin(); session != sessions.end(); ++session)
+        {
+            session->second->mailbox.put("");
+        }
+        for (int threadIter = 0; threadIter < sessionThreads.size(); threadIter++)
+        {
+            sessionThreads.at(threadIter).join();
+        }
+        return EXIT_SUCCESS;
+    }
+}
+
+
+/**
+ * Destructor | ShardCluster | ~ShardCluster
+ *
+ * Summary: Closes the workers' sockets, which ends them, and waits for them.
+ */
+ShardCluster::~ShardCluster()
+{
+#ifndef _WIN32
+    for (int workerIter = 0; workerIter < workers.size(); workerIter++)
+    {
+        shutdown(workers.at(workerIter)->socket, SHUT_WR);
+    }
+    if (router.joinable())
+    {
+        router.join();
+    }
+    for (int workerIter = 0; workerIter < workers.size(); workerIter++)
+    {
+        close(workers.at(workerIter)->socket);
+        waitpid(workers.at(workerIter)->pid, nullptr, 0);
+    }
+#endif
+}
+
+/**
+ * Member Function | ShardCluster | start
+ *
+ * Summary: Shares the shards out between the workers, largest first to the
+ *          worker with the fewest rules so far, and forks the workers. Call
+ *          before any other thread is started.
+ *
+ * @param string directory: Where -partition wrote the shards.
+ * @param int workerCount: How many worker processes to fork.
+ * @param vector<VariableListItem> variableList: The loaded variable list.
+ */
+void ShardCluster::start(const std::string& directory, int workerCount, const std::vector<VariableListItem>& variableList)
+{
+#ifdef _WIN32
+    throw std::runtime_error("Shard workers need fork and Unix sockets.");
+#else
+    KnowledgeBase manifestBase;
+    KnowledgeShards manifest;
+    std::streambuf* console = std::cout.rdbuf(nullptr);
+    manifest.loadManifest(directory, manifestBase);
+    std::cout.rdbuf(console);
+
+    std::vector<std::pair<std::string, int> > sizes = manifest.shardSizes();
+    std::vector<int> bySize(sizes.size());
+    for (int shardIter = 0; shardIter < sizes.size(); shardIter++)
+    {
+        bySize.at(shardIter) = shardIter;
+        totalRules += sizes.at(shardIter).second;
+    }
+    std::stable_sort(bySize.begin(), bySize.end(),
+        [&sizes](int left, int right) { return sizes.at(left).second > sizes.at(right).second; });
+
+    std::vector<int> ruleCounts(workerCount, 0);
+    std::vector<std::set<std::string> > ownedConclusions(workerCount);
+    for (int shardIter = 0; shardIter < bySize.size(); shardIter++)
+    {
+        const std::pair<std::string, int>& shard = sizes.at(bySize.at(shardIter));
+        int worker = std::min_element(ruleCounts.begin(), ruleCounts.end()) - ruleCounts.begin();
+        ruleCounts.at(worker) += shard.second;
+        ownedConclusions.at(worker).insert(shard.first);
+        owners[shard.first] = worker;
+    }
+
+    std::cout.flush();
+    fflush(stdout);
+    for (int workerIter = 0; workerIter < workerCount; workerIter++)
+    {
+        int sockets[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0)
+        {
+            throw std::runtime_error("Could not create a socket for a shard worker.");
+        }
+
+        int pid = fork();
+        if (pid < 0)
+        {
+            throw std::runtime_error("Could not start a shard worker.");
+        }
+        if (pid == 0)
+        {
+            // The worker keeps only its own end, and says nothing.
+            close(sockets[0]);
+            for (int otherIter = 0; otherIter < workers.size(); otherIter++)
+            {
+                close(workers.at(otherIter)->socket);
+            }
+            std::cout.rdbuf(nullptr);
+            int status = EXIT_FAILURE;
+            try
+            {
+                status = serveShards(sockets[1], directory, ownedConclusions.at(workerIter), variableList);
+            }
+            catch (...)
+            {
+            }
+            _exit(status);
+        }
+
+        close(sockets[1]);
+        workers.push_back(std::unique_ptr<Worker>(new Worker()));
+        workers.back()->pid = pid;
+        workers.back()->socket = sockets[0];
+        workers.back()->ruleCount = ruleCounts.at(workerIter);
+        workers.back()->isOpen = true;
+    }
+
+    router = std::thread(&ShardCluster::route, this);
+#endif
+}
+
+/**
+ * Member Function | ShardCluster | ownerOf
+ *
+ * @param string conclusionName: A name.
+ *
+ * @return int: The worker owning the conclusion, or -1 if it is not one.
+ */
+int ShardCluster::ownerOf(const std::string& conclusionName) const
+{
+    std::map<std::string, int>::const_iterator owner = owners.find(conclusionName);
+    return (owner != owners.end()) ? owner->second : -1;
+}
+
+/**
+ * Member Function | ShardCluster | getTotalRules
+ *
+ * @return int: The rules of every shard together.
+ */
+int ShardCluster::getTotalRules() const
+{
+    return totalRules;
+}
+
+/**
+ * Member Function | ShardCluster | getWorkerCount
+ *
+ * @return int: The number of worker processes.
+ */
+int ShardCluster::getWorkerCount() const
+{
+    return workers.size();
+}
+
+/**
+ * Member Function | ShardCluster | displayUsage
+ *
+ * Summary: Prints how the rules are shared out between the workers.
+ *
+ * @param ostream& out: Where to print.
+ */
+void ShardCluster::displayUsage(std::ostream& out) const
+{
+    out << workers.size() << " shard worker(s) holding";
+    for (int workerIter = 0; workerIter < workers.size(); workerIter++)
+    {
+        out << (workerIter > 0 ? "," : "") << " " << workers.at(workerIter)->ruleCount;
+    }
+    out << " of " << totalRules << " rule(s)." << std::endl;
+}
+
+/**
+ * Member Function | ShardCluster | openSession
+ *
+ * @return int: A new session number for send and receive.
+ */
+int ShardCluster::openSession()
+{
+    std::lock_guard<std::mutex> guard(mailLock);
+    int session = ++sessionCount;
+    mailboxes[session];
+    return session;
+}
+
+/**
+ * Member Function | ShardCluster | send
+ *
+ * @param int worker: The worker to send to.
+ * @param int session: The session the message belongs to.
+ * @param string message: Tab separated fields, without a newline.
+ */
+void ShardCluster::send(int worker, int session, const std::string& message)
+{
+    Worker& target = *workers.at(worker);
+    std::lock_guard<std::mutex> guard(target.writeLock);
+    if (!writeMessage(target.socket, std::to_string(session) + "\t" + message + "\n"))
+    {
+        throw std::runtime_error("Shard worker " + std::to_string(worker) + " is not running.");
+    }
+}
+
+/**
+ * Member Function | ShardCluster | receive
+ *
+ * Summary: Waits for the next message to a session.
+ *
+ * @param int session: A session from openSession.
+ *
+ * @return pair<int, string>: The worker it came from, and the message.
+ */
+std::pair<int, std::string> ShardCluster::receive(int session)
+{
+    std::unique_lock<std::mutex> guard(mailLock);
+    Mailbox& mailbox = mailboxes[session];
+    mailbox.arrived.wait(guard, [this, &mailbox]() { return !mailbox.messages.empty() || isStopped; });
+    if (mailbox.messages.empty())
+    {
+        throw std::runtime_error("A shard worker exited.");
+    }
+
+    std::pair<int, std::string> message = mailbox.messages.front();
+    mailbox.messages.pop_front();
+    return message;
+}
+
+/**
+ * Member Function | ShardCluster | route
+ *
+ * Summary: The router thread: reads every worker's socket and hands each
+ *          message to its session, until all the workers have closed theirs.
+ */
+void ShardCluster::route()
+{
+#ifndef _WIN32
+    std::vector<pollfd> sockets(workers.size());
+    int openCount = workers.size();
+    while (openCount > 0)
+    {
+        for (int workerIter = 0; workerIter < workers.size(); workerIter++)
+        {
+            sockets.at(workerIter).fd = workers.at(workerIter)->isOpen ? workers.at(workerIter)->socket : -1;
+            sockets.at(workerIter).events = POLLIN;
+            sockets.at(workerIter).revents = 0;
+        }
+        if (poll(sockets.data(), sockets.size(), -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        for (int workerIter = 0; workerIter < workers.size(); workerIter++)
+        {
+            Worker& worker = *workers.at(workerIter);
+            if (sockets.at(workerIter).revents == 0)
+                continue;
+
+            if (!readSome(worker.socket, worker.readBuffer))
+            {
+                worker.isOpen = false;
+                openCount--;
+
+                // A worker gone while sessions may still need it.
+                std::lock_guard<std::mutex> guard(mailLock);
+                isStopped = true;
+                for (std::map<int, Mailbox>::iterator mailbox = mailboxes.begin(); mailbox != mailboxes.end(); ++mailbox)
+                {
+                    mailbox->second.arrived.notify_all();
+                }
+                continue;
+            }
+
+            std::string line;
+            while (takeLine(worker.readBuffer, line))
+            {
+                size_t tab = line.find('\t');
+                int session = atoi(line.substr(0, tab).c_str());
+
+                std::lock_guard<std::mutex> guard(mailLock);
+                Mailbox& mailbox = mailboxes[session];
+                mailbox.messages.push_back(std::make_pair(workerIter, line.substr(tab + 1)));
+                mailbox.arrived.notify_all();
+            }
+        }
+    }
+#endif
+}
+
+/**
+ * Constructor | ShardSession | ShardSession
+ *
+ * @param ShardCluster& clusterP: The started cluster.
+ * @param KnowledgeBase* proofBase: An empty KB of this session's own; the
+ *          statements workers prove are kept in it at their numbers.
+ * @param vector<VariableListItem> variableListP: The loaded variable list.
+ */
+ShardSession::ShardSession(ShardCluster& clusterP, KnowledgeBase* proofBase, const std::vector<VariableListItem>& variableListP)
+    : BackChain(proofBase), cluster(clusterP), session(clusterP.openSession())
+{
+    // Statements arrive while the engine holds references into kBase, so it
+    // must never reallocate (see KnowledgeShards::loadManifest).
+    ruleSystem.kBase.reserve(cluster.getTotalRules() + 1);
+    ruleSystem.kBase.push_back(Statement());
+    variableList = variableListP;
+    intermediateConclusionList.push_back(VariableListItem("Empty", false, "", "This is an error string", STRING));
+    factProvider = &noFactProvider;
+}
+
+/**
+ * Member Function | ShardSession | resetSession
+ *
+ * Summary: Forgets the session here and in every worker.
+ */
+void ShardSession::resetSession()
+{
+    BackChain::resetSession();
+    for (int workerIter = 0; workerIter < cluster.getWorkerCount(); workerIter++)
+    {
+        cluster.send(workerIter, session, "RESET");
+    }
+}
+
+/**
+ * Member Function | ShardSession | findValidConclusionInStatements
+ *
+ * Summary: Has the owning worker prove a conclusion, serving what it asks
+ *          for in the meantime: answers, and conclusions of other workers,
+ *          which are routed to their owners the same way.
+ *
+ * @param string conclusionName: As for BackChain.
+ * @param int: The starting index, not used; the owner searches all its
+ *          rules.
+ * @param string stringToMatch: As for BackChain.
+ *
+ * @return int location:   As for BackChain, numbered as in the cluster.
+ */
+int ShardSession::findValidConclusionInStatements(std::string conclusionName, int, std::string stringToMatch)
+{
+    int owner = cluster.ownerOf(conclusionName);
+    if (owner < 0)
+    {
+        return 0;
+    }
+
+    if (stringToMatch != "DONTCARE")
+    {
+        int supported = truthMaintenance.findSupport(ClauseItem(conclusionName, stringToMatch, STRING), ruleSystem);
+        if (supported > 0)
+            return supported;
+    }
+    if (isFailedGoal(conclusionName, stringToMatch))
+    {
+        return -1;
+    }
+
+    cluster.send(owner, session, "PROVE\t" + conclusionName + "\t" + stringToMatch);
+    while (true)
+    {
+        std::pair<int, std::string> message = cluster.receive(session);
+        std::vector<std::string> fields = splitFields(message.second);
+
+        if (fields.at(0) == "ASK")
+        {
+            cluster.send(message.first, session, "VALUE\t" + answer(fields.at(1)));
+        }
+        else if (fields.at(0) == "PROVE")
+        {
+            absorbProven(fields, 3);
+            int location = findValidConclusionInStatements(fields.at(1), 1, fields.at(2));
+            if (location > 0)
+                addToIntermediateConclusionList(ClauseItem(fields.at(1), fields.at(2), STRING));
+            cluster.send(message.first, session, "RESULT\t" + std::to_string(location));
+        }
+        else if (fields.at(0) == "RESULT")
+        {
+            absorbProven(fields, 2);
+            int location = atoi(fields.at(1).c_str());
+            if (location == -1)
+                recordFailedGoal(conclusionName, stringToMatch);
+            return location;
+        }
+    }
+}
+
+/**
+ * Member Function | ShardSession | answer
+ *
+ * @param string name: A variable a worker needs.
+ *
+ * @return string: 1 and the value if it is known, else 0 and nothing.
+ */
+std::string ShardSession::answer(const std::string& name)
+{
+    for (int varListIter = 1; varListIter < variableList.size(); varListIter++)
+    {
+        VariableListItem& variable = variableList.at(varListIter);
+        if (variable.name == name)
+        {
+            if (!variable.instantiated)
+            {
+                promptCount++;
+                fetchFact(variable);
+            }
+            return variable.instantiated ? "1\t" + variable.value : std::string("0\t");
+        }
+    }
+    return "0\t";
+}
+
+/**
+ * Member Function | ShardSession | absorbProven
+ *
+ * Summary: Records the statements a worker proved, as listed in a message.
+ *
+ * @param vector<string> fields: The message.
+ * @param int countField: Where the statement count is.
+ */
+void ShardSession::absorbProven(const std::vector<std::string>& fields, int countField)
+{
+    int count = atoi(fields.at(countField).c_str());
+    int field = countField + 1;
+    for (int statementIter = 0; statementIter < count; statementIter++)
+    {
+        int statement = atoi(fields.at(field).c_str());
+        ClauseItem conclusion(fields.at(field + 1), fields.at(field + 2), atoi(fields.at(field + 3).c_str()));
+        int premiseCount = atoi(fields.at(field + 4).c_str());
+        field += 5;
+
+        std::vector<ClauseItem> premiseList(1, ClauseItem());
+        for (int premiseIter = 0; premiseIter < premiseCount; premiseIter++, field += 3)
+        {
+            premiseList.push_back(ClauseItem(fields.at(field), fields.at(field + 1), atoi(fields.at(field + 2).c_str())));
+            if (premiseList.back().type == EXPRESSION)
+            {
+                ruleSystem.expressions.compile(premiseList.back().name);
+            }
+        }
+
+        if (statement >= ruleSystem.kBase.size())
+        {
+            ruleSystem.kBase.resize(statement + 1);
+        }
+        ruleSystem.kBase.at(statement) = Statement(conclusion, premiseList);
+        recordProven(statement);
+    }
+}
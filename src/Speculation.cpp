@@ -0,0 +1,139 @@
+#include "Speculation.hpp"
+#include "IterativeBackChain.hpp"
+#include "InferenceTrace.hpp"
+
+
+/**
+ * Constructor | Speculation | Speculation
+ *
+ * @param BackChain& sessionP: A session about to solve a goal. It must not
+ *          be changed by anyone else until solveGoal returns.
+ */
+Speculation::Speculation(BackChain& sessionP)
+    : session(sessionP),
+      startingConclusions(sessionP.intermediateConclusionList),
+      startingProof(sessionP.provenStatements),
+      startingJustifications(sessionP.truthMaintenance),
+      startingFailedGoals(sessionP.failedGoals)
+{
+}
+
+/**
+ * Member Function | Speculation | solveGoal
+ *
+ * Summary: Solves the goal, asking the user on the console for each value
+ *          it needs, with both answers to every question worked out while
+ *          the question is on screen.
+ *
+ * @param string goal: The conclusion to solve.
+ *
+ * @return int location:   As returned by BackChain::solveGoal, or -1 if the
+ *          user suspended the session.
+ */
+int Speculation::solveGoal(const std::string& goal)
+{
+    Outcome outcome = runProbe(goal, session.variableList);
+    while (!outcome.question.empty())
+    {
+        int variable = VariableListItem::find(session.variableList, outcome.question);
+        std::future<Outcome> ifYes = speculate(goal, variable, "y");
+        std::future<Outcome> ifNo = speculate(goal, variable, "n");
+
+        session.promptCount++;
+        if (!session.askUser(session.variableList.at(variable)))
+        {
+            return -1;
+        }
+
+        // Any other answer is worked out after the fact. The probe that
+        // lost is dropped with its future.
+        const std::string& answer = session.variableList.at(variable).value;
+        if (answer == "y")
+            outcome = ifYes.get();
+        else if (answer == "n")
+            outcome = ifNo.get();
+        else
+            outcome = runProbe(goal, session.variableList);
+    }
+
+    BackChain& probe = *outcome.probe;
+    session.intermediateConclusionList.swap(probe.intermediateConclusionList);
+    session.provenStatements.swap(probe.provenStatements);
+    session.truthMaintenance = probe.truthMaintenance;
+    session.failedGoals.swap(probe.failedGoals);
+
+    // The last probe solved the goal with every answer, as the plain engine
+    // would, so its budget ran out (or not) where the session's would have.
+    session.budget.ruleEvaluations = probe.budget.ruleEvaluations;
+    session.budget.premiseChecks = probe.budget.premiseChecks;
+    if (probe.budget.isStopped())
+    {
+        session.budget.stop(probe.budget.getStopReason());
+    }
+    return outcome.location;
+}
+
+/**
+ * Member Function | Speculation | runProbe
+ *
+ * Summary: Solves the goal on a copy of the session's starting working
+ *          memory with the given answers, up to the first question. Each
+ *          probe has the session's limits and solves from the goal, so it
+ *          stops where the plain engine would.
+ *
+ * @param string goal: The conclusion to solve.
+ * @param vector<VariableListItem> answers: The variable list to solve with.
+ *
+ * @return Outcome: The first question, or the result if none was needed.
+ */
+Speculation::Outcome Speculation::runProbe(const std::string& goal, std::vector<VariableListItem> answers) const
+{
+    InferenceTrace::muteThisThread(true);
+
+    Outcome outcome;
+    const IterativeBackChain* iterativeSession = dynamic_cast<const IterativeBackChain*>(&session);
+    if (iterativeSession != nullptr)
+        outcome.probe.reset(new IterativeBackChain(iterativeSession->maxDepth, &session.ruleSystem));
+    else
+        outcome.probe.reset(new BackChain(&session.ruleSystem));
+
+    BackChain& probe = *outcome.probe;
+    probe.variableList.swap(answers);
+    probe.intermediateConclusionList = startingConclusions;
+    probe.provenStatements = startingProof;
+    probe.truthMaintenance = startingJustifications;
+    probe.failedGoals = startingFailedGoals;
+    // The only settings carried over; see the class comment for the rest.
+    probe.checkKnownFactsFirst = session.checkKnownFactsFirst;
+    probe.budget.limits = session.budget.limits;
+
+    // Stands in for the user: the probe runs out at its first question.
+    FirstQuestion firstQuestion;
+    probe.factProvider = &firstQuestion;
+    outcome.location = probe.solveGoal(goal);
+    outcome.question = firstQuestion.question;
+    probe.factProvider = nullptr;
+
+    InferenceTrace::muteThisThread(false);
+    return outcome;
+}
+
+/**
+ * Member Function | Speculation | speculate
+ *
+ * Summary: Starts a probe, on a thread of its own, for one answer to the
+ *          question on screen.
+ *
+ * @param string goal: The conclusion being solved.
+ * @param int variable: The variable list index of the question.
+ * @param string answer: The answer to assume.
+ *
+ * @return future<Outcome>: Where that answer leads.
+ */
+std::future<Speculation::Outcome> Speculation::speculate(const std::string& goal, int variable, const std::string& answer) const
+{
+    std::vector<VariableListItem> answers(session.variableList);
+    answers.at(variable).value = answer;
+    answers.at(variable).instantiated = true;
+    return std::async(std::launch::async, &Speculation::runProbe, this, goal, answers);
+}
@@ -15,6 +15,7 @@ Statement::Statement()
     conclusion.value = "NULL";
     conclusion.type = STRING;
     premiseList.push_back(ClauseItem());
+    certainty = 1;
 }
 
 
@@ -34,5 +35,6 @@ Statement::Statement(ClauseItem conclusionP, std::vector<ClauseItem>& premiseLis
 {
     conclusion = conclusionP;
     premiseList = premiseListP;
+    certainty = 1;
 }
 
@@ -0,0 +1,287 @@
+#include "ThreadPool.hpp"
+
+namespace
+{
+    // Which pool (if any) the calling thread works for, and its queue index.
+    thread_local const void* currentPool = nullptr;
+    thread_local int currentIndex = -1;
+}
+
+
+/**
+ * Constructor | ThreadPool | ThreadPool
+ *
+ * Summary: Starts the worker threads, each with an empty deque.
+ *
+ * @param int threadCount: Number of workers. Values below 1 start one.
+ */
+ThreadPool::ThreadPool(int threadCount)
+    : queuedCount(0), nextQueue(0), isStopping(false)
+{
+    if (threadCount < 1)
+    {
+        threadCount = 1;
+    }
+
+    for (int queueIter = 0; queueIter < threadCount; queueIter++)
+    {
+        queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+    }
+
+    for (int workerIter = 0; workerIter < threadCount; workerIter++)
+    {
+        workers.push_back(std::thread(&ThreadPool::workerLoop, this, workerIter));
+    }
+}
+
+/**
+ * Destructor | ThreadPool | ~ThreadPool
+ *
+ * Summary: Lets the workers drain what is queued, then joins them.
+ */
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        isStopping = true;
+    }
+    wakeUp.notify_all();
+
+    for (int workerIter = 0; workerIter < workers.size(); workerIter++)
+    {
+        workers.at(workerIter).join();
+    }
+}
+
+/**
+ * Member Function | ThreadPool | submit
+ *
+ * Summary: Queues a task. From a worker of this pool the task goes on that
+ *          worker's own deque; from any other thread the deques are filled
+ *          round robin.
+ *
+ * @param function<void()> task: The work to run.
+ */
+void ThreadPool::submit(std::function<void()> task)
+{
+    int index = currentWorker();
+    if (index < 0)
+    {
+        index = nextQueue++ % queues.size();
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(queues.at(index)->lock);
+        queues.at(index)->tasks.push_back(std::move(task));
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        queuedCount++;
+    }
+    wakeUp.notify_one();
+}
+
+/**
+ * Member Function | ThreadPool | runPendingTask
+ *
+ * Summary: Runs one queued task on the calling thread, if there is one. Used
+ *          by TaskGroup::wait to help instead of blocking.
+ *
+ * @return bool: true if a task was run.
+ */
+bool ThreadPool::runPendingTask()
+{
+    std::function<void()> task;
+    int index = currentWorker();
+
+    if (!takeTask(index < 0 ? 0 : index, task))
+    {
+        return false;
+    }
+
+    task();
+    return true;
+}
+
+/**
+ * Member Function | ThreadPool | size
+ *
+ * @return int: The number of worker threads.
+ */
+int ThreadPool::size() const
+{
+    return workers.size();
+}
+
+/**
+ * Member Function | ThreadPool | workerLoop
+ *
+ * Summary: Body of each worker thread. Sleeps only while nothing is queued
+ *          anywhere.
+ *
+ * @param int index: This worker's queue.
+ */
+void ThreadPool::workerLoop(int index)
+{
+    currentPool = this;
+    currentIndex = index;
+
+    while (true)
+    {
+        std::function<void()> task;
+        if (takeTask(index, task))
+        {
+            task();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> guard(sleepLock);
+        wakeUp.wait(guard, [this]() { return isStopping || queuedCount > 0; });
+        if (isStopping && queuedCount == 0)
+        {
+            return;
+        }
+    }
+}
+
+/**
+ * Member Function | ThreadPool | takeTask
+ *
+ * Summary: Pops the newest task of the given deque, or steals the oldest task
+ *          of the next non empty deque.
+ *
+ * @param int index: The deque to look at first.
+ * @param function<void()>& task: Receives the task.
+ *
+ * @return bool: true if a task was taken.
+ */
+bool ThreadPool::takeTask(int index, std::function<void()>& task)
+{
+    for (int offset = 0; offset < queues.size(); offset++)
+    {
+        WorkQueue& queue = *queues.at((index + offset) % queues.size());
+        std::lock_guard<std::mutex> guard(queue.lock);
+
+        if (!queue.tasks.empty())
+        {
+            if (offset == 0)
+            {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            }
+            else
+            {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            }
+            queuedCount--;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Member Function | ThreadPool | currentWorker
+ *
+ * @return int: The calling thread's queue index, -1 if it is not a worker of
+ *              this pool.
+ */
+int ThreadPool::currentWorker() const
+{
+    return (currentPool == this) ? currentIndex : -1;
+}
+
+
+/**
+ * Constructor | TaskGroup | TaskGroup
+ *
+ * @param ThreadPool& poolP: The pool the group's tasks run on.
+ */
+TaskGroup::TaskGroup(ThreadPool& poolP)
+    : pool(poolP), pendingCount(0)
+{
+}
+
+/**
+ * Destructor | TaskGroup | ~TaskGroup
+ *
+ * Summary: Tasks refer to the group, so it must outlive them. An exception
+ *          nobody waited for is dropped, since a destructor may be running
+ *          because of another one.
+ */
+TaskGroup::~TaskGroup()
+{
+    finish();
+}
+
+/**
+ * Member Function | TaskGroup | run
+ *
+ * Summary: Submits a task that counts towards this group. A task that
+ *          throws still counts as finished; its exception is kept for wait.
+ *
+ * @param function<void()> task: The work to run.
+ */
+void TaskGroup::run(std::function<void()> task)
+{
+    pendingCount++;
+    pool.submit([this, task]()
+    {
+        try
+        {
+            task();
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> guard(errorLock);
+            if (!firstError)
+            {
+                firstError = std::current_exception();
+            }
+        }
+        pendingCount--;
+    });
+}
+
+/**
+ * Member Function | TaskGroup | wait
+ *
+ * Summary: Returns once every task of the group finished, running queued pool
+ *          tasks in the meantime, and rethrows the first exception a task
+ *          threw, if any.
+ */
+void TaskGroup::wait()
+{
+    finish();
+
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> guard(errorLock);
+        error = firstError;
+        firstError = nullptr;
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+/**
+ * Member Function | TaskGroup | finish
+ *
+ * Summary: Returns once every task of the group finished, running queued pool
+ *          tasks in the meantime.
+ */
+void TaskGroup::finish()
+{
+    while (pendingCount > 0)
+    {
+        if (!pool.runPendingTask())
+        {
+            std::this_thread::yield();
+        }
+    }
+}
@@ -0,0 +1,146 @@
+#include <algorithm>
+
+#include "TruthMaintenance.hpp"
+
+
+/**
+ * Member Function | TruthMaintenance | justify
+ *
+ * Summary: Records that a statement fired. Its premises held when it did, so
+ *          it becomes an IN justification of its conclusion. Firing the same
+ *          statement again adds nothing.
+ *
+ * @param int statement: kBase index of the statement that fired.
+ */
+void TruthMaintenance::justify(int statement)
+{
+    if (std::find(justifications.begin(), justifications.end(), statement) == justifications.end())
+    {
+        justifications.push_back(statement);
+    }
+}
+
+/**
+ * Member Function | TruthMaintenance | findSupport
+ *
+ * Summary: Looks for an IN justification of a conclusion.
+ *
+ * @param const ClauseItem& conclusion: The conclusion name and value.
+ * @param const KnowledgeBase& knowledgeBase: The KB the statements index.
+ *
+ * @return int: kBase index of the first statement justifying the conclusion,
+ *          or 0 if the conclusion is OUT.
+ */
+int TruthMaintenance::findSupport(const ClauseItem& conclusion, const KnowledgeBase& knowledgeBase) const
+{
+    for (int justificationIter = 0; justificationIter < justifications.size(); justificationIter++)
+    {
+        const ClauseItem& justified = knowledgeBase.kBase.at(justifications.at(justificationIter)).conclusion;
+        if (justified.name == conclusion.name && justified.value == conclusion.value)
+        {
+            return justifications.at(justificationIter);
+        }
+    }
+    return 0;
+}
+
+/**
+ * Member Function | TruthMaintenance | retract
+ *
+ * Summary: A fact changed. Every justification with the fact as a premise
+ *          goes OUT, then every justification with a conclusion premise that
+ *          is left without an IN justification, until nothing changes.
+ *
+ * @param string factName: The variable whose value changed.
+ * @param const KnowledgeBase& knowledgeBase: The KB the statements index.
+ *
+ * @return vector<int>: The statements whose justification went OUT.
+ */
+std::vector<int> TruthMaintenance::retract(const std::string& factName, const KnowledgeBase& knowledgeBase)
+{
+    std::vector<int> retracted;
+    bool isChanged = true;
+
+    while (isChanged)
+    {
+        isChanged = false;
+        for (int justificationIter = 0; justificationIter < justifications.size(); justificationIter++)
+        {
+            const std::vector<ClauseItem>& premiseList = knowledgeBase.kBase.at(justifications.at(justificationIter)).premiseList;
+            bool isOut = false;
+
+            for (int premiseIter = 1; (!isOut && premiseIter < premiseList.size()); premiseIter++)
+            {
+                const ClauseItem& premise = premiseList.at(premiseIter);
+                if (premise.type == EXPRESSION)
+                {
+                    isOut = isExpressionOut(premise, factName, knowledgeBase);
+                }
+                else if (knowledgeBase.conclusionSet.count(premise.name) == 0)
+                {
+                    isOut = (premise.name == factName);
+                }
+                else
+                {
+                    isOut = (findSupport(premise, knowledgeBase) == 0);
+                }
+            }
+
+            if (isOut)
+            {
+                retracted.push_back(justifications.at(justificationIter));
+                justifications.erase(justifications.begin() + justificationIter);
+                justificationIter--;
+                isChanged = true;
+            }
+        }
+    }
+
+    return retracted;
+}
+
+/**
+ * Member Function | TruthMaintenance | isExpressionOut
+ *
+ * Summary: Whether an OR/NOT premise may no longer hold. Which of its
+ *          branches held is not recorded, so it goes OUT when it tests the
+ *          fact, when a conclusion it tests is left without an IN
+ *          justification, or when it has a negated conclusion, which any
+ *          change could make provable. Too many OUT only costs a proof.
+ *
+ * @param const ClauseItem& premise: An EXPRESSION premise.
+ * @param string factName: The variable whose value changed.
+ * @param const KnowledgeBase& knowledgeBase: The KB the statements index.
+ *
+ * @return bool: True if the justification must go OUT.
+ */
+bool TruthMaintenance::isExpressionOut(const ClauseItem& premise, const std::string& factName,
+                                       const KnowledgeBase& knowledgeBase) const
+{
+    const ExpressionPool& expressions = knowledgeBase.expressions;
+    const std::vector<int>& leaves = expressions.node(expressions.find(premise.name)).leaves;
+    for (int leafIter = 0; leafIter < leaves.size(); leafIter++)
+    {
+        const ExpressionPool::Node& leaf = expressions.node(leaves.at(leafIter));
+        if (knowledgeBase.conclusionSet.count(leaf.clause.name) == 0)
+        {
+            if (leaf.clause.name == factName)
+                return true;
+        }
+        else if (leaf.isNegated || findSupport(leaf.clause, knowledgeBase) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Member Function | TruthMaintenance | clear
+ *
+ * Summary: Forgets every justification, for a new session.
+ */
+void TruthMaintenance::clear()
+{
+    justifications.clear();
+}
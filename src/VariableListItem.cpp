@@ -26,10 +26,34 @@ VariableListItem::VariableListItem(std::string nameP, bool instantiatedP, std::s
     value = valueP;
     description = descriptionP;
     type = typeP;
+    certainty = 1;
     statementIndex.push_back(-1); // To keep in line with the other indexes. But use -1 to note bad values
 }
 
 
+/**
+ * Static Function | VariableListItem | find
+ *
+ * @param vector<VariableListItem> variableList: A variable list, entry 0
+ *          unused.
+ * @param string name: A variable name.
+ *
+ * @return int: The index of the first entry of the name, the one
+ *          BackChain::instantiatePremiseClause uses, or 0 if there is none.
+ */
+int VariableListItem::find(const std::vector<VariableListItem>& variableList, const std::string& name)
+{
+    for (int varListIter = 1; varListIter < variableList.size(); varListIter++)
+    {
+        if (variableList.at(varListIter).name == name)
+        {
+            return varListIter;
+        }
+    }
+    return 0;
+}
+
+
 /**
  * CMember function | VariableListItem | populateAtatementIndex
  *
@@ -49,9 +73,23 @@ void VariableListItem::populateStatementIndex(const KnowledgeBase& knowledgeBase
         isFound = false;
         for (int premiseIter = 1; (!isFound && premiseIter < knowledgeBase.kBase.at(statementIter).premiseList.size()); premiseIter++)
         {
-            if (name == knowledgeBase.kBase.at(statementIter).premiseList.at(premiseIter).name)
+            const ClauseItem& premise = knowledgeBase.kBase.at(statementIter).premiseList.at(premiseIter);
+            if (premise.type == EXPRESSION)
+            {
+                // An OR/NOT premise counts for every name it tests.
+                std::vector<ClauseItem> tests = knowledgeBase.premiseTests(premise);
+                for (int testIter = 0; (!isFound && testIter < tests.size()); testIter++)
+                {
+                    isFound = (name == tests.at(testIter).name);
+                }
+            }
+            else
+            {
+                isFound = (name == premise.name);
+            }
+
+            if (isFound)
             {
-                isFound = true;
                 statementIndex.push_back(statementIter);
             }
         }
@@ -0,0 +1,116 @@
+#!/bin/bash
+
+# Solves every goal of every case in tests/ with each engine, and with the
+# KB loaded in parallel, and compares the results with those of the default
+# tree-walking BackChain. Sharded, multi-process and cached runs number
+# proofs their own way, so only their name = value results are compared.
+# Forward chaining, serial and a level at a time, is checked by -buildtable,
+# which runs it on every answer path.
+# Usage: tests/parity.sh PATH_TO_BINARY
+
+binary="$1"
+tests="$(cd "$(dirname "$0")" && pwd)"
+root="$(dirname "$tests")"
+results="$(mktemp -d)"
+trap 'rm -rf "$results"' EXIT
+
+if [ ! -x "$binary" ]; then
+    echo "usage: $0 PATH_TO_BINARY" >&2
+    exit 2
+fi
+
+failures=0
+
+# Reports whether two result files agree.
+# name, expected, actual
+compare() {
+    if [ -s "$2" ] && diff -u "$2" "$3"; then
+        echo "$1: same"
+    else
+        echo "$1: differs"
+        failures=$((failures + 1))
+    fi
+}
+
+# The name = value part of each result.
+answers() {
+    grep '^Case ' | sed 's/  proof:.*//; s/ *(cached)$//'
+}
+
+# suite name, KB, variable list, cases
+check() {
+    "$binary" -kb "$2" -variables "$3" -batch "$4" -goal all < /dev/null | grep '^Case ' > "$results/$1.expected"
+    if [ ! -s "$results/$1.expected" ]; then
+        echo "$1: no results"
+        failures=$((failures + 1))
+        return
+    fi
+
+    for engine in -iterative -parallel -bytecode -parallelload; do
+        "$binary" -kb "$2" -variables "$3" -batch "$4" -goal all $engine < /dev/null | grep '^Case ' > "$results/$1$engine"
+        compare "$1 $engine" "$results/$1.expected" "$results/$1$engine"
+    done
+
+    answers < "$results/$1.expected" > "$results/$1.answers"
+    "$binary" -kb "$2" -variables "$3" -partition "$results/$1.shards" < /dev/null > /dev/null
+    "$binary" -kb "$2" -variables "$3" -batch "$4" -goal all -shards "$results/$1.shards" < /dev/null | answers > "$results/$1-shards"
+    compare "$1 -shards" "$results/$1.answers" "$results/$1-shards"
+    "$binary" -kb "$2" -variables "$3" -batch "$4" -goal all -shards "$results/$1.shards" -workers 2 < /dev/null \
+        | answers > "$results/$1-workers"
+    compare "$1 -workers" "$results/$1.answers" "$results/$1-workers"
+
+    # Every case twice, so the second time round is answered from the cache.
+    cat "$4" <(echo) "$4" > "$results/$1.twice"
+    "$binary" -kb "$2" -variables "$3" -batch "$results/$1.twice" -goal all < /dev/null | answers > "$results/$1.twice.answers"
+    "$binary" -kb "$2" -variables "$3" -batch "$results/$1.twice" -goal all -cache 1000 < /dev/null | answers > "$results/$1-cache"
+    compare "$1 -cache" "$results/$1.twice.answers" "$results/$1-cache"
+    # Paging in a shard of new rules keeps the results cached so far.
+    "$binary" -kb "$2" -variables "$3" -batch "$results/$1.twice" -goal all -shards "$results/$1.shards" -cache 1000 < /dev/null \
+        | answers > "$results/$1-shards-cache"
+    compare "$1 -shards -cache" "$results/$1.twice.answers" "$results/$1-shards-cache"
+}
+
+# Builds the decision table of a goal, which checks back chaining against
+# forward chaining, serial and -parallelfc's level at a time, on every path.
+# suite name, KB, variable list, goal
+check_table() {
+    if "$binary" -kb "$2" -variables "$3" -goal "$4" -buildtable "$results/$1.table" < /dev/null \
+        | grep -q 'agree on every path'; then
+        echo "$1 -buildtable $4: same"
+    else
+        echo "$1 -buildtable $4: differs"
+        failures=$((failures + 1))
+    fi
+}
+
+# A chain of OR premises deeper than the native stack allows, each level
+# (g{n-1} = y | v1 = y) : g{n} = y. The recursive engine cannot solve it, so
+# -iterative, which must not recurse on OR/NOT premises, is compared with
+# -bytecode instead.
+check_chain() {
+    awk -v levels="$1" 'BEGIN {
+        print "v0 = y : g0 = y"
+        for (level = 1; level < levels; level++)
+            printf "(g%d = y | v1 = y) : g%d = y\n", level - 1, level
+    }' > "$results/chain.txt"
+
+    goal="g$(($1 - 1))"
+    "$binary" -kb "$results/chain.txt" -variables "$tests/deep/chainVariablesList.csv" -batch "$tests/deep/chainCases.txt" \
+        -goal "$goal" -bytecode < /dev/null | grep '^Case ' > "$results/chain.expected"
+    "$binary" -kb "$results/chain.txt" -variables "$tests/deep/chainVariablesList.csv" -batch "$tests/deep/chainCases.txt" \
+        -goal "$goal" -iterative -maxdepth "$1" < /dev/null | grep '^Case ' > "$results/chain-iterative"
+    compare "chain -iterative" "$results/chain.expected" "$results/chain-iterative"
+}
+
+check vehicle "$root/knowledgeBase.txt" "$root/variablesList.csv" "$tests/vehicle/cases.txt"
+check vehicleOr "$tests/vehicle/knowledgeBaseOr.txt" "$root/variablesList.csv" "$tests/vehicle/cases.txt"
+check deep "$tests/deep/knowledgeBase.txt" "$tests/deep/variablesList.csv" "$tests/deep/cases.txt"
+check deepOr "$tests/deep/knowledgeBaseOr.txt" "$tests/deep/variablesList.csv" "$tests/deep/cases.txt"
+check_chain 20000
+
+# The goals whose tables build quickly; the deep OR KB has too many paths.
+check_table vehicle "$root/knowledgeBase.txt" "$root/variablesList.csv" repair
+check_table vehicleOr "$tests/vehicle/knowledgeBaseOr.txt" "$root/variablesList.csv" issue
+check_table deep "$tests/deep/knowledgeBase.txt" "$tests/deep/variablesList.csv" c0
+
+[ "$failures" -eq 0 ]
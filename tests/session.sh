@@ -0,0 +1,134 @@
+#!/bin/bash
+
+# Runs interactive sessions on scripted answers and checks what they ask and
+# conclude: correcting an answer retracts only what depended on it, OR/NOT
+# justifications included; a session suspended to a checkpoint resumes with
+# the same answers, certainties and values other than y/n, and a checkpoint
+# of another KB or variable list is refused; and -speculate asks the same
+# questions as the plain engine.
+# Usage: tests/session.sh PATH_TO_BINARY
+
+binary="$1"
+tests="$(cd "$(dirname "$0")" && pwd)"
+root="$(dirname "$tests")"
+results="$(mktemp -d)"
+trap 'rm -rf "$results"' EXIT
+
+if [ ! -x "$binary" ]; then
+    echo "usage: $0 PATH_TO_BINARY" >&2
+    exit 2
+fi
+
+kb="$tests/session/knowledgeBase.txt"
+variables="$tests/session/variablesList.csv"
+failures=0
+
+# Answers the load pause and the display prompt, then one line of input per
+# argument after the options. The transcript goes to the named file.
+# result name, options..., --, inputs...
+session() {
+    local name="$1"
+    shift
+    local options=()
+    while [ "$1" != "--" ]; do
+        options+=("$1")
+        shift
+    done
+    shift
+    { printf '\nn\n'; printf '%s\n' "$@"; } | "$binary" "${options[@]}" > "$results/$name" 2>&1
+}
+
+# Reports whether a transcript has a line matching the pattern exactly the
+# given number of times.
+# test name, result name, count, pattern
+expect() {
+    local found
+    found=$(grep -c -- "$4" "$results/$2")
+    if [ "$found" -eq "$3" ]; then
+        echo "$1: ok"
+    else
+        echo "$1: expected $3 line(s) matching '$4', found $found"
+        failures=$((failures + 1))
+    fi
+}
+
+# The prompts, questions included, and the results, in order.
+questions() {
+    grep -E ': $|^Result is' "$results/$1"
+}
+
+# Correcting b only retracts q and the goal; a and c are not asked again.
+session correct -kb "$kb" -variables "$variables" -- goal maybe y y y b n n
+expect "changeFact retracted" correct 1 '2 conclusion(s) depended on b and were retracted'
+expect "changeFact kept the rest" correct 1 '^Is a?'
+expect "changeFact re-derived" correct 1 '^Result is: bad'
+
+# goal = bad holds through (p = n | !q = y); correcting a takes it OUT.
+session correctOr -kb "$kb" -variables "$variables" -- goal maybe n y a y y n
+expect "changeFact OR retracted" correctOr 1 '2 conclusion(s) depended on a and were retracted'
+expect "changeFact OR re-derived" correctOr 1 '^Result is: ok'
+expect "changeFact OR asked" correctOr 1 '^Is b?'
+
+# Suspended after c = maybe and a = y[0.6], resumed to answer b.
+session whole -kb "$kb" -variables "$variables" -rank 2 -- goal maybe 'y[0.6]' y n
+session suspended -kb "$kb" -variables "$variables" -rank 2 -checkpoint "$results/checkpoint" -- goal maybe 'y[0.6]' suspend
+expect "checkpoint saved" suspended 1 'Session suspended to'
+session resumed -kb "$kb" -variables "$variables" -rank 2 -checkpoint "$results/checkpoint" -- y n
+expect "checkpoint resumed" resumed 1 '^Resumed the session'
+expect "checkpoint kept the answers" resumed 0 '^Is [ac]?'
+grep -A3 '^Result is' "$results/whole" > "$results/whole.ranked"
+grep -A3 '^Result is' "$results/resumed" > "$results/resumed.ranked"
+if [ -s "$results/whole.ranked" ] && diff -u "$results/whole.ranked" "$results/resumed.ranked"; then
+    echo "checkpoint certainties: ok"
+else
+    echo "checkpoint certainties: differ"
+    failures=$((failures + 1))
+fi
+
+# A checkpoint is refused by another KB version or variable list.
+cp "$kb" "$results/changed.txt"
+echo "c = y : r = y" >> "$results/changed.txt"
+cp "$variables" "$results/more.csv"
+echo "d,Is d?,STRING" >> "$results/more.csv"
+for refused in version variables; do
+    if [ "$refused" = version ]; then
+        options=(-kb "$results/changed.txt" -variables "$variables")
+    else
+        options=(-kb "$kb" -variables "$results/more.csv")
+    fi
+    session suspended -kb "$kb" -variables "$variables" -checkpoint "$results/checkpoint" -- goal maybe suspend
+    session refused "${options[@]}" -checkpoint "$results/checkpoint" -- goal maybe y y n
+    expect "checkpoint of another $refused refused" refused 0 '^Resumed the session'
+    expect "checkpoint of another $refused asks again" refused 1 '^Is c?'
+done
+
+# -speculate asks what the plain engine asks, on a few answer patterns of the
+# shipped KB cut to the questions actually asked, and on a correction.
+for pattern in "y y n" "y n" "n y y y" "y"; do
+    answers=()
+    for answer in $(yes "$pattern" | head -n 20); do
+        answers+=("$answer")
+    done
+    session plain -kb "$root/knowledgeBase.txt" -variables "$root/variablesList.csv" -- repair "${answers[@]}"
+    # Less one for the prompt for the goal.
+    asked=$(($(grep -c ': $' "$results/plain") - 1))
+    session plain -kb "$root/knowledgeBase.txt" -variables "$root/variablesList.csv" -- repair "${answers[@]:0:$asked}" n
+    session speculated -kb "$root/knowledgeBase.txt" -variables "$root/variablesList.csv" -speculate -- \
+        repair "${answers[@]:0:$asked}" n
+    if [ "$asked" -gt 0 ] && diff -u <(questions plain) <(questions speculated); then
+        echo "-speculate ($pattern): same"
+    else
+        echo "-speculate ($pattern): differs"
+        failures=$((failures + 1))
+    fi
+done
+session plain -kb "$kb" -variables "$variables" -- goal maybe n y a y y n
+session speculated -kb "$kb" -variables "$variables" -speculate -- goal maybe n y a y y n
+if diff -u <(questions plain) <(questions speculated); then
+    echo "-speculate correction: same"
+else
+    echo "-speculate correction: differs"
+    failures=$((failures + 1))
+fi
+
+[ "$failures" -eq 0 ]